@@ -3,6 +3,14 @@
 #include <algorithm>
 
 #include "SpudPropertyUtil.h"
+#include "SpudStats.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/Compression.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "UObject/SoftObjectPath.h"
 
 DEFINE_LOG_CATEGORY(LogSpudData)
 
@@ -11,6 +19,97 @@ DEFINE_LOG_CATEGORY(LogSpudData)
 
 // int32 so that Blueprint-compatible. 2 billion should be enough anyway and you can always use the negatives
 int32 GCurrentUserDataModelVersion = 0;
+// Uncompressed unless the subsystem has been told otherwise
+FName GSpudLevelDataCompressionFormat = NAME_None;
+bool GSpudMapLevelFiles = false;
+bool GSpudShareClassDefinitions = true;
+static int32 GSpudSharedClassTableSerial = 0;
+static int32 GSpudCacheFileSerial = 0;
+//------------------------------------------------------------------------------
+
+TArrayView<const uint8> FSpudMappedFile::GetView() const
+{
+	if (!Region.IsValid())
+		return TArrayView<const uint8>();
+
+	return TArrayView<const uint8>(Region->GetMappedPtr(), Region->GetMappedSize());
+}
+
+TSharedPtr<FSpudMappedFile, ESPMode::ThreadSafe> FSpudMappedFile::Open(const FString& Filename)
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	TSharedPtr<FSpudMappedFile, ESPMode::ThreadSafe> Ret = MakeShared<FSpudMappedFile, ESPMode::ThreadSafe>();
+	Ret->Handle.Reset(PlatformFile.OpenMapped(*Filename));
+	if (!Ret->Handle.IsValid())
+		return nullptr;
+
+	// Views are int32 sized, level files should never get close to that
+	const int64 Size = Ret->Handle->GetFileSize();
+	if (Size <= 0 || Size > MAX_int32)
+		return nullptr;
+
+	Ret->Region.Reset(Ret->Handle->MapRegion(0, Size));
+	if (!Ret->Region.IsValid())
+		return nullptr;
+
+	return Ret;
+}
+
+void FSpudMemoryViewReader::Serialize(void* Data, int64 Num)
+{
+	if (Num && !IsError())
+	{
+		if (Offset + Num <= View.Num())
+		{
+			FMemory::Memcpy(Data, View.GetData() + Offset, Num);
+			Offset += Num;
+		}
+		else
+		{
+			SetError();
+		}
+	}
+}
+
+// Byte arrays in data holders use the same format as TArray<uint8> serialisation: int32 count then the bytes
+// When reading from a mapped file we just point at the bytes rather than copying them
+static void ReadHolderData(FSpudChunkedDataArchive& Ar, TArray<uint8>& Data, TArrayView<const uint8>& MappedData)
+{
+	if (Ar.MappedView.Num() > 0)
+	{
+		int32 Num = 0;
+		Ar << Num;
+		const int64 Pos = Ar.Tell();
+		if (Num < 0 || Pos + Num > Ar.MappedView.Num())
+		{
+			Ar.SetError();
+			return;
+		}
+		Data.Empty();
+		MappedData = Ar.MappedView.Slice(Pos, Num);
+		Ar.Seek(Pos + Num);
+	}
+	else
+	{
+		MappedData = TArrayView<const uint8>();
+		Ar << Data;
+	}
+}
+
+static void WriteHolderData(FSpudChunkedDataArchive& Ar, TArray<uint8>& Data, TArrayView<const uint8> MappedData)
+{
+	if (MappedData.Num() > 0)
+	{
+		int32 Num = MappedData.Num();
+		Ar << Num;
+		Ar.Serialize(const_cast<uint8*>(MappedData.GetData()), Num);
+	}
+	else
+	{
+		Ar << Data;
+	}
+}
+
 //------------------------------------------------------------------------------
 
 bool FSpudChunkedDataArchive::PreviewNextChunk(FSpudChunkHeader& OutHeader, bool SeekBackToHeader)
@@ -125,6 +224,25 @@ bool FSpudChunk::IsStillInChunk(FArchive& Ar) const
 	else
 		return true; // always inside while writing
 }
+
+int32 FSpudChunk::CountChildChunks(FSpudChunkedDataArchive& Ar, uint32 EncodedMagic) const
+{
+	if (!Ar.IsLoading())
+		return 0;
+
+	// Just hop from header to header
+	const int64 Start = Ar.Tell();
+	int32 Count = 0;
+	FSpudChunkHeader Hdr;
+	while (IsStillInChunk(Ar) && !Ar.IsError() && Ar.PreviewNextChunk(Hdr, false))
+	{
+		if (Hdr.Magic == EncodedMagic)
+			++Count;
+		Ar.Seek(Ar.Tell() + Hdr.Length);
+	}
+	Ar.Seek(Start);
+	return Count;
+}
 //------------------------------------------------------------------------------
 
 void FSpudVersionInfo::WriteToArchive(FSpudChunkedDataArchive& Ar)
@@ -176,6 +294,9 @@ void FSpudClassDef::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSy
 		Ar << NumProperties;
 		Properties.Empty();
 		PropertyLookup.Empty();
+		PlanSerial = 0;
+		RemapPlanSerial = 0;
+		SharedTableSerial = 0;
 		for (uint16 i = 0; i < NumProperties; ++i)
 		{
 			uint32 PropertyID;
@@ -199,6 +320,9 @@ int FSpudClassDef::AddProperty(uint32 InPropNameID, uint32 InPrefixID, uint16 In
 
 	auto& InnerMap = PropertyLookup.FindOrAdd(InPrefixID);
 	InnerMap.Add(InPropNameID, Index);
+	// A property which was missing in a remap may now be found
+	RemapPlanSerial = 0;
+	SharedTableSerial = 0;
 
 	return Index;
 }
@@ -251,6 +375,11 @@ bool FSpudClassDef::RenameProperty(uint32 OldPropID, uint32 OldPrefixID, uint32
 		auto& NewInnerMap = PropertyLookup.FindOrAdd(NewPrefixID);
 		NewInnerMap.Add(NewPropID, Index);
 
+		// Any cached plan mapping is now wrong
+		PlanSerial = 0;
+		RemapPlanSerial = 0;
+		SharedTableSerial = 0;
+
 		return true;
 		
 	}
@@ -278,7 +407,7 @@ void FSpudPropertyData::WriteToArchive(FSpudChunkedDataArchive& Ar)
 	if (ChunkStart(Ar))
 	{
 		Ar << PropertyOffsets;
-		Ar << Data;
+		WriteHolderData(Ar, Data, MappedData);
 		ChunkEnd(Ar);
 	}
 }
@@ -297,7 +426,7 @@ void FSpudPropertyData::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 Stor
 	if (ChunkStart(Ar))
 	{
 		Ar << PropertyOffsets;
-		Ar << Data;
+		ReadHolderData(Ar, Data, MappedData);
 		ChunkEnd(Ar);
 	}
 }
@@ -313,7 +442,7 @@ void FSpudPropertyData::ReadFromArchiveV1(FSpudChunkedDataArchive& Ar)
 	// This bit used to be a call to inherited Read, hence wrapping incorrectly
 	if (ChunkStart(Ar))
 	{
-		Ar << Data;
+		ReadHolderData(Ar, Data, MappedData);
 		ChunkEnd(Ar);
 	}	
 }
@@ -322,6 +451,17 @@ void FSpudPropertyData::Reset()
 {
 	PropertyOffsets.Empty();
 	Data.Empty();
+	MappedData = TArrayView<const uint8>();
+}
+
+void FSpudPropertyData::DetachFromMappedFile()
+{
+	if (MappedData.Num() > 0)
+	{
+		Data.Reset();
+		Data.Append(MappedData.GetData(), MappedData.Num());
+		MappedData = TArrayView<const uint8>();
+	}
 }
 
 //------------------------------------------------------------------------------
@@ -329,7 +469,7 @@ void FSpudPropertyData::Reset()
 void FSpudDataHolder::WriteToArchive(FSpudChunkedDataArchive& Ar)
 {
 	// Only write this chunk if there's some data
-	if (Data.Num() == 0)
+	if (GetData().Num() == 0)
 		return;
 	
 	if (ChunkStart(Ar))
@@ -337,7 +477,7 @@ void FSpudDataHolder::WriteToArchive(FSpudChunkedDataArchive& Ar)
 		// Technically this duplicates some information, since TArray writes the length of the array at the
 		// start and we already wrote the chunk length (4 bytes longer). But this makes everything simpler,
 		// our length for chunk skipping, and TArray's length for normal serialisation.
-		Ar << Data;
+		WriteHolderData(Ar, Data, MappedData);
 		ChunkEnd(Ar);
 	}
 }
@@ -345,7 +485,7 @@ void FSpudDataHolder::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 Stored
 {
 	if (ChunkStart(Ar))
 	{
-		Ar << Data;
+		ReadHolderData(Ar, Data, MappedData);
 		ChunkEnd(Ar);
 	}
 }
@@ -353,6 +493,41 @@ void FSpudDataHolder::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 Stored
 void FSpudDataHolder::Reset()
 {
 	Data.Empty();
+	MappedData = TArrayView<const uint8>();
+}
+
+void FSpudDataHolder::DetachFromMappedFile()
+{
+	if (MappedData.Num() > 0)
+	{
+		Data.Reset();
+		Data.Append(MappedData.GetData(), MappedData.Num());
+		MappedData = TArrayView<const uint8>();
+	}
+}
+
+void FSpudObjectData::DetachFromMappedFile()
+{
+	CoreData.DetachFromMappedFile();
+	Properties.DetachFromMappedFile();
+	CustomData.DetachFromMappedFile();
+}
+
+void FSpudObjectData::ReuseBuffersFrom(FSpudObjectData& Other)
+{
+	// Whatever's in the buffers is about to be overwritten, so we just need the allocations; any mapped views are
+	// for a mapping that's being released
+	Swap(CoreData.Data, Other.CoreData.Data);
+	Swap(Properties.Data, Other.Properties.Data);
+	Swap(Properties.PropertyOffsets, Other.Properties.PropertyOffsets);
+	Swap(CustomData.Data, Other.CustomData.Data);
+	CoreData.Data.Reset();
+	Properties.Data.Reset();
+	Properties.PropertyOffsets.Reset();
+	CustomData.Data.Reset();
+	CoreData.MappedData = TArrayView<const uint8>();
+	Properties.MappedData = TArrayView<const uint8>();
+	CustomData.MappedData = TArrayView<const uint8>();
 }
 
 //------------------------------------------------------------------------------
@@ -432,10 +607,10 @@ void FSpudSpawnedActorData::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32
 bool FSpudNamedObjectMap::RenameObject(const FString& OldName, const FString& NewName)
 {
 	FSpudNamedObjectData ObjData;
-	if(Contents.RemoveAndCopyValue(OldName, ObjData))
+	if(Contents.RemoveAndCopyValue(FName(*OldName), ObjData))
 	{
 		ObjData.Name = NewName;
-		Contents.Add(NewName, ObjData);
+		Contents.Add(ObjData.Key(), ObjData);
 		return true;
 	}
 	return false;
@@ -457,10 +632,26 @@ void FSpudClassMetadata::WriteToArchive(FSpudChunkedDataArchive& Ar)
 	{
 		UserDataModelVersion.Version = GCurrentUserDataModelVersion;
 		UserDataModelVersion.WriteToArchive(Ar);
-		
-		ClassNameIndex.WriteToArchive(Ar);
-		ClassDefinitions.WriteToArchive(Ar);
-		PropertyNameIndex.WriteToArchive(Ar);
+
+		if (SharedClasses.IsValid() && GSpudShareClassDefinitions)
+		{
+			// Just the ID of the shared definition for each class, instead of all the names & definitions
+			TArray<uint32> SharedDefIDs = SharedClasses->Share(*this);
+			FSpudAdhocWrapperChunk RefsChunk(SPUDDATA_SHAREDCLASSREFS_MAGIC);
+			if (RefsChunk.ChunkStart(Ar))
+			{
+				Ar << SharedDefIDs;
+				RefsChunk.ChunkEnd(Ar);
+			}
+		}
+		else
+		{
+			ClassNameIndex.WriteToArchive(Ar);
+			ClassDefinitions.WriteToArchive(Ar);
+			PropertyNameIndex.WriteToArchive(Ar);
+		}
+		if (ActorNameIndex.UniqueValues.Num() > 0)
+			ActorNameIndex.WriteToArchive(Ar);
 
 		ChunkEnd(Ar);
 	}
@@ -474,6 +665,12 @@ void FSpudClassMetadata::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 Sto
 		const uint32 ClassNameIndexID = FSpudChunkHeader::EncodeMagic(SPUDDATA_CLASSNAMEINDEX_MAGIC);
 		const uint32 ClassDefListID = FSpudChunkHeader::EncodeMagic(SPUDDATA_CLASSDEFINITIONLIST_MAGIC);
 		const uint32 PropertyNameIndexID = FSpudChunkHeader::EncodeMagic(SPUDDATA_PROPERTYNAMEINDEX_MAGIC);
+		const uint32 SharedClassRefsID = FSpudChunkHeader::EncodeMagic(SPUDDATA_SHAREDCLASSREFS_MAGIC);
+		const uint32 ActorNameIndexID = FSpudChunkHeader::EncodeMagic(SPUDDATA_ACTORNAMEINDEX_MAGIC);
+		// Class IDs may refer to different classes now
+		ResolvedClasses.Empty();
+		// Not present if nothing refers to level actors
+		ActorNameIndex.Empty();
 		FSpudChunkHeader Hdr;
 		while (IsStillInChunk(Ar))
 		{
@@ -486,6 +683,27 @@ void FSpudClassMetadata::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 Sto
 				ClassDefinitions.ReadFromArchive(Ar, StoredSystemVersion);
 			else if (Hdr.Magic == PropertyNameIndexID)
 				PropertyNameIndex.ReadFromArchive(Ar, StoredSystemVersion);
+			else if (Hdr.Magic == ActorNameIndexID)
+				ActorNameIndex.ReadFromArchive(Ar, StoredSystemVersion);
+			else if (Hdr.Magic == SharedClassRefsID)
+			{
+				FSpudAdhocWrapperChunk RefsChunk(SPUDDATA_SHAREDCLASSREFS_MAGIC);
+				if (RefsChunk.ChunkStart(Ar))
+				{
+					TArray<uint32> SharedDefIDs;
+					Ar << SharedDefIDs;
+					RefsChunk.ChunkEnd(Ar);
+
+					if (!SharedClasses.IsValid())
+					{
+						UE_LOG(LogSpudData, Error, TEXT("Class metadata refers to shared class definitions, but there are none. Data will not be restored"));
+					}
+					else if (!SharedClasses->Unshare(SharedDefIDs, *this))
+					{
+						UE_LOG(LogSpudData, Error, TEXT("Class metadata refers to shared class definitions which are missing. Some data will not be restored"));
+					}
+				}
+			}
 			else
 				Ar.SkipNextChunk();
 		}
@@ -571,11 +789,36 @@ uint32 FSpudClassMetadata::GetClassIDFromName(const FString& Name) const
 	return ClassNameIndex.GetIndex(Name);
 }
 
+UClass* FSpudClassMetadata::ResolveClass(uint32 ClassID, bool bLoadIfNeeded) const
+{
+	if (ClassID >= static_cast<uint32>(ClassNameIndex.UniqueValues.Num()))
+		return nullptr;
+
+	if (ResolvedClasses.Num() <= static_cast<int32>(ClassID))
+		ResolvedClasses.SetNum(ClassID + 1);
+
+	auto& Resolved = ResolvedClasses[ClassID];
+	// Weak, since e.g. Blueprint classes can be garbage collected once nothing uses them, in which case we look again
+	if (UClass* Class = Resolved.Class.Get())
+		return Class;
+	if (Resolved.bMissing)
+		return nullptr;
+
+	const FSoftClassPath CP(GetClassNameFromID(ClassID));
+	UClass* Class = bLoadIfNeeded ? CP.TryLoadClass<UObject>() : CP.ResolveClass();
+	Resolved.Class = Class;
+	// Only remember that it's missing if we tried loading it
+	Resolved.bMissing = bLoadIfNeeded && !Class;
+	return Class;
+}
+
 void FSpudClassMetadata::Reset()
 {
 	ClassDefinitions.Reset();
 	PropertyNameIndex.Empty();
 	ClassNameIndex.Empty();	
+	ActorNameIndex.Empty();
+	ResolvedClasses.Empty();
 }
 
 bool FSpudClassMetadata::RenameClass(const FString& OldClassName, const FString& NewClassName)
@@ -585,6 +828,9 @@ bool FSpudClassMetadata::RenameClass(const FString& OldClassName, const FString&
 	{
 		auto& ClassDef = ClassDefinitions.Values[Index];
 		ClassDef.ClassName = NewClassName;
+		ClassDef.SharedTableSerial = 0;
+		if (ResolvedClasses.IsValidIndex(Index))
+			ResolvedClasses[Index] = FResolvedClass();
 		return true;
 	}
 	return false;
@@ -615,9 +861,193 @@ bool FSpudClassMetadata::RenameProperty(const FString& ClassName, const FString&
 }
 
 //------------------------------------------------------------------------------
+FSpudSharedClassTable::FSpudSharedClassTable()
+	: Serial(static_cast<uint32>(FPlatformAtomics::InterlockedIncrement(&GSpudSharedClassTableSerial)))
+{
+}
+
+void FSpudSharedClassTable::WriteToArchive(FSpudChunkedDataArchive& Ar)
+{
+	FSpudScopeLock Lock(&Mutex);
+	if (ChunkStart(Ar))
+	{
+		ClassDefinitions.WriteToArchive(Ar);
+		PropertyNameIndex.WriteToArchive(Ar);
+		ChunkEnd(Ar);
+	}
+}
+
+void FSpudSharedClassTable::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion)
+{
+	FSpudScopeLock Lock(&Mutex);
+	if (ChunkStart(Ar))
+	{
+		ClassDefinitions.Values.Empty();
+		PropertyNameIndex.Empty();
+		DefsByClassName.Empty();
+		// Anything which remembered a definition ID from before is now wrong
+		Serial = static_cast<uint32>(FPlatformAtomics::InterlockedIncrement(&GSpudSharedClassTableSerial));
+
+		const uint32 ClassDefListID = FSpudChunkHeader::EncodeMagic(SPUDDATA_CLASSDEFINITIONLIST_MAGIC);
+		const uint32 PropertyNameIndexID = FSpudChunkHeader::EncodeMagic(SPUDDATA_PROPERTYNAMEINDEX_MAGIC);
+		FSpudChunkHeader Hdr;
+		while (IsStillInChunk(Ar))
+		{
+			Ar.PreviewNextChunk(Hdr, true);
+			if (Hdr.Magic == ClassDefListID)
+				ClassDefinitions.ReadFromArchive(Ar, StoredSystemVersion);
+			else if (Hdr.Magic == PropertyNameIndexID)
+				PropertyNameIndex.ReadFromArchive(Ar, StoredSystemVersion);
+			else
+				Ar.SkipNextChunk();
+		}
+
+		for (int32 DefID = 0; DefID < ClassDefinitions.Values.Num(); ++DefID)
+		{
+			DefsByClassName.FindOrAdd(ClassDefinitions.Values[DefID].ClassName).Add(DefID);
+		}
+		ChunkEnd(Ar);
+	}
+}
+
+TArray<uint32> FSpudSharedClassTable::Share(const FSpudClassMetadata& Meta)
+{
+	FSpudScopeLock Lock(&Mutex);
+
+	// Every class ID needs an entry, even if it only ever had its name registered (e.g. nested object classes)
+	const int32 NumClasses = Meta.ClassNameIndex.UniqueValues.Num();
+	TArray<uint32> Ret;
+	Ret.SetNumUninitialized(NumClasses);
+	TArray<FSpudPropertyDef> SharedProperties;
+	for (int32 ClassID = 0; ClassID < NumClasses; ++ClassID)
+	{
+		const FSpudClassDef* Def = Meta.ClassDefinitions.Values.IsValidIndex(ClassID) ? &Meta.ClassDefinitions.Values[ClassID] : nullptr;
+		if (Def && Def->SharedTableSerial == Serial)
+		{
+			// Not changed since it was last shared (or read from us)
+			Ret[ClassID] = Def->SharedDefID;
+			continue;
+		}
+
+		// Translate into our property IDs so we can compare with the versions we already have
+		SharedProperties.Reset();
+		if (Def)
+		{
+			for (const auto& Prop : Def->Properties)
+			{
+				const uint32 PropertyID = PropertyNameIndex.FindOrAddIndex(Meta.GetPropertyNameFromID(Prop.PropertyID));
+				const uint32 PrefixID = Prop.PrefixID == SPUDDATA_PREFIXID_NONE ? SPUDDATA_PREFIXID_NONE :
+					PropertyNameIndex.FindOrAddIndex(Meta.GetPropertyNameFromID(Prop.PrefixID));
+				SharedProperties.Add(FSpudPropertyDef(PropertyID, PrefixID, Prop.DataType));
+			}
+		}
+		Ret[ClassID] = FindOrAddDef(Meta.GetClassNameFromID(ClassID), SharedProperties);
+
+		if (Def)
+		{
+			Def->SharedDefID = Ret[ClassID];
+			Def->SharedTableSerial = Serial;
+		}
+	}
+	return Ret;
+}
+
+uint32 FSpudSharedClassTable::FindOrAddDef(const FString& ClassName, const TArray<FSpudPropertyDef>& Properties)
+{
+	TArray<uint32>& Versions = DefsByClassName.FindOrAdd(ClassName);
+	for (const uint32 DefID : Versions)
+	{
+		const auto& Existing = ClassDefinitions.Values[DefID].Properties;
+		if (Existing.Num() != Properties.Num())
+			continue;
+
+		bool bSame = true;
+		for (int32 i = 0; i < Properties.Num() && bSame; ++i)
+		{
+			bSame = Existing[i].PropertyID == Properties[i].PropertyID &&
+				Existing[i].PrefixID == Properties[i].PrefixID &&
+				Existing[i].DataType == Properties[i].DataType;
+		}
+		if (bSame)
+			return DefID;
+	}
+
+	// New version of this class. Never changed from now on, since other levels may come to refer to it
+	const uint32 NewID = ClassDefinitions.Values.Num();
+	FSpudClassDef& NewDef = ClassDefinitions.Values.AddDefaulted_GetRef();
+	NewDef.ClassName = ClassName;
+	for (const auto& Prop : Properties)
+	{
+		NewDef.AddProperty(Prop.PropertyID, Prop.PrefixID, Prop.DataType);
+	}
+	Versions.Add(NewID);
+	return NewID;
+}
+
+bool FSpudSharedClassTable::Unshare(const TArray<uint32>& DefIDs, FSpudClassMetadata& OutMeta) const
+{
+	FSpudScopeLock Lock(&Mutex);
+
+	OutMeta.ClassNameIndex.Empty();
+	OutMeta.PropertyNameIndex.Empty();
+	OutMeta.ClassDefinitions.Values.Empty(DefIDs.Num());
+	bool bAllFound = true;
+	for (int32 ClassID = 0; ClassID < DefIDs.Num(); ++ClassID)
+	{
+		FSpudClassDef& Def = OutMeta.ClassDefinitions.Values.AddDefaulted_GetRef();
+		if (!ClassDefinitions.Values.IsValidIndex(DefIDs[ClassID]))
+		{
+			// Class IDs are still used in object data, so they have to stay lined up; this one just won't resolve
+			Def.ClassName = FString::Printf(TEXT("MissingSharedClass_%d"), ClassID);
+			OutMeta.ClassNameIndex.FindOrAddIndex(Def.ClassName);
+			bAllFound = false;
+			continue;
+		}
+
+		const FSpudClassDef& Shared = ClassDefinitions.Values[DefIDs[ClassID]];
+		// Names are unique per level, so this is always ClassID
+		OutMeta.ClassNameIndex.FindOrAddIndex(Shared.ClassName);
+		Def.ClassName = Shared.ClassName;
+		for (const auto& Prop : Shared.Properties)
+		{
+			const uint32 PropertyID = OutMeta.FindOrAddPropertyIDFromName(PropertyNameIndex.GetValue(Prop.PropertyID));
+			const uint32 PrefixID = Prop.PrefixID == SPUDDATA_PREFIXID_NONE ? SPUDDATA_PREFIXID_NONE :
+				OutMeta.FindOrAddPrefixID(PropertyNameIndex.GetValue(Prop.PrefixID));
+			Def.AddProperty(PropertyID, PrefixID, Prop.DataType);
+		}
+		// So writing it back out again doesn't have to compare it with anything
+		Def.SharedDefID = DefIDs[ClassID];
+		Def.SharedTableSerial = Serial;
+	}
+	return bAllFound;
+}
+
+bool FSpudSharedClassTable::IsEmpty() const
+{
+	FSpudScopeLock Lock(&Mutex);
+	return ClassDefinitions.Values.Num() == 0;
+}
+
+//------------------------------------------------------------------------------
+TUniquePtr<FArchive> FSpudLevelDataSource::CreateReader() const
+{
+	if (Memory.IsValid())
+		return MakeUnique<FMemoryReader>(*Memory);
+
+	TUniquePtr<FArchive> Ret(IFileManager::Get().CreateFileReader(*Filename));
+	if (Ret)
+		Ret->Seek(Offset);
+	return Ret;
+}
+
+uint32 FSpudLevelData::NewCacheFileSerial()
+{
+	return static_cast<uint32>(FPlatformAtomics::InterlockedIncrement(&GSpudCacheFileSerial));
+}
+
 void FSpudLevelData::WriteToArchive(FSpudChunkedDataArchive& Ar)
 {
-	FScopeLock Lock(&Mutex);
+	FSpudScopeLock Lock(&Mutex);
 
 	if (Status == LDS_Unloaded)
 	{
@@ -625,6 +1055,44 @@ void FSpudLevelData::WriteToArchive(FSpudChunkedDataArchive& Ar)
 		return;
 	}
 
+	const FName CompressionFormat = GSpudLevelDataCompressionFormat;
+	if (CompressionFormat.IsNone())
+	{
+		WriteUncompressedToArchive(Ar);
+		return;
+	}
+
+	// Write the regular chunk to memory, then compress the whole thing
+	TArray<uint8> UncompressedData;
+	FMemoryWriter MemWriter(UncompressedData);
+	FSpudChunkedDataArchive MemAr(MemWriter);
+	WriteUncompressedToArchive(MemAr);
+
+	int32 CompressedSize = FCompression::CompressMemoryBound(CompressionFormat, UncompressedData.Num());
+	TArray<uint8> CompressedData;
+	CompressedData.SetNumUninitialized(CompressedSize);
+	if (!FCompression::CompressMemory(CompressionFormat, CompressedData.GetData(), CompressedSize, UncompressedData.GetData(), UncompressedData.Num()))
+	{
+		UE_LOG(LogSpudData, Warning, TEXT("Unable to compress level data for %s using %s, writing it uncompressed"), *Name, *CompressionFormat.ToString());
+		Ar.Serialize(UncompressedData.GetData(), UncompressedData.Num());
+		return;
+	}
+
+	FSpudAdhocWrapperChunk CompressedChunk(SPUDDATA_COMPRESSEDLEVELDATA_MAGIC);
+	if (CompressedChunk.ChunkStart(Ar))
+	{
+		Ar << Name;
+		FString FormatStr = CompressionFormat.ToString();
+		Ar << FormatStr;
+		int32 UncompressedSize = UncompressedData.Num();
+		Ar << UncompressedSize;
+		Ar.Serialize(CompressedData.GetData(), CompressedSize);
+		CompressedChunk.ChunkEnd(Ar);
+	}
+}
+
+void FSpudLevelData::WriteUncompressedToArchive(FSpudChunkedDataArchive& Ar)
+{
 	if (ChunkStart(Ar))
 	{
 		Ar << Name;
@@ -636,6 +1104,16 @@ void FSpudLevelData::WriteToArchive(FSpudChunkedDataArchive& Ar)
 	}
 }
 
+bool FSpudLevelData::NextChunkIsLevelData(FSpudChunkedDataArchive& Ar)
+{
+	FSpudChunkHeader Hdr;
+	if (!Ar.PreviewNextChunk(Hdr, true))
+		return false;
+
+	return Hdr.Magic == FSpudChunkHeader::EncodeMagic(SPUDDATA_LEVELDATA_MAGIC) ||
+		Hdr.Magic == FSpudChunkHeader::EncodeMagic(SPUDDATA_COMPRESSEDLEVELDATA_MAGIC);
+}
+
 bool FSpudLevelData::ReadLevelInfoFromArchive(FSpudChunkedDataArchive& Ar, bool bReturnToStart, FString& OutLevelName, int64& OutDataSize)
 {
 	// No lock needed as we're not populating anything, this method can  be static
@@ -650,7 +1128,9 @@ bool FSpudLevelData::ReadLevelInfoFromArchive(FSpudChunkedDataArchive& Ar, bool
 	FSpudChunkHeader Hdr;
 	Ar << Hdr;
 
-	if (FSpudChunkHeader::EncodeMagic(SPUDDATA_LEVELDATA_MAGIC) != Hdr.Magic)
+	// Compressed level data has the name outside the compressed part, in the same place
+	if (FSpudChunkHeader::EncodeMagic(SPUDDATA_LEVELDATA_MAGIC) != Hdr.Magic &&
+		FSpudChunkHeader::EncodeMagic(SPUDDATA_COMPRESSEDLEVELDATA_MAGIC) != Hdr.Magic)
 	{
 		UE_LOG(LogSpudData, Error, TEXT("Cannot ReadLevelNameFromArchive from %s, next chunk is not a level"), *Ar.GetArchiveName())
 		if (bReturnToStart)
@@ -670,8 +1150,63 @@ bool FSpudLevelData::ReadLevelInfoFromArchive(FSpudChunkedDataArchive& Ar, bool
 
 void FSpudLevelData::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion)
 {
-	FScopeLock Lock(&Mutex);
+	FSpudScopeLock Lock(&Mutex);
+
+	if (Ar.NextChunkIs(SPUDDATA_COMPRESSEDLEVELDATA_MAGIC))
+	{
+		TArray<uint8> UncompressedData;
+		if (ReadCompressedFromArchive(Ar, UncompressedData))
+		{
+			FMemoryReader MemReader(UncompressedData);
+			FSpudChunkedDataArchive MemAr(MemReader);
+			MemAr.bMemoryBacked = true;
+			ReadUncompressedFromArchive(MemAr, StoredSystemVersion);
+		}
+	}
+	else
+	{
+		ReadUncompressedFromArchive(Ar, StoredSystemVersion);
+	}
+}
+
+bool FSpudLevelData::ReadCompressedFromArchive(FSpudChunkedDataArchive& Ar, TArray<uint8>& OutUncompressedData)
+{
+	FSpudAdhocWrapperChunk CompressedChunk(SPUDDATA_COMPRESSEDLEVELDATA_MAGIC);
+	if (!CompressedChunk.ChunkStart(Ar))
+		return false;
+
+	FString StoredName;
+	FString FormatStr;
+	int32 UncompressedSize = 0;
+	Ar << StoredName;
+	Ar << FormatStr;
+	Ar << UncompressedSize;
+	const int64 CompressedSize = CompressedChunk.ChunkDataEnd - Ar.Tell();
+	if (Ar.IsError() || UncompressedSize < 0 || CompressedSize < 0)
+	{
+		UE_LOG(LogSpudData, Error, TEXT("Compressed level data for %s is corrupt"), *StoredName);
+		CompressedChunk.ChunkEnd(Ar);
+		return false;
+	}
 	
+	TArray<uint8> CompressedData;
+	CompressedData.SetNumUninitialized(CompressedSize);
+	Ar.Serialize(CompressedData.GetData(), CompressedSize);
+	CompressedChunk.ChunkEnd(Ar);
+
+	OutUncompressedData.SetNumUninitialized(UncompressedSize);
+	if (!FCompression::UncompressMemory(FName(*FormatStr), OutUncompressedData.GetData(), UncompressedSize,
+	                                    CompressedData.GetData(), CompressedSize))
+	{
+		UE_LOG(LogSpudData, Error, TEXT("Unable to decompress level data for %s using format %s"), *StoredName, *FormatStr);
+		return false;
+	}
+
+	return true;
+}
+
+void FSpudLevelData::ReadUncompressedFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion)
+{
 	// Separate loading process since it's easier to deal with chunk robustness and versions
 	if (ChunkStart(Ar))
 	{
@@ -705,39 +1240,68 @@ void FSpudLevelData::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredS
 
 void FSpudLevelData::PreStoreWorld()
 {
-	FScopeLock Lock(&Mutex);
+	FSpudScopeLock Lock(&Mutex);
 
 	// We do NOT empty the destroyed actors list because those are populated as things are removed
 	// Hence why NOT calling Reset()
 	Metadata.Reset();
-	LevelActors.Reset();
-	SpawnedActors.Reset();
+	LevelActors.BeginReuse();
+	SpawnedActors.BeginReuse();
+	// Nothing we'll read refers to the mapping any more; reused entries drop their views into it
+	MappedFile.Reset();
+}
+
+void FSpudLevelData::PostStoreWorld()
+{
+	FSpudScopeLock Lock(&Mutex);
+	LevelActors.EndReuse();
+	SpawnedActors.EndReuse();
+}
+
+void FSpudLevelData::DetachFromMappedFile()
+{
+	FSpudScopeLock Lock(&Mutex);
+	if (!MappedFile.IsValid())
+		return;
+
+	for (auto& Pair : LevelActors.Contents)
+	{
+		Pair.Value.DetachFromMappedFile();
+	}
+	for (auto& Pair : SpawnedActors.Contents)
+	{
+		Pair.Value.DetachFromMappedFile();
+	}
+	MappedFile.Reset();
 }
 
 void FSpudLevelData::Reset()
 {
-	FScopeLock Lock(&Mutex);
+	FSpudScopeLock Lock(&Mutex);
 	Name = "";
 	Metadata.Reset();
 	LevelActors.Reset();
 	SpawnedActors.Reset();
 	DestroyedActors.Reset();
 	Status = LDS_Unloaded;
+	MappedFile.Reset();
+	PendingSource.Reset();
 }
 bool FSpudLevelData::IsLoaded()
 {
-	FScopeLock Lock(&Mutex);
+	FSpudScopeLock Lock(&Mutex);
 	return Status == LDS_Loaded;
 }
 
 void FSpudLevelData::ReleaseMemory()
 {
-	FScopeLock Lock(&Mutex);
+	FSpudScopeLock Lock(&Mutex);
 	Metadata.Reset();
 	LevelActors.Reset();
 	SpawnedActors.Reset();
 	DestroyedActors.Reset();
 	Status = LDS_Unloaded;
+	MappedFile.Reset();
 }
 
 
@@ -904,17 +1468,102 @@ void FSpudSaveCustomInfo::Reset()
 }
 
 //------------------------------------------------------------------------------
-void FSpudSaveData::PrepareForWrite()
+void FSpudSaveSlotInfo::SetFromSaveInfo(const FSpudSaveInfo& Info)
 {
-	Info.SystemVersion = SPUD_CURRENT_SYSTEM_VERSION;
+	Title = Info.Title;
+	Timestamp = Info.Timestamp;
+	CustomInfo = Info.CustomInfo;
+	bHasScreenshot = Info.Screenshot.ImageData.Num() > 0;
 }
 
-void FSpudSaveData::WriteToArchive(FSpudChunkedDataArchive& Ar)
+void FSpudSaveSlotInfo::WriteToArchive(FSpudChunkedDataArchive& Ar)
 {
-	WriteToArchive(Ar, "");
-}
-
-void FSpudSaveData::WriteToArchive(FSpudChunkedDataArchive& Ar, const FString& LevelPath)
+	if (ChunkStart(Ar))
+	{
+		Ar << SlotName;
+		Ar << Title;
+		FString TimestampStr = Timestamp.ToIso8601();
+		Ar << TimestampStr;
+		Ar << bHasScreenshot;
+		Ar << FileSize;
+		// Exact ticks for the file time, Iso8601 loses precision and we need to compare it
+		int64 FileTicks = FileTimestamp.GetTicks();
+		Ar << FileTicks;
+		CustomInfo.WriteToArchive(Ar);
+		ChunkEnd(Ar);
+	}
+}
+
+void FSpudSaveSlotInfo::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion)
+{
+	if (ChunkStart(Ar))
+	{
+		Ar << SlotName;
+		Ar << Title;
+		FString TimestampStr;
+		Ar << TimestampStr;
+		FDateTime::ParseIso8601(*TimestampStr, Timestamp);
+		Ar << bHasScreenshot;
+		Ar << FileSize;
+		int64 FileTicks;
+		Ar << FileTicks;
+		FileTimestamp = FDateTime(FileTicks);
+		// We get re-used when reading a list, and custom info isn't written if empty
+		CustomInfo.Reset();
+		if (IsStillInChunk(Ar) && Ar.NextChunkIs(SPUDDATA_CUSTOMINFO_MAGIC))
+			CustomInfo.ReadFromArchive(Ar, StoredSystemVersion);
+		ChunkEnd(Ar);
+	}
+}
+
+//------------------------------------------------------------------------------
+void FSpudLevelIndex::WriteToArchive(FSpudChunkedDataArchive& Ar)
+{
+	if (ChunkStart(Ar))
+	{
+		uint32 Count = Entries.Num();
+		Ar << Count;
+		for (auto& Entry : Entries)
+		{
+			Ar << Entry.Name;
+			Ar << Entry.Offset;
+			Ar << Entry.Size;
+		}
+		ChunkEnd(Ar);
+	}
+}
+
+void FSpudLevelIndex::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion)
+{
+	if (ChunkStart(Ar))
+	{
+		uint32 Count = 0;
+		Ar << Count;
+		Entries.Empty(Count);
+		for (uint32 i = 0; i < Count && IsStillInChunk(Ar) && !Ar.IsError(); ++i)
+		{
+			FEntry Entry;
+			Ar << Entry.Name;
+			Ar << Entry.Offset;
+			Ar << Entry.Size;
+			Entries.Add(Entry);
+		}
+		ChunkEnd(Ar);
+	}
+}
+
+//------------------------------------------------------------------------------
+void FSpudSaveData::PrepareForWrite()
+{
+	Info.SystemVersion = SPUD_CURRENT_SYSTEM_VERSION;
+}
+
+void FSpudSaveData::WriteToArchive(FSpudChunkedDataArchive& Ar)
+{
+	WriteToArchive(Ar, "");
+}
+
+void FSpudSaveData::WriteToArchive(FSpudChunkedDataArchive& Ar, const FString& LevelPath)
 {
 	if (ChunkStart(Ar))
 	{
@@ -922,16 +1571,21 @@ void FSpudSaveData::WriteToArchive(FSpudChunkedDataArchive& Ar, const FString& L
 		GlobalData.WriteToArchive(Ar);
 
 		// Manually write the level data because its source could be memory, or piped in from files
+		// We also build an index of where each level ended up, so loading can go straight to the levels it needs
+		FSpudLevelIndex LevelIndex;
 		FSpudAdhocWrapperChunk LevelDataMapChunk(SPUDDATA_LEVELDATAMAP_MAGIC);
 		if (LevelDataMapChunk.ChunkStart(Ar))
 		{
-			FScopeLock MapLock(&LevelDataMapMutex);
-			for (auto&& KV : LevelDataMap)
+			// Only lock the map long enough to take a copy of it, so that levels can still be streamed in & out
+			// (and their state loaded / written) while we're piping potentially a lot of data into the save.
+			// Each level is locked while it's being written, which is all we need for consistency
+			const TArray<TLevelDataPtr> Levels = GetLevelDataSnapshot();
+			for (auto&& LevelData : Levels)
 			{
-				auto& LevelData = KV.Value;
 				// Lock outer so the status check write/copy are all locked together
 				// FCriticalSection is recursive (already locked by same thread is fine)
-				FScopeLock LevelLock(&LevelData->Mutex);
+				FSpudScopeLock LevelLock(&LevelData->Mutex);
+				const int64 LevelStart = Ar.Tell();
 				
 				// For level data that's not loaded, we pipe data directly from the serialized file into
 				switch (LevelData->Status)
@@ -946,6 +1600,24 @@ void FSpudSaveData::WriteToArchive(FSpudChunkedDataArchive& Ar, const FString& L
 					// This level data is not in memory. We want to pipe level data directly from the level file into
 					// the combined archive so it doesn't have to go through memory
 					IFileManager& FileMgr = IFileManager::Get();
+					if (LevelData->PendingSource.IsSet())
+					{
+						// Not extracted to the level cache yet, so it's still only in the save (or snapshot) we loaded from
+						const FSpudLevelDataSource& Src = LevelData->PendingSource;
+						auto InSaveArchive = Src.CreateReader();
+						if (!InSaveArchive)
+						{
+							UE_LOG(LogSpudData, Error, TEXT("Level %s is recorded as being in save file %s, but it can't be opened. "
+							"This level will be missing from the save"), *LevelData->Name, *Src.Filename);
+						}
+						else
+						{
+							SpudCopyArchiveData(*InSaveArchive.Get(), Ar, Src.Size);
+							InSaveArchive->Close();
+							SPUD_COUNT_BYTES(BytesRead, Src.Size);
+						}
+						break;
+					}
 					auto InLevelArchive = TUniquePtr<FArchive>(FileMgr.CreateFileReader(*GetLevelDataPath(LevelPath, LevelData->Name)));
 
 					if (!InLevelArchive)
@@ -955,22 +1627,33 @@ void FSpudSaveData::WriteToArchive(FSpudChunkedDataArchive& Ar, const FString& L
 					}
 					else
 					{
+						SPUD_COUNT_BYTES(BytesRead, InLevelArchive->TotalSize());
 						SpudCopyArchiveData(*InLevelArchive.Get(), Ar, InLevelArchive->TotalSize());
 						InLevelArchive->Close();
 					}
 					break;
 				}
+
+				const int64 LevelSize = Ar.Tell() - LevelStart;
+				if (LevelSize > 0)
+					LevelIndex.Entries.Add(FSpudLevelIndex::FEntry { LevelData->Name, LevelStart - ChunkHeaderStart, LevelSize });
 			}
 			// Finish the level container
 			LevelDataMapChunk.ChunkEnd(Ar);
 		}
+		// Shared class definitions go after the levels, since writing loaded levels can add to them
+		if (!SharedClasses->IsEmpty())
+			SharedClasses->WriteToArchive(Ar);
+		// Index goes after the levels since we only know where they are once written. Older versions skip it
+		LevelIndex.WriteToArchive(Ar);
 
 		ChunkEnd(Ar);
 	}
 	
 }
 
-void FSpudSaveData::ReadFromArchive(FSpudChunkedDataArchive& Ar, bool bLoadAllLevels, const FString& LevelPath)
+void FSpudSaveData::ReadFromArchive(FSpudChunkedDataArchive& Ar, bool bLoadAllLevels, const FString& LevelPath,
+                                    const FString& SourceFilename)
 {
 	if (ChunkStart(Ar))
 	{
@@ -986,6 +1669,10 @@ void FSpudSaveData::ReadFromArchive(FSpudChunkedDataArchive& Ar, bool bLoadAllLe
 			return;
 		}
 
+		// Level data is counted where it's actually read (piped, loaded when needed etc), so only count what we read
+		// in place here, not what's skipped over
+		const int64 ReadStart = Ar.Tell();
+		int64 BytesSkipped = 0;
 		Info.ReadFromArchive(Ar, 0);
 
 		bool bOrigLoadAllLevels = bLoadAllLevels;
@@ -997,8 +1684,15 @@ void FSpudSaveData::ReadFromArchive(FSpudChunkedDataArchive& Ar, bool bLoadAllLe
 			bLoadAllLevels = true;
 			bIsUpgrading = true;
 		}
+		// If there's an index we can skip all the level data & only read what's needed later, direct from the file
+		const bool bCanReadLazily = !bLoadAllLevels && !SourceFilename.IsEmpty();
+		int64 LevelDataMapOffset = -1;
+		bool bReadIndex = false;
+		SharedClasses = MakeShared<FSpudSharedClassTable, ESPMode::ThreadSafe>();
 		const uint32 GlobalDataID = FSpudChunkHeader::EncodeMagic(SPUDDATA_GLOBALDATA_MAGIC);
 		const uint32 LevelDataMapID = FSpudChunkHeader::EncodeMagic(SPUDDATA_LEVELDATAMAP_MAGIC);
+		const uint32 LevelIndexID = FSpudChunkHeader::EncodeMagic(SPUDDATA_LEVELINDEX_MAGIC);
+		const uint32 SharedClassesID = FSpudChunkHeader::EncodeMagic(SPUDDATA_SHAREDCLASSES_MAGIC);
 		while (IsStillInChunk(Ar))
 		{
 			Ar.PreviewNextChunk(Hdr, true);
@@ -1006,82 +1700,368 @@ void FSpudSaveData::ReadFromArchive(FSpudChunkedDataArchive& Ar, bool bLoadAllLe
 				GlobalData.ReadFromArchive(Ar, Info.SystemVersion);
 			else if (Hdr.Magic == LevelDataMapID)
 			{
-				// Read levels using adhoc wrapper so we can choose what to do for each
-				FSpudAdhocWrapperChunk LevelDataMapChunk(SPUDDATA_LEVELDATAMAP_MAGIC);
-				if (LevelDataMapChunk.ChunkStart(Ar))
+				// Come back to this once we've read the shared class definitions, which come after it (or if we
+				// were going to read lazily but it turns out there's no index)
+				LevelDataMapOffset = Ar.Tell();
+				Ar.SkipNextChunk();
+				BytesSkipped += Ar.Tell() - LevelDataMapOffset;
+			}
+			else if (Hdr.Magic == SharedClassesID)
+				SharedClasses->ReadFromArchive(Ar, Info.SystemVersion);
+			else if (Hdr.Magic == LevelIndexID && bCanReadLazily)
+			{
+				FSpudLevelIndex LevelIndex;
+				LevelIndex.ReadFromArchive(Ar, Info.SystemVersion);
+				
+				FSpudScopeLock MapMutex(&LevelDataMapMutex);
+				LevelDataMap.Empty();
+				for (auto& Entry : LevelIndex.Entries)
 				{
-					{
-						FScopeLock MapMutex(&LevelDataMapMutex);					
-						LevelDataMap.Empty();
-					}
+					TLevelDataPtr LvlData(new FSpudLevelData(SharedClasses));
+					LvlData->Name = Entry.Name;
+					LvlData->Status = LDS_Unloaded;
+					LvlData->PendingSource = FSpudLevelDataSource { SourceFilename, ChunkHeaderStart + Entry.Offset, Entry.Size };
+					LevelDataMap.Add(LvlData->Key(), LvlData);
+				}
+				bReadIndex = true;
+			}
+			else
+			{
+				const int64 SkipStart = Ar.Tell();
+				Ar.SkipNextChunk();
+				BytesSkipped += Ar.Tell() - SkipStart;
+			}
+		}
+		SPUD_COUNT_BYTES(BytesRead, Ar.Tell() - ReadStart - BytesSkipped);
+
+		if (LevelDataMapOffset >= 0 && !bReadIndex)
+		{
+			// Not reading lazily, or an older save without an index, have to go through all the levels
+			const int64 SaveEnd = Ar.Tell();
+			Ar.Seek(LevelDataMapOffset);
+			ReadLevelDataMap(Ar, bLoadAllLevels, LevelPath);
+			Ar.Seek(SaveEnd);
+		}
+
+		if (bIsUpgrading)
+			UE_LOG(LogSpudData, Log, TEXT("Save file %s upgrade complete. Not changed on disk, will be saved in new format next time."), *Ar.GetArchiveName())
+
+		if (bLoadAllLevels && !bOrigLoadAllLevels)
+		{
+			// We forced a load of all levels even though the caller didn't want it (perhaps because of upgrade)
+			// So now unload them
+			WriteAndReleaseAllLevelData(LevelPath);
+		}
+
+		ChunkEnd(Ar);
+	}
+
+}
+
+void FSpudSaveData::ReadLevelDataMap(FSpudChunkedDataArchive& Ar, bool bLoadAllLevels, const FString& LevelPath)
+{
+	// Read levels using adhoc wrapper so we can choose what to do for each
+	FSpudAdhocWrapperChunk LevelDataMapChunk(SPUDDATA_LEVELDATAMAP_MAGIC);
+	if (LevelDataMapChunk.ChunkStart(Ar))
+	{
+		{
+			FSpudScopeLock MapMutex(&LevelDataMapMutex);					
+			LevelDataMap.Empty();
+		}
 
-					// Detect chunks & only load compatible
-					const uint32 LevelMagicID = FSpudChunkHeader::EncodeMagic(SPUDDATA_LEVELDATA_MAGIC);
-					while (IsStillInChunk(Ar))
+		// When loading everything, the raw chunk for each level is read here first, then they're all parsed in
+		// parallel below, since levels don't share anything but the (locked) shared class table
+		struct FRawLevel
+		{
+			TLevelDataPtr LevelData;
+			FString Name;
+			TArray<uint8> Data;
+			/// Only written by the task parsing this level
+			bool bFailed = false;
+		};
+		TArray<FRawLevel> RawLevels;
+
+		// Detect chunks & only load compatible
+		while (LevelDataMapChunk.IsStillInChunk(Ar) && !Ar.IsError())
+		{
+			if (FSpudLevelData::NextChunkIsLevelData(Ar))
+			{
+				if (bLoadAllLevels)
+				{
+					FString LevelName;
+					int64 LevelDataSize;
+					if (FSpudLevelData::ReadLevelInfoFromArchive(Ar, true, LevelName, LevelDataSize))
 					{
-						if (Ar.NextChunkIs(LevelMagicID))
+						// Don't trust the chunk length until we know it's inside the level map, and the file
+						const int64 TotalSize = LevelDataSize + FSpudChunkHeader::GetHeaderSize();
+						const int64 Available = FMath::Min(LevelDataMapChunk.ChunkDataEnd, Ar.TotalSize()) - Ar.Tell();
+						if (TotalSize > Available || TotalSize > MAX_int32)
 						{
-							if (bLoadAllLevels)
-							{
-								TLevelDataPtr LvlData(new FSpudLevelData());
-								LvlData->ReadFromArchive(Ar, Info.SystemVersion);
-								{
-									FScopeLock MapMutex(&LevelDataMapMutex);					
-									LevelDataMap.Add(LvlData->Key(), LvlData);
-								}
-							}
-							else
-							{
-								// Pipe data for this level into its own file rather than load it
-								// We need to know the level name though
-								FString LevelName;
-								int64 LevelDataSize;
-								if (FSpudLevelData::ReadLevelInfoFromArchive(Ar, true, LevelName, LevelDataSize))
-								{
-									IFileManager& FileMgr = IFileManager::Get();
-									auto OutLevelArchive = TUniquePtr<FArchive>(FileMgr.CreateFileWriter(*GetLevelDataPath(LevelPath, LevelName)));
-
-									int64 TotalSize = LevelDataSize + FSpudChunkHeader::GetHeaderSize();
-									SpudCopyArchiveData(Ar, *OutLevelArchive.Get(), TotalSize);
-									OutLevelArchive->Close();
-									
-                                    TLevelDataPtr LvlData(new FSpudLevelData());
-									LvlData->Name = LevelName;
-									LvlData->Status = LDS_Unloaded;
-									{
-										FScopeLock MapMutex(&LevelDataMapMutex);					
-										LevelDataMap.Add(LvlData->Key(), LvlData);
-									}
-								}
-							}
+							UE_LOG(LogSpudData, Error, TEXT("Invalid data size %lld for level %s in %s"), TotalSize, *LevelName, *Ar.GetArchiveName());
+							Ar.SetError();
+							break;
 						}
-						else
+						auto& Raw = RawLevels.AddDefaulted_GetRef();
+						Raw.LevelData = TLevelDataPtr(new FSpudLevelData(SharedClasses));
+						Raw.Name = LevelName;
+						Raw.Data.SetNumUninitialized(static_cast<int32>(TotalSize));
+						Ar.Serialize(Raw.Data.GetData(), TotalSize);
+						SPUD_COUNT_BYTES(BytesRead, TotalSize);
+					}
+					else
+					{
+						Ar.SkipNextChunk();
+					}
+				}
+				else
+				{
+					// Pipe data for this level into its own file rather than load it
+					// We need to know the level name though
+					FString LevelName;
+					int64 LevelDataSize;
+					if (FSpudLevelData::ReadLevelInfoFromArchive(Ar, true, LevelName, LevelDataSize))
+					{
+						const int64 TotalSize = LevelDataSize + FSpudChunkHeader::GetHeaderSize();
+						const bool bPiped = PipeLevelDataToFile(Ar, TotalSize, LevelName, LevelPath);
+						
+						TLevelDataPtr LvlData(new FSpudLevelData(SharedClasses));
+						LvlData->Name = LevelName;
+						LvlData->Status = LDS_Unloaded;
+						if (bPiped)
+							LvlData->CacheFileSerial = FSpudLevelData::NewCacheFileSerial();
 						{
-							Ar.SkipNextChunk();
+							FSpudScopeLock MapMutex(&LevelDataMapMutex);					
+							LevelDataMap.Add(LvlData->Key(), LvlData);
 						}
 					}
-					
-					LevelDataMapChunk.ChunkEnd(Ar);
 				}
-				
 			}
 			else
+			{
 				Ar.SkipNextChunk();
+			}
 		}
 
-		if (bIsUpgrading)
-			UE_LOG(LogSpudData, Log, TEXT("Save file %s upgrade complete. Not changed on disk, will be saved in new format next time."), *Ar.GetArchiveName())
+		if (RawLevels.Num() > 0 && !Ar.IsError())
+		{
+			SPUD_SCOPED_STAT(ParseLevelData);
+			const uint32 SystemVersion = Info.SystemVersion;
+			ParallelFor(RawLevels.Num(), [&RawLevels, SystemVersion](int32 Index)
+			{
+				auto& Raw = RawLevels[Index];
+				FMemoryReader MemReader(Raw.Data);
+				FSpudChunkedDataArchive MemAr(MemReader);
+				MemAr.bMemoryBacked = true;
+				Raw.LevelData->ReadFromArchive(MemAr, SystemVersion);
+				Raw.bFailed = MemAr.IsError();
+				Raw.Data.Empty();
+			});
+
+			// Failures have to end up on the archive callers check, same as reading levels in place; partly read
+			// levels are left out so they can't be written back to the level cache
+			bool bAnyFailed = false;
+			FSpudScopeLock MapMutex(&LevelDataMapMutex);
+			for (auto& Raw : RawLevels)
+			{
+				if (Raw.bFailed)
+				{
+					UE_LOG(LogSpudData, Error, TEXT("Error while reading data for level %s in %s"), *Raw.Name, *Ar.GetArchiveName());
+					bAnyFailed = true;
+				}
+				else
+				{
+					LevelDataMap.Add(Raw.LevelData->Key(), Raw.LevelData);
+				}
+			}
+			if (bAnyFailed)
+				Ar.SetError();
+		}
+		
+		LevelDataMapChunk.ChunkEnd(Ar);
+	}
+}
 
-		if (bLoadAllLevels && !bOrigLoadAllLevels)
+bool FSpudSaveData::ReadFromArchiveStaged(FSpudChunkedDataArchive& Ar, const FString& LevelPath, TFunctionRef<void()> OnInitialDataReady,
+                                          const FString& SourceFilename)
+{
+	const int64 SaveStart = Ar.Tell();
+	if (!ChunkStart(Ar))
+	{
+		UE_LOG(LogSpudData, Error, TEXT("Cannot load %s, it is not a save game"), *Ar.GetArchiveName());
+		return false;
+	}
+
+	FSpudChunkHeader Hdr;
+	// first chunk MUST be info chunk, same as ReadFromArchive
+	const uint32 InfoID = FSpudChunkHeader::EncodeMagic(SPUDDATA_SAVEINFO_MAGIC);
+	Ar.PreviewNextChunk(Hdr);
+	if (Hdr.Magic != InfoID)
+	{
+		UE_LOG(LogSpudData, Error, TEXT("Save data is corrupt, first chunk MUST be the INFO chunk."));
+		return false;
+	}
+	// As ReadFromArchive, level data is counted where it's read so only count what's read here
+	const int64 ReadStart = Ar.Tell();
+	int64 BytesSkipped = 0;
+	Info.ReadFromArchive(Ar, 0);
+
+	if (Info.SystemVersion != SPUD_CURRENT_SYSTEM_VERSION)
+	{
+		// Old system versions have to have all their levels loaded in order to be upgraded, so there's no staging
+		// possible. Just use the regular path, which also re-writes the level files in the new format
+		Ar.Seek(SaveStart);
+		ReadFromArchive(Ar, false, LevelPath);
+		if (Ar.IsError())
+			return false;
+		
+		OnInitialDataReady();
+		return true;
+	}
+
+	// First pass, read the global data and just find where all the levels are
+	struct FPendingLevel
+	{
+		TLevelDataPtr LevelData;
+		int64 Offset;
+		int64 TotalSize;
+	};
+	TArray<FPendingLevel> PendingLevels;
+	int64 LevelDataMapOffset = -1;
+	bool bReadIndex = false;
+	SharedClasses = MakeShared<FSpudSharedClassTable, ESPMode::ThreadSafe>();
+	const uint32 GlobalDataID = FSpudChunkHeader::EncodeMagic(SPUDDATA_GLOBALDATA_MAGIC);
+	const uint32 LevelDataMapID = FSpudChunkHeader::EncodeMagic(SPUDDATA_LEVELDATAMAP_MAGIC);
+	const uint32 LevelIndexID = FSpudChunkHeader::EncodeMagic(SPUDDATA_LEVELINDEX_MAGIC);
+	const uint32 SharedClassesID = FSpudChunkHeader::EncodeMagic(SPUDDATA_SHAREDCLASSES_MAGIC);
+	while (IsStillInChunk(Ar) && !Ar.IsError())
+	{
+		Ar.PreviewNextChunk(Hdr, true);
+		if (Hdr.Magic == GlobalDataID)
+			GlobalData.ReadFromArchive(Ar, Info.SystemVersion);
+		else if (Hdr.Magic == SharedClassesID)
+			SharedClasses->ReadFromArchive(Ar, Info.SystemVersion);
+		else if (Hdr.Magic == LevelDataMapID)
 		{
-			// We forced a load of all levels even though the caller didn't want it (perhaps because of upgrade)
-			// So now unload them
-			WriteAndReleaseAllLevelData(LevelPath);
+			// Only scan the levels if there turns out to be no index
+			LevelDataMapOffset = Ar.Tell();
+			Ar.SkipNextChunk();
+			BytesSkipped += Ar.Tell() - LevelDataMapOffset;
+		}
+		else if (Hdr.Magic == LevelIndexID)
+		{
+			FSpudLevelIndex LevelIndex;
+			LevelIndex.ReadFromArchive(Ar, Info.SystemVersion);
+			for (auto& Entry : LevelIndex.Entries)
+			{
+				TLevelDataPtr LvlData(new FSpudLevelData(SharedClasses));
+				LvlData->Name = Entry.Name;
+				LvlData->Status = LDS_Unloaded;
+				PendingLevels.Add(FPendingLevel { LvlData, SaveStart + Entry.Offset, Entry.Size });
+			}
+			bReadIndex = true;
+		}
+		else
+		{
+			const int64 SkipStart = Ar.Tell();
+			Ar.SkipNextChunk();
+			BytesSkipped += Ar.Tell() - SkipStart;
+		}
+	}
+	SPUD_COUNT_BYTES(BytesRead, Ar.Tell() - ReadStart - BytesSkipped);
+
+	if (LevelDataMapOffset >= 0 && !bReadIndex && !Ar.IsError())
+	{
+		// Older save with no index, find all the levels the long way
+		Ar.Seek(LevelDataMapOffset);
+		FSpudAdhocWrapperChunk LevelDataMapChunk(SPUDDATA_LEVELDATAMAP_MAGIC);
+		if (LevelDataMapChunk.ChunkStart(Ar))
+		{
+			while (LevelDataMapChunk.IsStillInChunk(Ar) && !Ar.IsError())
+			{
+				const int64 LevelStart = Ar.Tell();
+				FString LevelName;
+				int64 LevelDataSize;
+				if (FSpudLevelData::NextChunkIsLevelData(Ar) &&
+					FSpudLevelData::ReadLevelInfoFromArchive(Ar, true, LevelName, LevelDataSize))
+				{
+					TLevelDataPtr LvlData(new FSpudLevelData(SharedClasses));
+					LvlData->Name = LevelName;
+					LvlData->Status = LDS_Unloaded;
+					PendingLevels.Add(FPendingLevel { LvlData, LevelStart, LevelDataSize + FSpudChunkHeader::GetHeaderSize() });
+				}
+				Ar.SkipNextChunk();
+			}
+			LevelDataMapChunk.ChunkEnd(Ar);
 		}
+	}
+
+	if (Ar.IsError())
+	{
+		UE_LOG(LogSpudData, Error, TEXT("Error while reading save game %s"), *Ar.GetArchiveName());
+		return false;
+	}
+
+	// The level we're going to travel to is the one needed first
+	PendingLevels.StableSort([this](const FPendingLevel& A, const FPendingLevel& B)
+	{
+		return A.LevelData->Name == GlobalData.CurrentLevel && B.LevelData->Name != GlobalData.CurrentLevel;
+	});
 
+	if (bReadIndex && !SourceFilename.IsEmpty())
+	{
+		// We know where every level is in the file, so nothing has to wait for extraction: any level that's needed
+		// before we get to it is just read from the save file directly
+		{
+			FSpudScopeLock MapMutex(&LevelDataMapMutex);
+			LevelDataMap.Empty();
+			for (auto& Pending : PendingLevels)
+			{
+				Pending.LevelData->PendingSource = FSpudLevelDataSource { SourceFilename, Pending.Offset, Pending.TotalSize };
+				LevelDataMap.Add(Pending.LevelData->Key(), Pending.LevelData);
+			}
+		}
+		OnInitialDataReady();
+		ExtractPendingLevelData(LevelPath);
 		ChunkEnd(Ar);
+		return true;
+	}
+
+	// Register all the levels now, but hold each one's lock until it's been extracted. That way anything asking for a
+	// level that we haven't got to yet just waits for it, rather than finding no data in the cache.
+	// The locks are all taken & released on this thread so that's fine with FCriticalSection
+	{
+		FSpudScopeLock MapMutex(&LevelDataMapMutex);
+		LevelDataMap.Empty();
+		for (auto& Pending : PendingLevels)
+		{
+			Pending.LevelData->Mutex.Lock();
+			LevelDataMap.Add(Pending.LevelData->Key(), Pending.LevelData);
+		}
+	}
+
+	const bool bHasCurrentLevelData = PendingLevels.Num() > 0 && PendingLevels[0].LevelData->Name == GlobalData.CurrentLevel;
+	if (!bHasCurrentLevelData)
+		OnInitialDataReady();
+	
+	for (int i = 0; i < PendingLevels.Num(); ++i)
+	{
+		auto& Pending = PendingLevels[i];
+		// Keep going on error so we always unlock
+		if (!Ar.IsError())
+		{
+			Ar.Seek(Pending.Offset);
+			if (PipeLevelDataToFile(Ar, Pending.TotalSize, Pending.LevelData->Name, LevelPath))
+				Pending.LevelData->CacheFileSerial = FSpudLevelData::NewCacheFileSerial();
+		}
+		Pending.LevelData->Mutex.Unlock();
+
+		if (i == 0 && bHasCurrentLevelData)
+			OnInitialDataReady();
 	}
 
+	ChunkEnd(Ar);
+	
+	return true;
 }
 
 void FSpudSaveData::ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion)
@@ -1095,20 +2075,21 @@ void FSpudSaveData::Reset()
 	Info.Reset();
 	GlobalData.Reset();
 	{
-		FScopeLock MapMutex(&LevelDataMapMutex);
+		FSpudScopeLock MapMutex(&LevelDataMapMutex);
 		LevelDataMap.Empty();
 	}
+	SharedClasses = MakeShared<FSpudSharedClassTable, ESPMode::ThreadSafe>();
 }
 
 FSpudSaveData::TLevelDataPtr FSpudSaveData::CreateLevelData(const FString& LevelName)
 {
-	TLevelDataPtr NewLevelData(new FSpudLevelData());
+	TLevelDataPtr NewLevelData(new FSpudLevelData(SharedClasses));
 	NewLevelData->Name = LevelName;
 	NewLevelData->Status = LDS_Loaded; // assume loaded if we're creating
 
 	{
-		FScopeLock MapMutex(&LevelDataMapMutex);
-		LevelDataMap.Add(LevelName, NewLevelData);
+		FSpudScopeLock MapMutex(&LevelDataMapMutex);
+		LevelDataMap.Add(FName(*LevelName), NewLevelData);
 	}
 	
 	return NewLevelData;
@@ -1137,6 +2118,10 @@ FString FSpudSaveData::GetLevelDataPath(const FString& LevelPath, const FString&
 
 void FSpudSaveData::WriteLevelData(FSpudLevelData& LevelData, const FString& LevelName, const FString& LevelPath)
 {
+	// We're about to overwrite the file, so anything still pointing into it has to be copied out first
+	LevelData.DetachFromMappedFile();
+
+	SPUD_SCOPED_STAT(WriteLevelData);
 	IFileManager& FileMgr = IFileManager::Get();
 	const FString Filename = GetLevelDataPath(LevelPath, LevelName);
 	const auto Archive = TUniquePtr<FArchive>(FileMgr.CreateFileWriter(*Filename));
@@ -1145,6 +2130,7 @@ void FSpudSaveData::WriteLevelData(FSpudLevelData& LevelData, const FString& Lev
 	{
 		FSpudChunkedDataArchive ChunkedAr(*Archive);
 		LevelData.WriteToArchive(ChunkedAr);
+		SPUD_COUNT_BYTES(BytesWritten, Archive->Tell());
 		// Always explicitly close to catch errors from flush/close
 		ChunkedAr.Close();
 
@@ -1152,6 +2138,12 @@ void FSpudSaveData::WriteLevelData(FSpudLevelData& LevelData, const FString& Lev
 		{
 			UE_LOG(LogSpudData, Error, TEXT("Error while writing level data to %s"), *Filename);
 		}
+		else
+		{
+			// The level cache is now the authority, not the save we loaded from
+			LevelData.PendingSource.Reset();
+			LevelData.CacheFileSerial = FSpudLevelData::NewCacheFileSerial();
+		}
 	}
 	else
 	{
@@ -1160,6 +2152,191 @@ void FSpudSaveData::WriteLevelData(FSpudLevelData& LevelData, const FString& Lev
 	
 }
 
+bool FSpudSaveData::PipeLevelDataToFile(FArchive& Ar, int64 TotalSize, const FString& LevelName, const FString& LevelPath)
+{
+	SPUD_SCOPED_STAT(PipeLevelData);
+	IFileManager& FileMgr = IFileManager::Get();
+	const FString Filename = GetLevelDataPath(LevelPath, LevelName);
+	auto OutLevelArchive = TUniquePtr<FArchive>(FileMgr.CreateFileWriter(*Filename));
+
+	if (!OutLevelArchive)
+	{
+		UE_LOG(LogSpudData, Error, TEXT("Error opening level data file for writing: %s"), *Filename);
+		// Still need to move past the data
+		Ar.Seek(Ar.Tell() + TotalSize);
+		return false;
+	}
+	
+	SpudCopyArchiveData(Ar, *OutLevelArchive.Get(), TotalSize);
+	OutLevelArchive->Close();
+	SPUD_COUNT_BYTES(BytesRead, TotalSize);
+	SPUD_COUNT_BYTES(BytesWritten, TotalSize);
+
+	return !OutLevelArchive->IsError();
+}
+
+void FSpudSaveData::ExtractPendingLevelData(const FString& LevelPath)
+{
+	// Only one level is locked at a time, so anything that needs a level we haven't got to yet just reads it from
+	// the save file itself rather than waiting for us
+	IFileManager& FileMgr = IFileManager::Get();
+	TUniquePtr<FArchive> SourceArchive;
+	FString SourceFilename;
+	for (auto && LevelData : GetLevelDataSnapshot())
+	{
+		FSpudScopeLock LevelLock(&LevelData->Mutex);
+		// Levels restored from a snapshot are already in memory, writing them out would just slow things down
+		if (!LevelData->PendingSource.IsSet() || LevelData->PendingSource.IsInMemory())
+			continue;
+
+		const FSpudLevelDataSource& Src = LevelData->PendingSource;
+		if (!SourceArchive || Src.Filename != SourceFilename)
+		{
+			SourceFilename = Src.Filename;
+			SourceArchive.Reset(FileMgr.CreateFileReader(*SourceFilename));
+		}
+		if (!SourceArchive)
+		{
+			UE_LOG(LogSpudData, Error, TEXT("Unable to open %s to extract level data for %s"), *SourceFilename, *LevelData->Name);
+			continue;
+		}
+
+		SourceArchive->Seek(Src.Offset);
+		if (PipeLevelDataToFile(*SourceArchive, Src.Size, LevelData->Name, LevelPath))
+		{
+			LevelData->PendingSource.Reset();
+			LevelData->CacheFileSerial = FSpudLevelData::NewCacheFileSerial();
+		}
+	}
+	if (SourceArchive)
+		SourceArchive->Close();
+}
+
+FSpudStateSnapshot::Ptr FSpudSaveData::CaptureSnapshot(const FString& Name, const FString& LevelPath,
+                                                       const FSpudStateSnapshot* Previous)
+{
+	SPUD_SCOPED_STAT(CaptureSnapshot);
+	TSharedPtr<FSpudStateSnapshot, ESPMode::ThreadSafe> Snapshot = MakeShared<FSpudStateSnapshot, ESPMode::ThreadSafe>();
+	Snapshot->Name = Name;
+	Snapshot->SharedClasses = SharedClasses;
+
+	PrepareForWrite();
+	{
+		FMemoryWriter Writer(Snapshot->HeaderData);
+		FSpudChunkedDataArchive ChunkedAr(Writer);
+		Info.WriteToArchive(ChunkedAr);
+		GlobalData.WriteToArchive(ChunkedAr);
+	}
+
+	// Same as writing a save, each level is only locked while we're copying it
+	IFileManager& FileMgr = IFileManager::Get();
+	for (auto && LevelData : GetLevelDataSnapshot())
+	{
+		FSpudScopeLock LevelLock(&LevelData->Mutex);
+		FSpudStateSnapshot::FLevel Level;
+		Level.Name = LevelData->Name;
+
+		if (LevelData->Status != LDS_Unloaded)
+		{
+			// In memory (including while waiting for a background write), just write it
+			TSharedRef<TArray<uint8>, ESPMode::ThreadSafe> Data = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>();
+			FMemoryWriter Writer(*Data);
+			FSpudChunkedDataArchive ChunkedAr(Writer);
+			LevelData->WriteToArchive(ChunkedAr);
+			Level.Data = Data;
+		}
+		else if (LevelData->PendingSource.IsInMemory())
+		{
+			// Restored from a snapshot and not changed since
+			Level.Data = LevelData->PendingSource.Memory;
+		}
+		else
+		{
+			// Paged out; if the level file is the same one the last snapshot read, we don't need to read it again
+			const FSpudStateSnapshot::FLevel* PrevLevel = Previous ? Previous->FindLevel(Level.Name) : nullptr;
+			if (!LevelData->PendingSource.IsSet() && LevelData->CacheFileSerial != 0 &&
+				PrevLevel && PrevLevel->CacheFileSerial == LevelData->CacheFileSerial)
+			{
+				Level.Data = PrevLevel->Data;
+				Level.CacheFileSerial = PrevLevel->CacheFileSerial;
+			}
+			else
+			{
+				TUniquePtr<FArchive> Reader;
+				int64 Size = 0;
+				if (LevelData->PendingSource.IsSet())
+				{
+					Reader = LevelData->PendingSource.CreateReader();
+					Size = LevelData->PendingSource.Size;
+				}
+				else
+				{
+					Reader.Reset(FileMgr.CreateFileReader(*GetLevelDataPath(LevelPath, LevelData->Name)));
+					Size = Reader ? Reader->TotalSize() : 0;
+					Level.CacheFileSerial = LevelData->CacheFileSerial;
+				}
+				if (!Reader)
+				{
+					UE_LOG(LogSpudData, Error, TEXT("Unable to read data for level %s, it will be missing from snapshot %s"),
+						*LevelData->Name, *Name);
+					continue;
+				}
+
+				TSharedRef<TArray<uint8>, ESPMode::ThreadSafe> Data = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>();
+				Data->SetNumUninitialized(Size);
+				Reader->Serialize(Data->GetData(), Size);
+				Reader->Close();
+				SPUD_COUNT_BYTES(BytesRead, Size);
+				Level.Data = Data;
+			}
+		}
+		Snapshot->Levels.Add(MoveTemp(Level));
+	}
+
+	return Snapshot;
+}
+
+void FSpudSaveData::RestoreSnapshot(const FSpudStateSnapshot& Snapshot)
+{
+	Reset();
+	if (Snapshot.SharedClasses.IsValid())
+		SharedClasses = Snapshot.SharedClasses;
+
+	{
+		FMemoryReader Reader(Snapshot.HeaderData);
+		FSpudChunkedDataArchive ChunkedAr(Reader);
+		ChunkedAr.bMemoryBacked = true;
+		Info.ReadFromArchive(ChunkedAr, 0);
+		GlobalData.ReadFromArchive(ChunkedAr, Info.SystemVersion);
+	}
+
+	FSpudScopeLock MapMutex(&LevelDataMapMutex);
+	for (auto& Level : Snapshot.Levels)
+	{
+		TLevelDataPtr LvlData(new FSpudLevelData(SharedClasses));
+		LvlData->Name = Level.Name;
+		LvlData->Status = LDS_Unloaded;
+		LvlData->PendingSource.Memory = Level.Data;
+		LvlData->PendingSource.Size = Level.Data->Num();
+		LevelDataMap.Add(LvlData->Key(), LvlData);
+	}
+}
+
+const FSpudStateSnapshot::FLevel* FSpudStateSnapshot::FindLevel(const FString& LevelName) const
+{
+	return Levels.FindByPredicate([&LevelName](const FLevel& Level) { return Level.Name == LevelName; });
+}
+
+int64 FSpudStateSnapshot::GetDataSize() const
+{
+	int64 Ret = HeaderData.Num();
+	for (auto& Level : Levels)
+	{
+		Ret += Level.Data->Num();
+	}
+	return Ret;
+}
+
 bool FSpudSaveData::ReadSaveInfoFromArchive(FSpudChunkedDataArchive& Ar, FSpudSaveInfo& OutInfo)
 {
 	// Read manually, no stateful ChunkStart/End
@@ -1184,79 +2361,307 @@ bool FSpudSaveData::ReadSaveInfoFromArchive(FSpudChunkedDataArchive& Ar, FSpudSa
 }
 
 
-FSpudSaveData::TLevelDataPtr FSpudSaveData::GetLevelData(const FString& LevelName, bool bLoadIfNeeded, const FString& LevelPath)
+/// Skip through the chunks in a container until the class metadata, and read just its user data model version
+static bool ReadUserDataModelVersionFromContainer(FSpudChunkedDataArchive& Ar, const FSpudChunk& Container, int32& OutVersion)
 {
-	TLevelDataPtr Ret;
+	const uint32 MetadataID = FSpudChunkHeader::EncodeMagic(SPUDDATA_METADATA_MAGIC);
+	const uint32 VersionID = FSpudChunkHeader::EncodeMagic(SPUDDATA_VERSIONINFO_MAGIC);
+	while (Container.IsStillInChunk(Ar) && !Ar.IsError())
 	{
-		// Only lock the map while looking up
-		// We get a shared pointer back (threadsafe) and lock its own mutex before changing the instance state
-		FScopeLock MapMutex(&LevelDataMapMutex);
-		const auto Found = LevelDataMap.Find(LevelName);
-		if (Found)
-			Ret = *Found;
+		if (!Ar.NextChunkIs(MetadataID))
+		{
+			Ar.SkipNextChunk();
+			continue;
+		}
+
+		FSpudAdhocWrapperChunk MetadataChunk(SPUDDATA_METADATA_MAGIC);
+		MetadataChunk.ChunkStart(Ar);
+		bool bFound = false;
+		while (!bFound && MetadataChunk.IsStillInChunk(Ar) && !Ar.IsError())
+		{
+			if (Ar.NextChunkIs(VersionID))
+			{
+				FSpudVersionInfo Version;
+				Version.ReadFromArchive(Ar, SPUD_CURRENT_SYSTEM_VERSION);
+				OutVersion = Version.Version;
+				bFound = true;
+			}
+			else
+				Ar.SkipNextChunk();
+		}
+		MetadataChunk.ChunkEnd(Ar);
+		return bFound;
 	}
-	if (Ret.IsValid() && bLoadIfNeeded)
+	return false;
+}
+
+/// Read just the user data model version of the next level chunk, compressed or not, and move past it
+static bool ReadLevelUserDataModelVersion(FSpudChunkedDataArchive& Ar, int32& OutVersion)
+{
+	if (Ar.NextChunkIs(SPUDDATA_COMPRESSEDLEVELDATA_MAGIC))
+	{
+		TArray<uint8> UncompressedData;
+		if (!FSpudLevelData::ReadCompressedFromArchive(Ar, UncompressedData))
+			return false;
+
+		FMemoryReader MemReader(UncompressedData);
+		FSpudChunkedDataArchive MemAr(MemReader);
+		MemAr.bMemoryBacked = true;
+		return ReadLevelUserDataModelVersion(MemAr, OutVersion);
+	}
+
+	FSpudAdhocWrapperChunk LevelChunk(SPUDDATA_LEVELDATA_MAGIC);
+	if (!LevelChunk.ChunkStart(Ar))
+	{
+		Ar.SkipNextChunk();
+		return false;
+	}
+	FString LevelName;
+	Ar << LevelName;
+	const bool bFound = ReadUserDataModelVersionFromContainer(Ar, LevelChunk, OutVersion);
+	LevelChunk.ChunkEnd(Ar);
+	return bFound;
+}
+
+bool FSpudSaveData::ReadIsUserDataModelOutdated(FSpudChunkedDataArchive& Ar, bool& bOutOutdated)
+{
+	bOutOutdated = false;
+
+	FSpudAdhocWrapperChunk SaveChunk(SPUDDATA_SAVEGAME_MAGIC);
+	if (!SaveChunk.ChunkStart(Ar))
+	{
+		UE_LOG(LogSpudData, Error, TEXT("Cannot check versions of save game, file is not a save game"));
+		return false;
+	}
+	if (!Ar.NextChunkIs(SPUDDATA_SAVEINFO_MAGIC))
+	{
+		UE_LOG(LogSpudData, Error, TEXT("Cannot check versions of save game, INFO chunk isn't present at start"));
+		return false;
+	}
+	FSpudSaveInfo SaveInfo;
+	SaveInfo.ReadFromArchive(Ar, 0);
+	if (SaveInfo.SystemVersion != SPUD_CURRENT_SYSTEM_VERSION)
+		return false;
+
+	const uint32 GlobalDataID = FSpudChunkHeader::EncodeMagic(SPUDDATA_GLOBALDATA_MAGIC);
+	const uint32 LevelDataMapID = FSpudChunkHeader::EncodeMagic(SPUDDATA_LEVELDATAMAP_MAGIC);
+	int32 Version;
+	while (!bOutOutdated && SaveChunk.IsStillInChunk(Ar) && !Ar.IsError())
 	{
-		FScopeLock LevelLock(&Ret->Mutex);
-		switch (Ret->Status)
+		if (Ar.NextChunkIs(GlobalDataID))
+		{
+			FSpudAdhocWrapperChunk GlobalDataChunk(SPUDDATA_GLOBALDATA_MAGIC);
+			GlobalDataChunk.ChunkStart(Ar);
+			FString CurrentLevel;
+			Ar << CurrentLevel;
+			if (ReadUserDataModelVersionFromContainer(Ar, GlobalDataChunk, Version))
+				bOutOutdated = Version != GCurrentUserDataModelVersion;
+			GlobalDataChunk.ChunkEnd(Ar);
+		}
+		else if (Ar.NextChunkIs(LevelDataMapID))
 		{
-		case LDS_Unloaded:
+			FSpudAdhocWrapperChunk LevelDataMapChunk(SPUDDATA_LEVELDATAMAP_MAGIC);
+			LevelDataMapChunk.ChunkStart(Ar);
+			while (!bOutOutdated && LevelDataMapChunk.IsStillInChunk(Ar) && !Ar.IsError())
 			{
-				// Load individual level file back into memory
-				IFileManager& FileMgr = IFileManager::Get();
-				const auto Filename = GetLevelDataPath(LevelPath, LevelName);
-				const auto Archive = TUniquePtr<FArchive>(FileMgr.CreateFileReader(*Filename));
+				if (!FSpudLevelData::NextChunkIsLevelData(Ar))
+					Ar.SkipNextChunk();
+				else if (ReadLevelUserDataModelVersion(Ar, Version))
+					bOutOutdated = Version != GCurrentUserDataModelVersion;
+			}
+			LevelDataMapChunk.ChunkEnd(Ar);
+		}
+		else
+			Ar.SkipNextChunk();
+	}
+
+	return !Ar.IsError();
+}
+
+FSpudSaveData::TLevelDataPtr FSpudSaveData::FindLevelData(const FString& LevelName)
+{
+	// Only lock the map while looking up
+	// We get a shared pointer back (threadsafe) and lock its own mutex before changing the instance state
+	FSpudScopeLock MapMutex(&LevelDataMapMutex);
+	const auto Found = LevelDataMap.Find(FName(*LevelName));
+	return Found ? *Found : TLevelDataPtr();
+}
+
+FSpudSaveData::TLevelDataPtr FSpudSaveData::GetLevelData(const FString& LevelName, bool bLoadIfNeeded, const FString& LevelPath)
+{
+	TLevelDataPtr Ret = FindLevelData(LevelName);
+	if (Ret.IsValid() && bLoadIfNeeded)
+	{
+		LoadLevelDataIfNeeded(Ret, GetLevelDataPath(LevelPath, LevelName));
+	}
+
+	return Ret;
+}
+
+TFuture<FSpudSaveData::TLevelDataPtr> FSpudSaveData::GetLevelDataAsync(const FString& LevelName, const FString& LevelPath,
+                                                                       TFunction<void(TLevelDataPtr)> OnLoaded)
+{
+	TLevelDataPtr LevelData = FindLevelData(LevelName);
+
+	// Shortcut when there's nothing to load, without waiting for the lock, someone else (e.g. a background write) may have it
+	bool bReady = !LevelData.IsValid();
+	if (!bReady && LevelData->Mutex.TryLock())
+	{
+		bReady = LevelData->Status == LDS_Loaded;
+		LevelData->Mutex.Unlock();
+	}
+	if (bReady)
+	{
+		if (OnLoaded)
+			OnLoaded(LevelData);
+		TPromise<TLevelDataPtr> Promise;
+		Promise.SetValue(LevelData);
+		return Promise.GetFuture();
+	}
+
+	// Only capture the level data itself, so it doesn't matter if this save data is reset while we're loading
+	const FString Filename = GetLevelDataPath(LevelPath, LevelName);
+	return Async(EAsyncExecution::ThreadPool, [LevelData, Filename, OnLoaded]()
+	{
+		LoadLevelDataIfNeeded(LevelData, Filename);
+		if (OnLoaded)
+			OnLoaded(LevelData);
+		return LevelData;
+	});
+}
 
+void FSpudSaveData::LoadLevelDataIfNeeded(TLevelDataPtr LevelData, const FString& Filename)
+{
+	FSpudScopeLock LevelLock(&LevelData->Mutex);
+	switch (LevelData->Status)
+	{
+	case LDS_Unloaded:
+		{
+			SPUD_SCOPED_STAT(LoadLevelData);
+			if (LevelData->PendingSource.IsSet())
+			{
+				// Not extracted into the level cache yet, read it straight from the save file (or snapshot) instead
+				const FSpudLevelDataSource& Src = LevelData->PendingSource;
+				const auto Archive = Src.CreateReader();
 				if (Archive)
 				{
 					FSpudChunkedDataArchive ChunkedAr(*Archive);
-
-					// We have to assume that leveldata has been upgraded at load time if system version was incorrect
-					Ret->ReadFromArchive(ChunkedAr, SPUD_CURRENT_SYSTEM_VERSION);
+					ChunkedAr.bMemoryBacked = Src.Memory.IsValid();
+					LevelData->ReadFromArchive(ChunkedAr, SPUD_CURRENT_SYSTEM_VERSION);
+					SPUD_COUNT_BYTES(BytesRead, Archive->Tell() - Src.Offset);
 					ChunkedAr.Close();
 
 					if (ChunkedAr.IsError() || ChunkedAr.IsCriticalError())
 					{
-						UE_LOG(LogSpudData, Error, TEXT("Error while loading active game level file from %s"), *Filename);
+						UE_LOG(LogSpudData, Error, TEXT("Error while loading level %s from save file %s"), *LevelData->Name, *Src.Filename);
 					}
 				}
 				else
 				{
-					UE_LOG(LogSpudData, Error, TEXT("Error opening active game level state file %s"), *Filename);
+					UE_LOG(LogSpudData, Error, TEXT("Error opening save file %s to load level %s"), *Src.Filename, *LevelData->Name);
 				}
 				break;
 			}
-		case LDS_BackgroundWriteAndUnload:
-			// Loading in this state is just flipping back to loaded, because all the state is still in memory
-			// We're just waiting for it to be written out and released
-			// By changing the status back to loaded, the background unload task will skip the unload
-			Ret->Status = LDS_Loaded;
-			break;
-		default:
-		case LDS_Loaded:
+			
+			if (GSpudMapLevelFiles)
+			{
+				// Map the file and have actor data point into it rather than copying it all out
+				// Falls back on reading normally if the file can't be mapped
+				auto Mapped = FSpudMappedFile::Open(Filename);
+				if (Mapped.IsValid())
+				{
+					FSpudMemoryViewReader Reader(Mapped->GetView());
+					FSpudChunkedDataArchive ChunkedAr(Reader);
+					ChunkedAr.MappedView = Mapped->GetView();
+					LevelData->ReadFromArchive(ChunkedAr, SPUD_CURRENT_SYSTEM_VERSION);
+					LevelData->MappedFile = Mapped;
+					SPUD_COUNT_BYTES(BytesRead, Mapped->GetView().Num());
+
+					if (ChunkedAr.IsError() || ChunkedAr.IsCriticalError())
+					{
+						UE_LOG(LogSpudData, Error, TEXT("Error while loading active game level file from %s"), *Filename);
+					}
+					break;
+				}
+			}
+
+			// Load individual level file back into memory
+			IFileManager& FileMgr = IFileManager::Get();
+			const auto Archive = TUniquePtr<FArchive>(FileMgr.CreateFileReader(*Filename));
+
+			if (Archive)
+			{
+				FSpudChunkedDataArchive ChunkedAr(*Archive);
+
+				// We have to assume that leveldata has been upgraded at load time if system version was incorrect
+				LevelData->ReadFromArchive(ChunkedAr, SPUD_CURRENT_SYSTEM_VERSION);
+				SPUD_COUNT_BYTES(BytesRead, Archive->Tell());
+				ChunkedAr.Close();
+
+				if (ChunkedAr.IsError() || ChunkedAr.IsCriticalError())
+				{
+					UE_LOG(LogSpudData, Error, TEXT("Error while loading active game level file from %s"), *Filename);
+				}
+			}
+			else
+			{
+				UE_LOG(LogSpudData, Error, TEXT("Error opening active game level state file %s"), *Filename);
+			}
 			break;
 		}
+	case LDS_BackgroundWriteAndUnload:
+		// Loading in this state is just flipping back to loaded, because all the state is still in memory
+		// We're just waiting for it to be written out and released
+		// By changing the status back to loaded, the background unload task will skip the unload
+		LevelData->Status = LDS_Loaded;
+		break;
+	default:
+	case LDS_Loaded:
+		break;
 	}
-
-	return Ret;
 }
 
 
 void FSpudSaveData::WriteAndReleaseAllLevelData(const FString& LevelPath)
 {
-	FScopeLock MapLock(&LevelDataMapMutex);
-	for (auto && Pair : LevelDataMap)
+	// Blocking writes of every level can take a while, so don't hold the map lock for them
+	for (auto && LevelData : GetLevelDataSnapshot())
 	{
-		WriteAndReleaseLevelData(Pair.Key, LevelPath, true);
+		WriteAndReleaseLevelData(LevelData, LevelPath, true);
 	}
 }
 
-bool FSpudSaveData::WriteAndReleaseLevelData(const FString& LevelName, const FString& LevelPath, bool bBlocking)
+TArray<FSpudSaveData::TLevelDataPtr> FSpudSaveData::GetLevelDataSnapshot() const
+{
+	TArray<TLevelDataPtr> Ret;
+	FSpudScopeLock MapLock(&LevelDataMapMutex);
+	LevelDataMap.GenerateValueArray(Ret);
+	return Ret;
+}
+
+void FSpudSaveData::ReleaseUnmodifiedLevelData(const FString& LevelName)
 {
 	auto LevelData = GetLevelData(LevelName, false, "");
 	if (LevelData.IsValid())
 	{
-		FScopeLock LevelLock(&LevelData->Mutex);
+		FSpudScopeLock LevelLock(&LevelData->Mutex);
+		// A pending background write still has to happen, so only plain loaded data can just be dropped
+		if (LevelData->Status == LDS_Loaded)
+			LevelData->ReleaseMemory();
+	}
+}
+
+bool FSpudSaveData::WriteAndReleaseLevelData(const FString& LevelName, const FString& LevelPath, bool bBlocking)
+{
+	return WriteAndReleaseLevelData(GetLevelData(LevelName, false, ""), LevelPath, bBlocking);
+}
+
+bool FSpudSaveData::WriteAndReleaseLevelData(TLevelDataPtr LevelData, const FString& LevelPath, bool bBlocking)
+{
+	if (LevelData.IsValid())
+	{
+		FSpudScopeLock LevelLock(&LevelData->Mutex);
+		const FString LevelName = LevelData->Name;
 		if (LevelData->Status == LDS_Loaded ||
 			// If we've queued a background write & unload but this is now requesting a blocking write, we
 			// should upgrade it and do it NOW. When the status is changed to LDS_Unloaded the background worker will ignore it
@@ -1292,7 +2697,7 @@ bool FSpudSaveData::WriteAndReleaseLevelData(const FString& LevelName, const FSt
                     if (LevelData.IsValid())
                     {
 	                    // Re-acquire lock and check still unloading
-                        FScopeLock LevelLock(&LevelData->Mutex);
+                        FSpudScopeLock LevelLock(&LevelData->Mutex);
                         if (LevelData->Status == LDS_BackgroundWriteAndUnload)
                         {
                             WriteLevelData(*LevelData, LevelName, LevelPath);
@@ -1309,8 +2714,8 @@ bool FSpudSaveData::WriteAndReleaseLevelData(const FString& LevelName, const FSt
 void FSpudSaveData::DeleteLevelData(const FString& LevelName, const FString& LevelPath)
 {
 	{
-		FScopeLock MapMutex(&LevelDataMapMutex);
-		LevelDataMap.Remove(LevelName);
+		FSpudScopeLock MapMutex(&LevelDataMapMutex);
+		LevelDataMap.Remove(FName(*LevelName));
 	}
 
 	IFileManager& FileMgr = IFileManager::Get();
@@ -0,0 +1,412 @@
+#include "SpudPropertyPlan.h"
+
+// Plans are shared by class across all states & levels
+static FCriticalSection GSpudPropertyPlanMutex;
+static TMap<TWeakObjectPtr<const UClass>, FSpudPropertyPlan::Ptr> GSpudPropertyPlans;
+static uint32 GSpudPropertyPlanSerial = 0;
+
+/// Definition-only visitor which flattens the properties of a class into a plan
+class FSpudPropertyPlan::BuildPlanVisitor : public SpudPropertyUtil::PropertyVisitor
+{
+protected:
+	FSpudPropertyPlan& Plan;
+	const UClass* Class;
+	/// Offset of the current container from the root, one per level of struct nesting
+	TArray<int32> ContainerOffsets;
+public:
+	BuildPlanVisitor(FSpudPropertyPlan& InPlan, const UClass* InClass) : Plan(InPlan), Class(InClass)
+	{
+		ContainerOffsets.Add(0);
+	}
+
+	virtual bool VisitProperty(UObject* RootObject, FProperty* Property, uint32 CurrentPrefixID, void* ContainerPtr,
+	                           int Depth) override
+	{
+		// Custom structs have no data of their own, just their nested properties
+		if (SpudPropertyUtil::IsCustomStructProperty(Property))
+			return true;
+
+		// Nested UObjects mean that the properties we store vary per instance, can't plan for that
+		if (SpudPropertyUtil::IsNonActorObjectProperty(Property))
+		{
+			Plan.bValid = false;
+			return false;
+		}
+
+		FSpudPropertyPlanEntry Entry;
+		Entry.Property = Property;
+		Entry.ContainerOffset = ContainerOffsets.Last();
+		Entry.DataType = SpudPropertyUtil::GetPropertyDataType(Property);
+		Entry.Op = GetOp(Property);
+		Entry.PrefixIndex = CurrentPrefixID == SPUDDATA_PREFIXID_NONE ? INDEX_NONE : static_cast<int32>(CurrentPrefixID);
+		Entry.Depth = Depth;
+		Plan.Entries.Add(Entry);
+		return true;
+	}
+
+	virtual void UnsupportedProperty(UObject* RootObject, FProperty* Property, uint32 CurrentPrefixID,
+	                                 int Depth) override
+	{
+		// Only need to say this once per class now, not per instance
+		UE_LOG(LogSpudProps, Error, TEXT("Property %s/%s is marked for save but is an unsupported type, ignoring. E.g. Arrays of custom structs or nested UObjects (other than actor refs) are not supported."),
+			*Class->GetName(), *Property->GetName());
+	}
+
+	virtual uint32 GetNestedPrefix(FProperty* Prop, uint32 CurrentPrefixID) override
+	{
+		// We don't have any metadata to register prefixes against, so prefix IDs are just indexes into our own list
+		// They're converted into real IDs per class definition on use
+		const FString Prefix = CurrentPrefixID == SPUDDATA_PREFIXID_NONE
+			                       ? Prop->GetNameCPP()
+			                       : Plan.Prefixes[CurrentPrefixID] + "/" + Prop->GetNameCPP();
+		return Plan.Prefixes.Add(Prefix);
+	}
+
+	virtual void StartNestedStruct(UObject* RootObject, FStructProperty* SProp, uint32 PrefixID, int Depth) override
+	{
+		ContainerOffsets.Add(ContainerOffsets.Last() + SProp->GetOffset_ForInternal());
+	}
+
+	virtual void EndNestedStruct(UObject* RootObject, FStructProperty* SProp, uint32 PrefixID, int Depth) override
+	{
+		ContainerOffsets.Pop();
+	}
+};
+
+FSpudPropertyPlan::Ptr FSpudPropertyPlan::Get(const UClass* Class)
+{
+	if (!Class)
+		return nullptr;
+
+	FScopeLock Lock(&GSpudPropertyPlanMutex);
+
+	if (const auto Existing = GSpudPropertyPlans.Find(Class))
+	{
+		if ((*Existing)->IsUpToDate(Class))
+			return *Existing;
+	}
+
+	auto Plan = Build(Class);
+	GSpudPropertyPlans.Add(Class, Plan);
+	return Plan;
+}
+
+void FSpudPropertyPlan::InvalidateAll()
+{
+	FScopeLock Lock(&GSpudPropertyPlanMutex);
+	GSpudPropertyPlans.Empty();
+}
+
+FSpudPropertyPlan::Ptr FSpudPropertyPlan::Build(const UClass* Class)
+{
+	// Only ever called with the lock held
+	const auto Plan = MakeShared<FSpudPropertyPlan, ESPMode::ThreadSafe>();
+	Plan->Serial = ++GSpudPropertyPlanSerial;
+	Plan->PropertyLink = Class->PropertyLink;
+	Plan->PropertiesSize = Class->GetPropertiesSize();
+	Plan->bValid = true; // until the visitor finds otherwise
+
+	BuildPlanVisitor Visitor(*Plan, Class);
+	SpudPropertyUtil::VisitPersistentProperties(Class, Visitor);
+
+	if (!Plan->bValid)
+	{
+		Plan->Entries.Empty();
+		Plan->Prefixes.Empty();
+	}
+
+	UE_LOG(LogSpudProps, Verbose, TEXT("Built property plan for %s: %s, %d properties"), *Class->GetName(),
+	       Plan->bValid ? TEXT("valid") : TEXT("not usable"), Plan->Entries.Num());
+
+	return Plan;
+}
+
+bool FSpudPropertyPlan::IsUpToDate(const UClass* Class) const
+{
+	// Blueprint recompiles invalidate the cache explicitly, but this catches other layout changes
+	return PropertyLink == Class->PropertyLink && PropertiesSize == Class->GetPropertiesSize();
+}
+
+ESpudPlanOp FSpudPropertyPlan::GetOp(const FProperty* Prop)
+{
+	if (const auto SProp = CastField<FStructProperty>(Prop))
+	{
+		if (SProp->Struct == TBaseStructure<FVector>::Get())
+			return ESpudPlanOp::Vector;
+		if (SProp->Struct == TBaseStructure<FRotator>::Get())
+			return ESpudPlanOp::Rotator;
+		if (SProp->Struct == TBaseStructure<FTransform>::Get())
+			return ESpudPlanOp::Transform;
+		if (SProp->Struct == TBaseStructure<FGuid>::Get())
+			return ESpudPlanOp::Guid;
+		return ESpudPlanOp::Generic;
+	}
+
+	if (CastField<FBoolProperty>(Prop))
+		return ESpudPlanOp::Bool;
+	if (CastField<FByteProperty>(Prop))
+		return ESpudPlanOp::UInt8;
+	if (CastField<FUInt16Property>(Prop))
+		return ESpudPlanOp::UInt16;
+	if (CastField<FUInt32Property>(Prop))
+		return ESpudPlanOp::UInt32;
+	if (CastField<FUInt64Property>(Prop))
+		return ESpudPlanOp::UInt64;
+	if (CastField<FInt8Property>(Prop))
+		return ESpudPlanOp::Int8;
+	if (CastField<FInt16Property>(Prop))
+		return ESpudPlanOp::Int16;
+	if (CastField<FIntProperty>(Prop))
+		return ESpudPlanOp::Int32;
+	if (CastField<FInt64Property>(Prop))
+		return ESpudPlanOp::Int64;
+	if (CastField<FFloatProperty>(Prop))
+		return ESpudPlanOp::Float;
+	if (CastField<FDoubleProperty>(Prop))
+		return ESpudPlanOp::Double;
+	if (CastField<FStrProperty>(Prop))
+		return ESpudPlanOp::String;
+	if (CastField<FNameProperty>(Prop))
+		return ESpudPlanOp::Name;
+	if (CastField<FEnumProperty>(Prop))
+		return ESpudPlanOp::Enum;
+
+	// Arrays, actor refs
+	return ESpudPlanOp::Generic;
+}
+
+void FSpudPropertyPlan::ResolveClassDef(FSpudClassDef& ClassDef, FSpudClassMetadata& Meta) const
+{
+	// Prefix & property IDs are per metadata, so once per class def we find out which property index each of our
+	// entries corresponds to. After that storing doesn't need any lookups
+	TArray<uint32> PrefixIDs;
+	PrefixIDs.Reserve(Prefixes.Num());
+	for (const auto& Prefix : Prefixes)
+	{
+		PrefixIDs.Add(Meta.FindOrAddPrefixID(Prefix));
+	}
+
+	ClassDef.PlanPropertyIndexes.SetNumUninitialized(Entries.Num());
+	for (int i = 0; i < Entries.Num(); ++i)
+	{
+		const auto& Entry = Entries[i];
+		const uint32 PrefixID = Entry.PrefixIndex == INDEX_NONE ? SPUDDATA_PREFIXID_NONE : PrefixIDs[Entry.PrefixIndex];
+		const uint32 PropID = Meta.FindOrAddPropertyIDFromProperty(Entry.Property);
+		ClassDef.PlanPropertyIndexes[i] = ClassDef.FindOrAddPropertyIndex(PropID, PrefixID, Entry.DataType);
+	}
+	ClassDef.PlanSerial = Serial;
+}
+
+template <typename T>
+static void WritePlanValue(const void* Data, FArchive& Out)
+{
+	// Copy because << can read as well and incoming data is const
+	T Val = *static_cast<const T*>(Data);
+	Out << Val;
+}
+
+template <typename T>
+static void ReadPlanValue(void* Data, FArchive& In)
+{
+	In << *static_cast<T*>(Data);
+}
+
+void FSpudPropertyPlan::Store(const UObject* RootObject, FSpudClassDef& ClassDef, TArray<uint32>& PropertyOffsets,
+                              FSpudClassMetadata& Meta, FMemoryWriter& Out) const
+{
+	if (ClassDef.PlanSerial != Serial)
+		ResolveClassDef(ClassDef, Meta);
+
+	const uint8* Base = reinterpret_cast<const uint8*>(RootObject);
+	for (int i = 0; i < Entries.Num(); ++i)
+	{
+		const auto& Entry = Entries[i];
+		const int PropIndex = ClassDef.PlanPropertyIndexes[i];
+
+		// Equivalent of SpudPropertyUtil::RegisterProperty, without the lookups
+		if (PropertyOffsets.Num() < PropIndex + 1)
+			PropertyOffsets.SetNum(PropIndex + 1);
+		PropertyOffsets[PropIndex] = Out.Tell();
+
+		const void* ContainerPtr = Base + Entry.ContainerOffset;
+		const void* Data = Entry.Property->ContainerPtrToValuePtr<void>(ContainerPtr);
+		// The encoding of each of these must match SpudPropertyUtil::StoreContainerProperty
+		switch (Entry.Op)
+		{
+		case ESpudPlanOp::Bool:
+			{
+				uint8 Val = static_cast<const FBoolProperty*>(Entry.Property)->GetPropertyValue(Data);
+				Out << Val;
+				break;
+			}
+		case ESpudPlanOp::UInt8: WritePlanValue<uint8>(Data, Out); break;
+		case ESpudPlanOp::UInt16: WritePlanValue<uint16>(Data, Out); break;
+		case ESpudPlanOp::UInt32: WritePlanValue<uint32>(Data, Out); break;
+		case ESpudPlanOp::UInt64: WritePlanValue<uint64>(Data, Out); break;
+		case ESpudPlanOp::Int8: WritePlanValue<int8>(Data, Out); break;
+		case ESpudPlanOp::Int16: WritePlanValue<int16>(Data, Out); break;
+		case ESpudPlanOp::Int32: WritePlanValue<int32>(Data, Out); break;
+		case ESpudPlanOp::Int64: WritePlanValue<int64>(Data, Out); break;
+		case ESpudPlanOp::Float: WritePlanValue<float>(Data, Out); break;
+		case ESpudPlanOp::Double: WritePlanValue<double>(Data, Out); break;
+		case ESpudPlanOp::String: WritePlanValue<FString>(Data, Out); break;
+		case ESpudPlanOp::Name: WritePlanValue<FName>(Data, Out); break;
+		case ESpudPlanOp::Vector: WritePlanValue<FVector>(Data, Out); break;
+		case ESpudPlanOp::Rotator: WritePlanValue<FRotator>(Data, Out); break;
+		case ESpudPlanOp::Transform: WritePlanValue<FTransform>(Data, Out); break;
+		case ESpudPlanOp::Guid: WritePlanValue<FGuid>(Data, Out); break;
+		case ESpudPlanOp::Enum:
+			{
+				// Enums as 16-bit numbers
+				uint16 Val = static_cast<const FEnumProperty*>(Entry.Property)->GetUnderlyingProperty()->GetUnsignedIntPropertyValue(Data);
+				Out << Val;
+				break;
+			}
+		case ESpudPlanOp::Generic:
+		default:
+			{
+				// Already registered above
+				const uint32 PrefixID = ClassDef.Properties[PropIndex].PrefixID;
+				if (const auto AProp = CastField<FArrayProperty>(Entry.Property))
+				{
+					SpudPropertyUtil::StoreArrayProperty(AProp, RootObject, PrefixID, ContainerPtr, Entry.Depth, ClassDef,
+					                                     PropertyOffsets, Meta, Out, PropIndex);
+				}
+				else
+				{
+					SpudPropertyUtil::StoreContainerProperty(Entry.Property, RootObject, PrefixID, ContainerPtr, true,
+					                                         Entry.Depth, ClassDef, PropertyOffsets, Meta, Out, PropIndex);
+				}
+				break;
+			}
+		}
+	}
+}
+
+bool FSpudPropertyPlan::CanRestore(const FSpudClassDef& ClassDef, const FSpudClassMetadata& Meta) const
+{
+	return bValid &&
+		ClassDef.Properties.Num() == Entries.Num() &&
+		ClassDef.MatchesRuntimeClass(Meta);
+}
+
+/// Read a single plan entry. If bDirect is false (the stored type isn't exactly the runtime type), it goes through the
+/// general SpudPropertyUtil functions, which deal with conversions
+static void RestorePlanEntry(const FSpudPropertyPlanEntry& Entry, UObject* RootObject, uint8* Base,
+                             const FSpudPropertyDef& StoredProperty, bool bDirect, const FSpudClassMetadata& Meta,
+                             const SpudPropertyUtil::RuntimeObjectMap* RuntimeObjects, FArchive& In)
+{
+	void* ContainerPtr = Base + Entry.ContainerOffset;
+	void* Data = Entry.Property->ContainerPtrToValuePtr<void>(ContainerPtr);
+	switch (bDirect ? Entry.Op : ESpudPlanOp::Generic)
+	{
+	case ESpudPlanOp::Bool:
+		{
+			uint8 Val;
+			In << Val;
+			static_cast<const FBoolProperty*>(Entry.Property)->SetPropertyValue(Data, Val != 0);
+			break;
+		}
+	case ESpudPlanOp::UInt8: ReadPlanValue<uint8>(Data, In); break;
+	case ESpudPlanOp::UInt16: ReadPlanValue<uint16>(Data, In); break;
+	case ESpudPlanOp::UInt32: ReadPlanValue<uint32>(Data, In); break;
+	case ESpudPlanOp::UInt64: ReadPlanValue<uint64>(Data, In); break;
+	case ESpudPlanOp::Int8: ReadPlanValue<int8>(Data, In); break;
+	case ESpudPlanOp::Int16: ReadPlanValue<int16>(Data, In); break;
+	case ESpudPlanOp::Int32: ReadPlanValue<int32>(Data, In); break;
+	case ESpudPlanOp::Int64: ReadPlanValue<int64>(Data, In); break;
+	case ESpudPlanOp::Float: ReadPlanValue<float>(Data, In); break;
+	case ESpudPlanOp::Double: ReadPlanValue<double>(Data, In); break;
+	case ESpudPlanOp::String: ReadPlanValue<FString>(Data, In); break;
+	case ESpudPlanOp::Name: ReadPlanValue<FName>(Data, In); break;
+	case ESpudPlanOp::Vector: ReadPlanValue<FVector>(Data, In); break;
+	case ESpudPlanOp::Rotator: ReadPlanValue<FRotator>(Data, In); break;
+	case ESpudPlanOp::Transform: ReadPlanValue<FTransform>(Data, In); break;
+	case ESpudPlanOp::Guid: ReadPlanValue<FGuid>(Data, In); break;
+	case ESpudPlanOp::Enum:
+		{
+			uint16 Val;
+			In << Val;
+			static_cast<const FEnumProperty*>(Entry.Property)->GetUnderlyingProperty()->SetIntPropertyValue(Data, static_cast<uint64>(Val));
+			break;
+		}
+	case ESpudPlanOp::Generic:
+	default:
+		SpudPropertyUtil::RestoreProperty(RootObject, Entry.Property, ContainerPtr, StoredProperty,
+		                                  RuntimeObjects, Meta, In);
+		break;
+	}
+}
+
+void FSpudPropertyPlan::Restore(UObject* RootObject, const FSpudClassDef& ClassDef, const FSpudClassMetadata& Meta,
+                                const SpudPropertyUtil::RuntimeObjectMap* RuntimeObjects, FArchive& In) const
+{
+	// Because the stored class def matches the runtime class, stored properties are in the same order as our entries,
+	// and are of the same type
+	uint8* Base = reinterpret_cast<uint8*>(RootObject);
+	for (int i = 0; i < Entries.Num(); ++i)
+	{
+		RestorePlanEntry(Entries[i], RootObject, Base, ClassDef.Properties[i], true, Meta, RuntimeObjects, In);
+	}
+}
+
+void FSpudPropertyPlan::ResolveRemap(const FSpudClassDef& ClassDef, const FSpudClassMetadata& Meta) const
+{
+	// Same lookups as RestoreSlowPropertyVisitor, but once per class def rather than for every instance
+	TArray<uint32> PrefixIDs;
+	PrefixIDs.Reserve(Prefixes.Num());
+	for (const auto& Prefix : Prefixes)
+	{
+		PrefixIDs.Add(Meta.GetPropertyIDFromName(Prefix));
+	}
+
+	ClassDef.RemapPropertyIndexes.SetNumUninitialized(Entries.Num());
+	ClassDef.RemapTypeMatches.SetNumUninitialized(Entries.Num());
+	for (int i = 0; i < Entries.Num(); ++i)
+	{
+		const auto& Entry = Entries[i];
+		int Index = -1;
+		const uint32 PrefixID = Entry.PrefixIndex == INDEX_NONE ? SPUDDATA_PREFIXID_NONE : PrefixIDs[Entry.PrefixIndex];
+		const uint32 PropID = Meta.GetPropertyIDFromName(Entry.Property->GetNameCPP());
+		// A missing prefix means the whole nested struct is new
+		if (PropID != SPUDDATA_INDEX_NONE && (Entry.PrefixIndex == INDEX_NONE || PrefixID != SPUDDATA_INDEX_NONE))
+		{
+			if (const auto InnerMap = ClassDef.PropertyLookup.Find(PrefixID))
+			{
+				if (const int* Found = InnerMap->Find(PropID))
+					Index = ClassDef.Properties.IsValidIndex(*Found) ? *Found : -1;
+			}
+		}
+		if (Index == -1)
+		{
+			UE_LOG(LogSpudProps, Verbose, TEXT("Property %s on class %s not found in stored class definition, will not be restored"),
+			       *Entry.Property->GetName(), *ClassDef.ClassName);
+		}
+
+		ClassDef.RemapPropertyIndexes[i] = Index;
+		ClassDef.RemapTypeMatches[i] = Index != -1 && ClassDef.Properties[Index].DataType == Entry.DataType;
+	}
+	ClassDef.RemapPlanSerial = Serial;
+}
+
+void FSpudPropertyPlan::RestoreRemapped(UObject* RootObject, const FSpudClassDef& ClassDef,
+                                        const FSpudClassMetadata& Meta,
+                                        const SpudPropertyUtil::RuntimeObjectMap* RuntimeObjects,
+                                        const TArray<uint32>& PropertyOffsets, FArchive& In) const
+{
+	if (ClassDef.RemapPlanSerial != Serial)
+		ResolveRemap(ClassDef, Meta);
+
+	// Stored properties aren't in our order, so jump to each one through the instance's offsets
+	uint8* Base = reinterpret_cast<uint8*>(RootObject);
+	for (int i = 0; i < Entries.Num(); ++i)
+	{
+		const int StoredIndex = ClassDef.RemapPropertyIndexes[i];
+		if (StoredIndex == -1 || !PropertyOffsets.IsValidIndex(StoredIndex))
+			continue;
+
+		In.Seek(PropertyOffsets[StoredIndex]);
+		RestorePlanEntry(Entries[i], RootObject, Base, ClassDef.Properties[StoredIndex],
+		                 ClassDef.RemapTypeMatches[i], Meta, RuntimeObjects, In);
+	}
+}
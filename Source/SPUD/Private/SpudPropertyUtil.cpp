@@ -1,6 +1,7 @@
 #include "SpudPropertyUtil.h"
 #include <limits>
 #include "ISpudObject.h"
+#include "Engine/Level.h"
 
 DEFINE_LOG_CATEGORY(LogSpudProps)
 
@@ -118,11 +119,11 @@ uint16 SpudPropertyUtil::GetPropertyDataType(const FProperty* Prop)
 		// 1. An Actor ref
 		// 2. A nested UObject
 		
-		// Actor ref properties just have a string, which is either a name or a GUID, both strings
+		// Actor ref properties are a tag & a GUID or name index (older data has a string, either a name or a GUID)
 		// Nested UObjects are a ClassID (uint32)
 		if (IsActorObjectProperty(ActualProp))
 		{
-			Ret = SpudTypeInfo<AActor*>::EnumType;
+			Ret = SpudTypeInfo<AActor*>::EnumType | ESST_PackedActorRef;
 		}
 		else
 		{
@@ -164,12 +165,41 @@ uint16 SpudPropertyUtil::GetPropertyDataType(const FProperty* Prop)
 
 	if (bIsArray)
 	{
-		Ret |= ESST_ArrayOf;
+		// All new arrays use the large encoding
+		Ret |= ESST_ArrayOf | ESST_LargeArrayOf;
 	}
 	return Ret;
 	
 }
 
+bool SpudPropertyUtil::CanBlockCopyArrayElements(const FProperty* Inner)
+{
+	// Enums are converted to uint16, and FTransform has padding / a different layout in memory, so those can't be
+	// copied. Every other numeric type & simple struct serialises exactly as it's laid out in memory.
+	if (const auto SProp = CastField<FStructProperty>(Inner))
+	{
+		return SProp->Struct == TBaseStructure<FVector>::Get() ||
+			SProp->Struct == TBaseStructure<FRotator>::Get() ||
+			SProp->Struct == TBaseStructure<FGuid>::Get();
+	}
+	if (const auto BProp = CastField<FBoolProperty>(Inner))
+	{
+		// Bools in arrays are always native, but just in case; stored as uint8 which is the same as native bool
+		return BProp->IsNativeBool() && BProp->ElementSize == sizeof(uint8);
+	}
+
+	return CastField<FByteProperty>(Inner) ||
+		CastField<FUInt16Property>(Inner) ||
+		CastField<FUInt32Property>(Inner) ||
+		CastField<FUInt64Property>(Inner) ||
+		CastField<FInt8Property>(Inner) ||
+		CastField<FInt16Property>(Inner) ||
+		CastField<FIntProperty>(Inner) ||
+		CastField<FInt64Property>(Inner) ||
+		CastField<FFloatProperty>(Inner) ||
+		CastField<FDoubleProperty>(Inner);
+}
+
 FString SpudPropertyUtil::GetNestedPrefix(uint32 PrefixIDSoFar, FProperty* Prop, const FSpudClassMetadata& Meta)
 {
 	return (PrefixIDSoFar == SPUDDATA_PREFIXID_NONE) ? Prop->GetNameCPP() :
@@ -190,22 +220,23 @@ uint32 SpudPropertyUtil::GetNestedPrefixID(uint32 PrefixIDSoFar, FProperty* Prop
 	
 }
 
-void SpudPropertyUtil::RegisterProperty(uint32 PropNameID, uint32 PrefixID, uint16 DataType, FSpudClassDef& ClassDef,
+int SpudPropertyUtil::RegisterProperty(uint32 PropNameID, uint32 PrefixID, uint16 DataType, FSpudClassDef& ClassDef,
                                             TArray<uint32>& PropertyOffsets, FArchive& Out)
 {
 	const int Index = ClassDef.FindOrAddPropertyIndex(PropNameID, PrefixID, DataType);
 	if (PropertyOffsets.Num() < Index + 1)
 		PropertyOffsets.SetNum(Index + 1);
 	PropertyOffsets[Index] = Out.Tell();
+	return Index;
 }
 
-void SpudPropertyUtil::RegisterProperty(const FString& Name, uint32 PrefixID, uint16 DataType, FSpudClassDef& ClassDef,
+int SpudPropertyUtil::RegisterProperty(const FString& Name, uint32 PrefixID, uint16 DataType, FSpudClassDef& ClassDef,
     TArray<uint32>& PropertyOffsets, FSpudClassMetadata& Meta, FArchive& Out)
 {
 	return RegisterProperty(Meta.FindOrAddPropertyIDFromName(Name), PrefixID, DataType, ClassDef, PropertyOffsets, Out);
 }
 
-void SpudPropertyUtil::RegisterProperty(FProperty* Prop, uint32 PrefixID, FSpudClassDef& ClassDef,
+int SpudPropertyUtil::RegisterProperty(FProperty* Prop, uint32 PrefixID, FSpudClassDef& ClassDef,
     TArray<uint32>& PropertyOffsets, FSpudClassMetadata& Meta, FArchive& Out)
 {
 	return RegisterProperty(Meta.FindOrAddPropertyIDFromProperty(Prop), PrefixID, GetPropertyDataType(Prop), ClassDef, PropertyOffsets, Out);
@@ -353,14 +384,20 @@ bool SpudPropertyUtil::TryReadEnumPropertyData(FProperty* Prop, void* Data,
 	return false;
 }
 
-FString SpudPropertyUtil::WriteActorRefPropertyData(FObjectProperty* OProp, AActor* Actor, uint32 PrefixID, const void* Data,
+void SpudPropertyUtil::WriteActorRefPropertyData(FObjectProperty* OProp, AActor* Actor, uint32 PrefixID, const void* Data,
 	bool bIsArrayElement, FSpudClassDef& ClassDef, TArray<uint32>& PropertyOffsets, FSpudClassMetadata& Meta,
-	FArchive& Out)
+	FArchive& Out, int RegisteredIndex)
 {
-	if (!bIsArrayElement)
+	const int Index = bIsArrayElement ? RegisteredIndex :
 		RegisterProperty(OProp, PrefixID, ClassDef, PropertyOffsets, Meta, Out);
-
-	FString RefString;
+	// Like arrays, we write whichever encoding the class def says, which is packed for anything registered in this
+	// session, but class defs loaded from older data use strings
+	const bool bPacked = ensureMsgf(ClassDef.Properties.IsValidIndex(Index), TEXT("Actor reference %s written without its property index"), *OProp->GetName()) &&
+		(ClassDef.Properties[Index].DataType & ESST_PackedActorRef) != 0;
+
+	ESpudActorRefTag Tag = ESpudActorRefTag::None;
+	FGuid Guid;
+	FString LevelActorName;
 	// We already have the Actor so no need to get property value
 	if (Actor)
 	{
@@ -373,34 +410,58 @@ FString SpudPropertyUtil::WriteActorRefPropertyData(FObjectProperty* OProp, AAct
 				UE_LOG(LogSpudProps, Error, TEXT("Object reference %s/%s points to runtime Actor %s but that actor has no SpudGuid property, will not be saved."),
                     *ClassDef.ClassName, *OProp->GetName(), *Actor->GetName());
 				// This essentially becomes a null reference
-				RefString = FString();				
 			}
 			else
 			{
-				FGuid Guid = GetGuidProperty(Actor, GuidProperty);
+				Guid = GetGuidProperty(Actor, GuidProperty);
 				if (!Guid.IsValid())
 				{
-					// We automatically generate a Guid for any referenced object if it doesn't have one already
-					Guid = FGuid::NewGuid();
-					SetGuidProperty(Actor, GuidProperty, Guid);
+					// Property data for several levels can be encoded at once (USpudState::StoreLevels), and they
+					// may refer to the same actor, so only one of them should assign its Guid
+					static FCriticalSection GuidMutex;
+					FScopeLock GuidLock(&GuidMutex);
+					Guid = GetGuidProperty(Actor, GuidProperty);
+					if (!Guid.IsValid())
+					{
+						// We automatically generate a Guid for any referenced object if it doesn't have one already
+						Guid = FGuid::NewGuid();
+						SetGuidProperty(Actor, GuidProperty, Guid);
+					}
 				}
-				// We write the GUID as {00000000-0000-0000-0000-000000000000} format so that it's easy to detect when loading
-				// vs an object name (first char is open brace)
-				RefString = Guid.ToString(EGuidFormats::DigitsWithHyphensInBraces);
+				Tag = ESpudActorRefTag::RuntimeGuid;
 			}
 		}
 		else
 		{
 			// References to level actors uses their unique name (so no need for a SpudGuid property)
-			RefString = GetLevelActorName(Actor);
+			LevelActorName = GetLevelActorName(Actor);
+			Tag = ESpudActorRefTag::LevelActor;
+		}
+	}
+
+	if (bPacked)
+	{
+		uint8 TagByte = static_cast<uint8>(Tag);
+		Out << TagByte;
+		if (Tag == ESpudActorRefTag::RuntimeGuid)
+		{
+			Out << Guid;
+		}
+		else if (Tag == ESpudActorRefTag::LevelActor)
+		{
+			// Names go in a table, since the same actors tend to be referred to many times
+			uint32 NameIndex = Meta.ActorNameIndex.FindOrAddIndex(LevelActorName);
+			Out << NameIndex;
 		}
-			
 	}
 	else
-		RefString = FString();
-	
-	Out << RefString;
-	return RefString;
+	{
+		// We write the GUID as {00000000-0000-0000-0000-000000000000} format so that it's easy to detect when loading
+		// vs an object name (first char is open brace)
+		FString RefString = Tag == ESpudActorRefTag::RuntimeGuid ? Guid.ToString(EGuidFormats::DigitsWithHyphensInBraces) :
+			Tag == ESpudActorRefTag::LevelActor ? LevelActorName : FString();
+		Out << RefString;
+	}
 }
 
 FString SpudPropertyUtil::WriteNestedUObjectPropertyData(FObjectProperty* OProp, UObject* UObj, uint32 PrefixID, const void* Data,
@@ -430,7 +491,7 @@ FString SpudPropertyUtil::WriteNestedUObjectPropertyData(FObjectProperty* OProp,
 
 bool SpudPropertyUtil::TryWriteUObjectPropertyData(FProperty* Property, uint32 PrefixID, const void* Data,
 	bool bIsArrayElement, int Depth, FSpudClassDef& ClassDef, TArray<uint32>& PropertyOffsets,
-	FSpudClassMetadata& Meta, FArchive& Out)
+	FSpudClassMetadata& Meta, FArchive& Out, int RegisteredIndex)
 {
 	if (const auto OProp = CastField<FObjectProperty>(Property))
 	{
@@ -441,9 +502,9 @@ bool SpudPropertyUtil::TryWriteUObjectPropertyData(FProperty* Property, uint32 P
 		if (IsActorObjectProperty(Property))
 		{
 			const auto Actor = Cast<AActor>(Obj);			
-			const FString Val = WriteActorRefPropertyData(OProp, Actor, PrefixID, Data, bIsArrayElement, ClassDef,
-														PropertyOffsets, Meta, Out);
-			UE_LOG(LogSpudProps, Verbose, TEXT("|%s %s = %s"), *Prefix, *OProp->GetNameCPP(), *ToString(Val));
+			WriteActorRefPropertyData(OProp, Actor, PrefixID, Data, bIsArrayElement, ClassDef, PropertyOffsets, Meta,
+			                          Out, RegisteredIndex);
+			UE_LOG(LogSpudProps, Verbose, TEXT("|%s %s = %s"), *Prefix, *OProp->GetNameCPP(), *GetNameSafe(Actor));
 		}
 		else
 		{
@@ -459,10 +520,119 @@ bool SpudPropertyUtil::TryWriteUObjectPropertyData(FProperty* Property, uint32 P
 }
 
 
-FString SpudPropertyUtil::ReadActorRefPropertyData(FObjectProperty* OProp, void* Data,
-                                                         const RuntimeObjectMap* RuntimeObjects,
-                                                         ULevel* Level,
-                                                         FArchive& In)
+void SpudPropertyUtil::RuntimeObjectMap::AddLevelActors(const ULevel* Level)
+{
+	LevelActorsByName.Reserve(LevelActorsByName.Num() + Level->Actors.Num());
+	for (auto Actor : Level->Actors)
+	{
+		if (Actor)
+			LevelActorsByName.Add(Actor->GetFName(), Actor);
+	}
+}
+
+void SpudPropertyUtil::RuntimeObjectMap::ResolveActorNames(const FSpudClassMetadata& Meta, ULevel* Level)
+{
+	ActorNameMeta = &Meta;
+	const auto& Names = Meta.ActorNameIndex.UniqueValues;
+	ActorsByNameIndex.SetNumUninitialized(Names.Num());
+	for (int32 i = 0; i < Names.Num(); ++i)
+	{
+		ActorsByNameIndex[i] = FindLevelActor(this, Level, Names[i]);
+	}
+}
+
+AActor* SpudPropertyUtil::RuntimeObjectMap::FindLevelActor(const RuntimeObjectMap* Map, ULevel* Level,
+                                                           const FSpudClassMetadata& Meta, uint32 NameIndex)
+{
+	if (Map && Map->ActorNameMeta == &Meta && NameIndex < static_cast<uint32>(Map->ActorsByNameIndex.Num()))
+		return Map->ActorsByNameIndex[NameIndex];
+
+	if (NameIndex >= static_cast<uint32>(Meta.ActorNameIndex.UniqueValues.Num()))
+		return nullptr;
+	return FindLevelActor(Map, Level, Meta.ActorNameIndex.GetValue(NameIndex));
+}
+
+AActor* SpudPropertyUtil::RuntimeObjectMap::FindLevelActor(const RuntimeObjectMap* Map, ULevel* Level, const FString& Name)
+{
+	if (Map && Map->LevelActorsByName.Num() > 0)
+	{
+		// FNAME_Find so we don't add names that don't exist; if the name doesn't exist neither can the actor
+		const FName ActorName(*Name, FNAME_Find);
+		if (ActorName.IsNone())
+			return nullptr;
+		if (auto Actor = Map->LevelActorsByName.FindRef(ActorName))
+			return Actor;
+	}
+
+	return Cast<AActor>(StaticFindObject(AActor::StaticClass(), Level, *Name));
+}
+
+UObject* SpudPropertyUtil::ReadActorRefPropertyData(FObjectProperty* OProp, void* Data,
+                                                    const FSpudPropertyDef& StoredProperty,
+                                                    const RuntimeObjectMap* RuntimeObjects,
+                                                    ULevel* Level,
+                                                    const FSpudClassMetadata& Meta,
+                                                    FArchive& In)
+{
+	if ((StoredProperty.DataType & ESST_PackedActorRef) == 0)
+		return ReadActorRefStringPropertyData(OProp, Data, RuntimeObjects, Level, In);
+
+	uint8 TagByte;
+	In << TagByte;
+	switch (static_cast<ESpudActorRefTag>(TagByte))
+	{
+	case ESpudActorRefTag::None:
+		OProp->SetObjectPropertyValue(Data, nullptr);
+		break;
+	case ESpudActorRefTag::RuntimeGuid:
+		{
+			FGuid Guid;
+			In << Guid;
+			if (RuntimeObjects)
+			{
+				if (const auto ObjPtr = RuntimeObjects->ByGuid.Find(Guid))
+				{
+					OProp->SetObjectPropertyValue(Data, *ObjPtr);
+					return *ObjPtr;
+				}
+				UE_LOG(LogSpudProps, Error, TEXT("Could not locate runtime object for property %s, GUID was %s"), *OProp->GetName(), *Guid.ToString());
+			}
+			else
+				UE_LOG(LogSpudProps, Error, TEXT("Found property reference to runtime object %s->%s but no RuntimeObjects passed (global object?)"), *OProp->GetName(), *Guid.ToString());
+			break;
+		}
+	case ESpudActorRefTag::LevelActor:
+		{
+			uint32 NameIndex;
+			In << NameIndex;
+			if (Level)
+			{
+				if (const auto Obj = RuntimeObjectMap::FindLevelActor(RuntimeObjects, Level, Meta, NameIndex))
+				{
+					OProp->SetObjectPropertyValue(Data, Obj);
+					return Obj;
+				}
+				UE_LOG(LogSpudProps, Error, TEXT("Could not locate level object for property %s, name was %s"), *OProp->GetName(),
+					NameIndex < static_cast<uint32>(Meta.ActorNameIndex.UniqueValues.Num()) ? *Meta.ActorNameIndex.GetValue(NameIndex) : TEXT("missing"));	
+			}
+			else
+			{
+				UE_LOG(LogSpudProps, Error, TEXT("Level object for property %s cannot be resolved, null parent Level"), *OProp->GetName());	
+			}
+			break;
+		}
+	default:
+		UE_LOG(LogSpudProps, Error, TEXT("Unknown actor reference type %d for property %s, data is corrupt"), TagByte, *OProp->GetName());
+		In.SetError();
+		break;
+	}
+	return nullptr;
+}
+
+UObject* SpudPropertyUtil::ReadActorRefStringPropertyData(FObjectProperty* OProp, void* Data,
+                                                          const RuntimeObjectMap* RuntimeObjects,
+                                                          ULevel* Level,
+                                                          FArchive& In)
 {
 	FString RefString;
 	In << RefString;
@@ -481,10 +651,11 @@ FString SpudPropertyUtil::ReadActorRefPropertyData(FObjectProperty* OProp, void*
 			FGuid Guid;
 			if (FGuid::ParseExact(RefString, EGuidFormats::DigitsWithHyphensInBraces, Guid))
 			{
-				auto ObjPtr = RuntimeObjects->Find(Guid);
+				auto ObjPtr = RuntimeObjects->ByGuid.Find(Guid);
 				if (ObjPtr)
 				{
 					OProp->SetObjectPropertyValue(Data, *ObjPtr);
+					return *ObjPtr;
 				}
 				else
 				{
@@ -504,10 +675,11 @@ FString SpudPropertyUtil::ReadActorRefPropertyData(FObjectProperty* OProp, void*
 		// Level object, identified by name. Level is the package
 		if (Level)
 		{
-			auto Obj = StaticFindObject(AActor::StaticClass(), Level, *RefString);
+			auto Obj = RuntimeObjectMap::FindLevelActor(RuntimeObjects, Level, RefString);
 			if (Obj)
 			{
 				OProp->SetObjectPropertyValue(Data, Obj);
+				return Obj;
 			}
 			else
 			{
@@ -520,7 +692,7 @@ FString SpudPropertyUtil::ReadActorRefPropertyData(FObjectProperty* OProp, void*
 		}
 		
 	}
-	return RefString;
+	return nullptr;
 }
 
 FString SpudPropertyUtil::ReadNestedUObjectPropertyData(FObjectProperty* OProp, void* Data,
@@ -578,8 +750,8 @@ bool SpudPropertyUtil::TryReadUObjectPropertyData(FProperty* Prop, void* Data,
 		// Nullrefs are OK, but if valid we need to check it's an Actor
 		if (IsActorObjectProperty(Prop))
 		{
-			const FString Val = ReadActorRefPropertyData(OProp, Data, RuntimeObjects, Level, In);
-			UE_LOG(LogSpudProps, Verbose, TEXT(" READ %s = %s"), *Prop->GetNameCPP(), *Val);
+			const UObject* Val = ReadActorRefPropertyData(OProp, Data, StoredProperty, RuntimeObjects, Level, Meta, In);
+			UE_LOG(LogSpudProps, Verbose, TEXT(" READ %s = %s"), *Prop->GetNameCPP(), *GetNameSafe(Val));
 		}
 		else
 		{
@@ -613,7 +785,7 @@ void SpudPropertyUtil::StoreArrayProperty(FArrayProperty* AProp, const UObject*
                                                    const void* ContainerPtr,
                                                    int Depth, FSpudClassDef& ClassDef,
                                                    TArray<uint32>& PropertyOffsets, FSpudClassMetadata& Meta,
-                                                   FMemoryWriter& Out)
+                                                   FMemoryWriter& Out, int RegisteredIndex)
 {
 	
 	// Use helper to get number, ArrayDim doesn't seem to work?
@@ -621,21 +793,50 @@ void SpudPropertyUtil::StoreArrayProperty(FArrayProperty* AProp, const UObject*
 	FScriptArrayHelper ArrayHelper(AProp, DataPtr);
 	const int32 NumElements = ArrayHelper.Num();
 
-	if (NumElements > std::numeric_limits<uint16>::max())
-	{
-		UE_LOG(LogSpudProps, Error, TEXT("Array property %s/%s has %d elements, exceeds maximum of %d, will be truncated"),
-			*RootObject->GetName(), *AProp->GetName(), NumElements, std::numeric_limits<uint16>::max());
-	}
+	// Caller may have registered already (property plans)
+	const int Index = RegisteredIndex == INDEX_NONE
+		                  ? RegisterProperty(AProp, PrefixID, ClassDef, PropertyOffsets, Meta, Out)
+		                  : RegisteredIndex;
 
-	RegisterProperty(AProp, PrefixID, ClassDef, PropertyOffsets, Meta, Out);
+	// We write whichever encoding the class def says, which for anything registered in this session is the large
+	// encoding, but may not be for class defs loaded from older data (other instances may be using it)
+	const bool bLargeArray = (ClassDef.Properties[Index].DataType & ESST_LargeArrayOf) != 0;
+	int32 NumToWrite = NumElements;
 	
 	// Data is count first, then elements
-	uint16 ShortElems = static_cast<uint16>(NumElements);
-	Out << ShortElems;
-	for (int ArrayElem = 0; ArrayElem < NumElements; ++ArrayElem)
+	if (bLargeArray)
+	{
+		uint32 Elems = static_cast<uint32>(NumElements);
+		Out << Elems;
+	}
+	else
+	{
+		if (NumElements > std::numeric_limits<uint16>::max())
+		{
+			UE_LOG(LogSpudProps, Error, TEXT("Array property %s/%s has %d elements, exceeds maximum of %d in this older data, will be truncated"),
+				*RootObject->GetName(), *AProp->GetName(), NumElements, std::numeric_limits<uint16>::max());
+			NumToWrite = std::numeric_limits<uint16>::max();
+		}
+		uint16 ShortElems = static_cast<uint16>(NumToWrite);
+		Out << ShortElems;
+	}
+
+	if (NumToWrite == 0)
+		return;
+
+	if (bLargeArray && !Out.IsByteSwapping() && CanBlockCopyArrayElements(AProp->Inner))
 	{
-		void *ElemPtr = ArrayHelper.GetRawPtr(ArrayElem);
-		StoreContainerProperty(AProp->Inner, RootObject, PrefixID, ElemPtr, true, Depth, ClassDef, PropertyOffsets, Meta, Out);
+		// Memory layout is identical to writing each element, so just copy the lot
+		Out.Serialize(ArrayHelper.GetRawPtr(0), static_cast<int64>(NumToWrite) * AProp->Inner->ElementSize);
+		UE_LOG(LogSpudProps, Verbose, TEXT("|%s %s = [%d elements]"), *FString::ChrN(Depth, '-'), *AProp->GetNameCPP(), NumToWrite);
+	}
+	else
+	{
+		for (int ArrayElem = 0; ArrayElem < NumToWrite; ++ArrayElem)
+		{
+			void *ElemPtr = ArrayHelper.GetRawPtr(ArrayElem);
+			StoreContainerProperty(AProp->Inner, RootObject, PrefixID, ElemPtr, true, Depth, ClassDef, PropertyOffsets, Meta, Out, Index);
+		}
 	}
 	
 }
@@ -643,7 +844,7 @@ void SpudPropertyUtil::StoreArrayProperty(FArrayProperty* AProp, const UObject*
 void SpudPropertyUtil::StoreContainerProperty(FProperty* Property, const UObject* RootObject, uint32 PrefixID,
                                                        const void* ContainerPtr, bool bIsArrayElement, int Depth,
                                                        FSpudClassDef& ClassDef, TArray<uint32>& PropertyOffsets,
-                                                       FSpudClassMetadata& Meta, FMemoryWriter& Out)
+                                                       FSpudClassMetadata& Meta, FMemoryWriter& Out, int RegisteredIndex)
 {
 	// Get pointer to data within container, must be from original property in the case of arrays
 	const void* DataPtr = Property->ContainerPtrToValuePtr<void>(ContainerPtr);
@@ -686,7 +887,7 @@ void SpudPropertyUtil::StoreContainerProperty(FProperty* Property, const UObject
             TryWritePropertyData<FStrProperty,		FString>(Property, PrefixID, DataPtr, bIsArrayElement, Depth, ClassDef, PropertyOffsets, Meta, Out) ||
             TryWritePropertyData<FNameProperty,		FName>(Property, PrefixID, DataPtr, bIsArrayElement, Depth, ClassDef, PropertyOffsets, Meta, Out) ||
             TryWriteEnumPropertyData(Property, PrefixID, DataPtr, bIsArrayElement, Depth, ClassDef, PropertyOffsets, Meta, Out) ||
-            TryWriteUObjectPropertyData(Property, PrefixID, DataPtr, bIsArrayElement, Depth, ClassDef, PropertyOffsets, Meta, Out);;
+            TryWriteUObjectPropertyData(Property, PrefixID, DataPtr, bIsArrayElement, Depth, ClassDef, PropertyOffsets, Meta, Out, RegisteredIndex);
 		
 	}
 	if (!bUpdateOK)
@@ -700,7 +901,7 @@ void SpudPropertyUtil::RestoreProperty(UObject* RootObject, FProperty* Property,
                                              const FSpudPropertyDef& StoredProperty,
                                              const RuntimeObjectMap* RuntimeObjects,
                                              const FSpudClassMetadata& Meta,
-                                             FMemoryReader& DataIn)
+                                             FArchive& DataIn)
 {
 	// Arrays supported, but not maps / sets yet
 	if (const auto AProp = CastField<FArrayProperty>(Property))
@@ -718,22 +919,58 @@ void SpudPropertyUtil::RestoreArrayProperty(UObject* RootObject, FArrayProperty*
                                                   void* ContainerPtr, const FSpudPropertyDef& StoredProperty,
                                                   const RuntimeObjectMap* RuntimeObjects,
                                                   const FSpudClassMetadata& Meta,
-                                                  FMemoryReader& DataIn)
+                                                  FArchive& DataIn)
 {
+	// Array properties store the count first, as a uint16 in older data, or a uint32 in the large encoding
+	const bool bLargeArray = (StoredProperty.DataType & ESST_LargeArrayOf) != 0;
+	uint32 NumElems;
+	if (bLargeArray)
+	{
+		DataIn << NumElems;
+	}
+	else
+	{
+		uint16 ShortElems;
+		DataIn << ShortElems;
+		NumElems = ShortElems;
+	}
 
-	// Array properties store the count as a uint16 first
-	uint16 NumElems;
-	DataIn << NumElems;
+	const bool bBlockCopy = bLargeArray && !DataIn.IsByteSwapping() &&
+		CanBlockCopyArrayElements(AProp->Inner) &&
+		StoredPropertyTypeMatchesRuntime(AProp->Inner, StoredProperty, true);
+
+	// Sanity check the count against the data we have, so corrupt data can't make us allocate silly amounts
+	// Every element is at least one byte
+	const int64 Remaining = DataIn.TotalSize() - DataIn.Tell();
+	const int64 MinBytes = bBlockCopy ? static_cast<int64>(NumElems) * AProp->Inner->ElementSize : NumElems;
+	if (MinBytes > Remaining)
+	{
+		UE_LOG(LogSpudProps, Error, TEXT("Array property %s has %u elements but only %lld bytes of data remain, data is corrupt"),
+			*AProp->GetName(), NumElems, Remaining);
+		DataIn.SetError();
+		return;
+	}
 	
 	void* DataPtr = AProp->ContainerPtrToValuePtr<void>(ContainerPtr);
 	FScriptArrayHelper ArrayHelper(AProp, DataPtr);
 	ArrayHelper.Resize(NumElems);
 
-	// After that, it's just like restoring a single property, just to a new location for each element
-	for (int ArrayElem = 0; ArrayElem < NumElems; ++ArrayElem)
+	if (NumElems == 0)
+		return;
+
+	if (bBlockCopy)
 	{
-		void *ElemPtr = ArrayHelper.GetRawPtr(ArrayElem);
-		RestoreContainerProperty(RootObject, AProp->Inner, ElemPtr, StoredProperty, RuntimeObjects, Meta, DataIn);
+		DataIn.Serialize(ArrayHelper.GetRawPtr(0), MinBytes);
+		UE_LOG(LogSpudProps, Verbose, TEXT(" |- %s = [%u elements]"), *AProp->GetNameCPP(), NumElems);
+	}
+	else
+	{
+		// After that, it's just like restoring a single property, just to a new location for each element
+		for (uint32 ArrayElem = 0; ArrayElem < NumElems; ++ArrayElem)
+		{
+			void *ElemPtr = ArrayHelper.GetRawPtr(ArrayElem);
+			RestoreContainerProperty(RootObject, AProp->Inner, ElemPtr, StoredProperty, RuntimeObjects, Meta, DataIn);
+		}
 	}
 	
 }
@@ -742,7 +979,7 @@ void SpudPropertyUtil::RestoreContainerProperty(UObject* RootObject, FProperty*
                                                       void* ContainerPtr, const FSpudPropertyDef& StoredProperty,
                                                       const RuntimeObjectMap* RuntimeObjects,
                                                       const FSpudClassMetadata& Meta,
-                                                      FMemoryReader& DataIn)
+                                                      FArchive& DataIn)
 {
 	// Get pointer to data within container, must be from original property in the case of arrays
 	void* DataPtr = Property->ContainerPtrToValuePtr<void>(ContainerPtr);
@@ -821,8 +1058,17 @@ bool SpudPropertyUtil::StoredClassDefMatchesRuntime(const FSpudClassDef& ClassDe
 
 bool SpudPropertyUtil::StoredPropertyTypeMatchesRuntime(const FProperty* RuntimeProperty, const FSpudPropertyDef& StoredProperty, bool bIgnoreArrayFlag)
 {
-	uint16 StoredType = StoredProperty.DataType;
-	uint16 RuntimeType = GetPropertyDataType(RuntimeProperty);
+	// The array encoding is not a type difference
+	uint16 StoredType = StoredProperty.DataType & ~ESST_LargeArrayOf;
+	uint16 RuntimeType = GetPropertyDataType(RuntimeProperty) & ~ESST_LargeArrayOf;
+	// Nor is the actor reference encoding, but only if it's still an actor reference (otherwise a packed reference
+	// would look like a string)
+	const auto AProp = CastField<FArrayProperty>(RuntimeProperty);
+	if (IsActorObjectProperty(AProp ? AProp->Inner : RuntimeProperty))
+	{
+		StoredType = StoredType & ~ESST_PackedActorRef;
+		RuntimeType = RuntimeType & ~ESST_PackedActorRef;
+	}
 	if (bIgnoreArrayFlag)
 	{
 		StoredType = StoredType & ~ESST_ArrayOf;
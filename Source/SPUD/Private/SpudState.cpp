@@ -1,8 +1,12 @@
 #include "SpudState.h"
 
 #include "EngineUtils.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
 #include "ISpudObject.h"
+#include "SpudPropertyPlan.h"
 #include "SpudPropertyUtil.h"
+#include "SpudStats.h"
 #include "SpudSubsystem.h"
 #include "Engine/LevelStreaming.h"
 #include "GameFramework/Character.h"
@@ -10,7 +14,11 @@
 #include "GameFramework/GameStateBase.h"
 #include "GameFramework/MovementComponent.h"
 #include "Kismet/GameplayStatics.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
 #include "ImageUtils.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
 #include "GameFramework/PlayerState.h"
 
 DEFINE_LOG_CATEGORY(LogSpudState)
@@ -21,10 +29,33 @@ USpudState::USpudState()
 	RemoveAllActiveGameLevelFiles();
 }
 
+void USpudState::AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector)
+{
+	USpudState* This = CastChecked<USpudState>(InThis);
+	// Time sliced restores hold on to the actors they've respawned between frames, to resolve references to them
+	for (auto& Job : This->PendingRestoreJobs)
+	{
+		Collector.AddReferencedObjects(Job->RuntimeObjects.ByGuid, This);
+		Collector.AddReferencedObjects(Job->RuntimeObjects.LevelActorsByName, This);
+		Collector.AddReferencedObjects(Job->RuntimeObjects.ActorsByNameIndex, This);
+	}
+	Super::AddReferencedObjects(InThis, Collector);
+}
+
 void USpudState::ResetState()
 {
-	RemoveAllActiveGameLevelFiles();
+	CancelAllPendingRestores();
+	CancelAllPendingStores();
+	TArray<FString> PreloadLevels;
+	ClassPreloads.GetKeys(PreloadLevels);
+	for (const auto& LevelName : PreloadLevels)
+	{
+		ReleaseClassPreload(LevelName);
+	}
+	// Data first, loaded levels can have their files mapped, which stops them being deleted on some platforms
 	SaveData.Reset();
+	RemoveAllActiveGameLevelFiles();
+	DirtyActors.Empty();
 }
 
 void USpudState::StoreWorldGlobals(UWorld* World)
@@ -35,30 +66,397 @@ void USpudState::StoreWorldGlobals(UWorld* World)
 
 void USpudState::StoreLevel(ULevel* Level, bool bRelease, bool bBlocking)
 {
+	SPUD_SCOPED_STAT(StoreLevel);
 	const FString LevelName = GetLevelName(Level);
+	// Storing a half-restored level would lose whatever hasn't been restored yet
+	CompletePendingRestore(LevelName);
+	// And this supersedes a time sliced store
+	CancelPendingStore(LevelName);
 	auto LevelData = GetLevelData(LevelName, true);
 
 	if (LevelData.IsValid())
 	{
 		// Mutex lock the level (load and unload events on streaming can be in loading threads)
-		FScopeLock LevelLock(&LevelData->Mutex);
+		FSpudScopeLock LevelLock(&LevelData->Mutex);
+		StoreLevelActors(Level, LevelData, nullptr);
+	}
+
+	if (bRelease)
+		ReleaseLevelData(LevelName, bBlocking);
+}
+
+void USpudState::StoreLevels(const TArray<ULevel*>& Levels, bool bRelease, bool bBlocking)
+{
+	SPUD_SCOPED_STAT(StoreLevel);
+	struct FParallelStoreJob
+	{
+		FString LevelName;
+		FSpudSaveData::TLevelDataPtr LevelData;
+		TArray<FDeferredPropertyStore> Deferred;
+	};
+	TArray<FParallelStoreJob> Jobs;
+	Jobs.SetNum(Levels.Num());
+
+	// First everything which has to be on the game thread: callbacks, core data (transforms etc), creating entries
+	// & Guids. Plain actors have their properties deferred
+	for (int i = 0; i < Levels.Num(); ++i)
+	{
+		auto& Job = Jobs[i];
+		Job.LevelName = GetLevelName(Levels[i]);
+		CompletePendingRestore(Job.LevelName);
+		CancelPendingStore(Job.LevelName);
+		Job.LevelData = GetLevelData(Job.LevelName, true);
+		if (Job.LevelData.IsValid())
+		{
+			FSpudScopeLock LevelLock(&Job.LevelData->Mutex);
+			StoreLevelActors(Levels[i], Job.LevelData, &Job.Deferred);
+		}
+	}
+
+	// Then encode property data, one level per task. Levels have their own metadata so nothing is shared, and the
+	// game thread is blocked in here so actors won't change underneath us
+	ParallelFor(Jobs.Num(), [&Jobs](int32 Index)
+	{
+		const auto& Job = Jobs[Index];
+		if (Job.LevelData.IsValid() && Job.Deferred.Num() > 0)
+		{
+			SPUD_SCOPED_STAT(StoreDeferredProperties);
+			FSpudScopeLock LevelLock(&Job.LevelData->Mutex);
+			for (const auto& Deferred : Job.Deferred)
+			{
+				StoreDeferredProperties(Deferred, Job.LevelData);
+			}
+		}
+	});
+
+	if (bRelease)
+	{
+		for (const auto& Job : Jobs)
+		{
+			ReleaseLevelData(Job.LevelName, bBlocking);
+		}
+	}
+}
 
+void USpudState::StoreLevelActors(ULevel* Level, FSpudSaveData::TLevelDataPtr LevelData, TArray<FDeferredPropertyStore>* Deferred)
+{
+	// Same as a time sliced store, just all in one go
+	FLevelStoreJob Job;
+	Job.Level = Level;
+	Job.LevelName = LevelData->Name;
+	BeginLevelStore(Job, Level, LevelData);
+	StepLevelStore(Job, LevelData, DBL_MAX, Deferred);
+	FinishLevelStore(Job, Level, LevelData, Deferred);
+}
+
+void USpudState::BeginLevelStore(FLevelStoreJob& Job, ULevel* Level, FSpudSaveData::TLevelDataPtr LevelData)
+{
+	// Incremental stores rely on the existing data being from the same data model
+	Job.bIncremental = bIncrementalStore && !LevelData->IsUserDataModelOutdated();
+	if (Job.bIncremental || Job.bTimeSliced)
+	{
+		// Unlike a full store we keep the metadata & existing actor entries, so that unchanged actors don't need
+		// any work. Entries for actors which no longer exist are removed at the end, so the result is the same as
+		// if everything had been stored from scratch.
+		// Time sliced stores do the same so that if they're cancelled or abandoned part way, actors which haven't
+		// been stored yet still have their previous data, rather than it being left out of the level.
+		// Unchanged actors keep their data, so that can't stay in a mapped file
+		LevelData->DetachFromMappedFile();
+	}
+	else
+	{
 		// Clear any existing data for levels being updated from
 		// Which is either the specific level, or all loaded levels
-		if (LevelData)
-			LevelData->PreStoreWorld();
+		LevelData->PreStoreWorld();
+	}
 
-		for (auto Actor : Level->Actors)
+	Job.Actors.Reset(Level->Actors.Num());
+	for (auto Actor : Level->Actors)
+	{
+		if (SpudPropertyUtil::IsPersistentObject(Actor))
+			Job.Actors.Add(Actor);
+	}
+	Job.NextIndex = 0;
+	Job.NumSkipped = 0;
+}
+
+bool USpudState::StepLevelStore(FLevelStoreJob& Job, FSpudSaveData::TLevelDataPtr LevelData, double Deadline, TArray<FDeferredPropertyStore>* Deferred)
+{
+	while (Job.NextIndex < Job.Actors.Num())
+	{
+		if (AActor* Actor = Job.Actors[Job.NextIndex++].Get())
+			StoreLevelStoreActor(Job, Actor, LevelData, Deferred);
+
+		if (Deadline < DBL_MAX && FPlatformTime::Seconds() >= Deadline)
+			return Job.NextIndex >= Job.Actors.Num();
+	}
+	return true;
+}
+
+void USpudState::StoreLevelStoreActor(FLevelStoreJob& Job, AActor* Actor, FSpudSaveData::TLevelDataPtr LevelData, TArray<FDeferredPropertyStore>* Deferred)
+{
+	if (!Job.bIncremental)
+	{
+		StoreActor(Actor, LevelData, Deferred);
+		return;
+	}
+
+	if (Actor->HasAnyFlags(RF_ClassDefaultObject|RF_ArchetypeObject|RF_BeginDestroyed))
+		return;
+
+	if (CanSkipIncrementalStore(Actor, ShouldActorBeRespawnedOnRestore(Actor), LevelData))
+		++Job.NumSkipped;
+	else
+		StoreActor(Actor, LevelData, Deferred);
+}
+
+void USpudState::FinishLevelStore(FLevelStoreJob& Job, ULevel* Level, FSpudSaveData::TLevelDataPtr LevelData, TArray<FDeferredPropertyStore>* Deferred)
+{
+	// A full store in one go has written exactly the actors which exist, nothing more to do
+	if (!Job.bIncremental && !Job.bTimeSliced)
+	{
+		LevelData->PostStoreWorld();
+		return;
+	}
+
+	// Otherwise remember which entries are still relevant, so that those for actors which no longer exist can be
+	// removed. For time sliced stores that includes actors which were destroyed after being stored, and we also
+	// need to pick up actors which were spawned since the store started.
+	TSet<TWeakObjectPtr<AActor>> StartActors;
+	if (Job.bTimeSliced)
+		StartActors.Append(Job.Actors);
+	TSet<FName> LiveLevelActors;
+	TSet<FGuid> LiveSpawnedActors;
+
+	for (auto Actor : Level->Actors)
+	{
+		if (!SpudPropertyUtil::IsPersistentObject(Actor) || Actor->IsPendingKill() ||
+			Actor->HasAnyFlags(RF_ClassDefaultObject|RF_ArchetypeObject|RF_BeginDestroyed))
+			continue;
+
+		if (Job.bTimeSliced && !StartActors.Contains(Actor))
+			StoreLevelStoreActor(Job, Actor, LevelData, Deferred);
+
+		// Get the Guid after storing, since that can assign it
+		if (ShouldActorBeRespawnedOnRestore(Actor))
 		{
-			if (SpudPropertyUtil::IsPersistentObject(Actor))
-			{
-				StoreActor(Actor, LevelData);
-			}					
+			const FGuid Guid = SpudPropertyUtil::GetGuidProperty(Actor);
+			if (Guid.IsValid())
+				LiveSpawnedActors.Add(Guid);
+		}
+		else
+		{
+			LiveLevelActors.Add(Actor->GetFName());
 		}
 	}
 
-	if (bRelease)
-		ReleaseLevelData(LevelName, bBlocking);
+	// Remove data for actors which no longer exist. Destroyed level actors are separately recorded in DestroyedActors
+	for (auto It = LevelData->LevelActors.Contents.CreateIterator(); It; ++It)
+	{
+		if (!LiveLevelActors.Contains(It.Key()))
+			It.RemoveCurrent();
+	}
+	for (auto It = LevelData->SpawnedActors.Contents.CreateIterator(); It; ++It)
+	{
+		if (!LiveSpawnedActors.Contains(It.Key()))
+			It.RemoveCurrent();
+	}
+
+	if (Job.bIncremental)
+	{
+		// Tidy up dirty entries for actors that have since gone
+		for (auto It = DirtyActors.CreateIterator(); It; ++It)
+		{
+			if (!It->IsValid())
+				It.RemoveCurrent();
+		}
+
+		UE_LOG(LogSpudState, Verbose, TEXT("Incremental store of level %s, %d unchanged actors skipped"), *LevelData->Name, Job.NumSkipped);
+	}
+
+	LevelData->PostStoreWorld();
+}
+
+void USpudState::StoreLevelTimeSliced(ULevel* Level, bool bReleaseAfter, TFunction<void(bool)> OnComplete)
+{
+	if (!IsValid(Level))
+	{
+		if (OnComplete)
+			OnComplete(false);
+		return;
+	}
+
+	const FString LevelName = GetLevelName(Level);
+	// Same rules as StoreLevel
+	CompletePendingRestore(LevelName);
+	CancelPendingStore(LevelName);
+	auto LevelData = GetLevelData(LevelName, true);
+	if (!LevelData.IsValid())
+	{
+		if (OnComplete)
+			OnComplete(false);
+		return;
+	}
+
+	bool bOutdated;
+	{
+		FSpudScopeLock LevelLock(&LevelData->Mutex);
+		bOutdated = LevelData->IsUserDataModelOutdated();
+	}
+	if (bOutdated)
+	{
+		// Time sliced stores keep existing entries until they're replaced (@see BeginLevelStore), which mustn't
+		// mix with data from an older user data model, so store it all at once instead
+		UE_LOG(LogSpudState, Verbose, TEXT("STORE level %s - data model is outdated, not time slicing"), *LevelName);
+		StoreLevel(Level, bReleaseAfter, false);
+		if (OnComplete)
+			OnComplete(true);
+		return;
+	}
+
+	UE_LOG(LogSpudState, Verbose, TEXT("STORE level %s - Start (time sliced)"), *LevelName);
+	auto Job = MakeShared<FLevelStoreJob>();
+	Job->Level = Level;
+	Job->LevelName = LevelName;
+	Job->bTimeSliced = true;
+	Job->bReleaseAfter = bReleaseAfter;
+	Job->OnComplete = OnComplete;
+	{
+		FSpudScopeLock LevelLock(&LevelData->Mutex);
+		BeginLevelStore(*Job, Level, LevelData);
+	}
+	PendingStoreJobs.Add(Job);
+}
+
+bool USpudState::StepPendingStore(FLevelStoreJob& Job, double Deadline, bool& bOutSuccess)
+{
+	SPUD_SCOPED_STAT(StoreLevel);
+	bOutSuccess = false;
+	ULevel* Level = Job.Level.Get();
+	if (!Level)
+	{
+		// Actors which weren't stored yet keep their data from before the store started
+		UE_LOG(LogSpudState, Log, TEXT("Abandoning store of level %s, level has been unloaded"), *Job.LevelName);
+		return true;
+	}
+
+	// Level data is only locked for a slice at a time
+	auto LevelData = GetLevelData(Job.LevelName, true);
+	if (!LevelData.IsValid())
+		return true;
+
+	FSpudScopeLock LevelLock(&LevelData->Mutex);
+	if (!StepLevelStore(Job, LevelData, Deadline, nullptr))
+		return false;
+
+	FinishLevelStore(Job, Level, LevelData, nullptr);
+	bOutSuccess = true;
+	return true;
+}
+
+void USpudState::FinishPendingStore(FLevelStoreJob& Job, bool bSuccess)
+{
+	if (bSuccess)
+	{
+		UE_LOG(LogSpudState, Verbose, TEXT("STORE level %s - Complete (time sliced)"), *Job.LevelName);
+		if (Job.bReleaseAfter)
+			ReleaseLevelData(Job.LevelName, false);
+	}
+
+	if (Job.OnComplete)
+		Job.OnComplete(bSuccess);
+}
+
+void USpudState::TickTimeSlicedStores(double TimeBudgetSeconds)
+{
+	const double Deadline = FPlatformTime::Seconds() + TimeBudgetSeconds;
+	while (PendingStoreJobs.Num() > 0)
+	{
+		// Keep a reference of our own, completion callbacks can change PendingStoreJobs 
+		const auto Job = PendingStoreJobs[0];
+		bool bSuccess;
+		if (!StepPendingStore(*Job, Deadline, bSuccess))
+			break;
+
+		PendingStoreJobs.RemoveAt(0);
+		FinishPendingStore(*Job, bSuccess);
+
+		if (FPlatformTime::Seconds() >= Deadline)
+			break;
+	}
+}
+
+void USpudState::CancelPendingStore(const FString& LevelName)
+{
+	const int32 Index = PendingStoreJobs.IndexOfByPredicate([&LevelName](const TSharedPtr<FLevelStoreJob>& Job)
+	{
+		return Job->LevelName == LevelName;
+	});
+	if (Index == INDEX_NONE)
+		return;
+
+	const auto Job = PendingStoreJobs[Index];
+	PendingStoreJobs.RemoveAt(Index);
+	UE_LOG(LogSpudState, Log, TEXT("Cancelled store of level %s"), *LevelName);
+	FinishPendingStore(*Job, false);
+}
+
+void USpudState::CancelAllPendingStores()
+{
+	// Take them all first, in case the callbacks start any more
+	auto Jobs = MoveTemp(PendingStoreJobs);
+	PendingStoreJobs.Empty();
+	for (auto& Job : Jobs)
+	{
+		UE_LOG(LogSpudState, Log, TEXT("Cancelled store of level %s"), *Job->LevelName);
+		FinishPendingStore(*Job, false);
+	}
+}
+
+void USpudState::StoreDeferredProperties(const FDeferredPropertyStore& Deferred, FSpudSaveData::TLevelDataPtr LevelData)
+{
+	FSpudObjectData* ActorData;
+	if (Deferred.bRespawn)
+		ActorData = LevelData->SpawnedActors.Contents.Find(Deferred.Guid);
+	else
+		ActorData = LevelData->LevelActors.Contents.Find(Deferred.Name);
+
+	if (!ActorData)
+		return;
+
+	FSpudClassMetadata& Meta = LevelData->Metadata;
+	FSpudClassDef& ClassDef = Meta.FindOrAddClassDef(Deferred.ClassName);
+	// Reset rather than Empty so that we can write over the previous buffer
+	ActorData->Properties.Data.Reset();
+	FMemoryWriter PropertyWriter(ActorData->Properties.Data);
+	Deferred.Plan->Store(Deferred.Actor, ClassDef, ActorData->Properties.PropertyOffsets, Meta, PropertyWriter);
+}
+
+bool USpudState::CanSkipIncrementalStore(AActor* Actor, bool bRespawn, FSpudSaveData::TLevelDataPtr LevelData) const
+{
+	const auto SpudObject = Cast<ISpudObject>(Actor);
+	if (!SpudObject || !SpudObject->IsSpudDirtyTracked() || IsActorDirty(Actor))
+		return false;
+
+	// Also needs to have been stored before
+	if (bRespawn)
+	{
+		const FGuid Guid = SpudPropertyUtil::GetGuidProperty(Actor);
+		return Guid.IsValid() && LevelData->SpawnedActors.Contents.Contains(Guid);
+	}
+
+	return LevelData->LevelActors.Contents.Contains(Actor->GetFName());
+}
+
+void USpudState::MarkActorDirty(const AActor* Actor)
+{
+	if (IsValid(Actor))
+		DirtyActors.Add(Actor);
+}
+
+bool USpudState::IsActorDirty(const AActor* Actor) const
+{
+	return DirtyActors.Contains(Actor);
 }
 
 USpudState::StorePropertyVisitor::StorePropertyVisitor(
@@ -117,35 +515,59 @@ void USpudState::StorePropertyVisitor::EndNestedUObject(UObject* RootObject, FOb
 	}
 }
 
+void USpudState::StoreObjectProperties(UObject* Obj, FSpudClassDef& ClassDef, TArray<uint32>& PropertyOffsets,
+                                       FSpudClassMetadata& Meta, FMemoryWriter& Out)
+{
+	// Most classes can use a cached plan rather than walking all the properties every time
+	const auto Plan = FSpudPropertyPlan::Get(Obj->GetClass());
+	if (Plan.IsValid() && Plan->IsValid())
+	{
+		Plan->Store(Obj, ClassDef, PropertyOffsets, Meta, Out);
+	}
+	else
+	{
+		StorePropertyVisitor Visitor(this, ClassDef, PropertyOffsets, Meta, Out);
+		SpudPropertyUtil::VisitPersistentProperties(Obj, Visitor);
+	}
+}
+
+/// What's present in version 2 core actor data; anything not present is its default (zero / identity)
+enum ESpudCoreDataFlags : uint8
+{
+	SCDF_Hidden = 1 << 0,
+	/// Location & rotation
+	SCDF_Transform = 1 << 1,
+	/// Non-identity scale, only possible with SCDF_Transform
+	SCDF_Scale = 1 << 2,
+	SCDF_Velocity = 1 << 3,
+	SCDF_AngularVelocity = 1 << 4,
+	SCDF_ControlRotation = 1 << 5,
+};
+
 void USpudState::WriteCoreActorData(AActor* Actor, FArchive& Out) const
 {
 	// Save core information which isn't in properties
 	// We write this as packed data
 
 	// Version: this needs to be incremented if any changes
-	constexpr uint16 CoreDataVersion = 1;
+	constexpr uint16 CoreDataVersion = 2;
 
 	// Current Format:
 	// - Version (uint16)
-	// - Hidden (bool)
-	// - Transform (FTransform)
-	// - Velocity (FVector)
-	// - AngularVelocity (FVector)
-	// - Control rotation (FRotator) (non-zero for Pawns only)
+	// - Flags (uint8, ESpudCoreDataFlags)
+	// - Location (FVector) & Rotation (FQuat) if SCDF_Transform
+	// - Scale (FVector) if SCDF_Scale
+	// - Velocity (FVector) if SCDF_Velocity
+	// - AngularVelocity (FVector) if SCDF_AngularVelocity
+	// - Control rotation (FRotator) if SCDF_ControlRotation (Pawns only)
 
-	// We could omit some of this data for non-movables but it's simpler to include for all
-
-	SpudPropertyUtil::WriteRaw(CoreDataVersion, Out);
-
-	SpudPropertyUtil::WriteRaw(Actor->IsHidden(), Out);
-	SpudPropertyUtil::WriteRaw(Actor->GetTransform(), Out);
-	
 	FVector Velocity = FVector::ZeroVector;
 	FVector AngularVelocity = FVector::ZeroVector;
 	FRotator ControlRotation = FRotator::ZeroRotator;
 
 	const auto RootComp = Actor->GetRootComponent();
-	if (RootComp && RootComp->Mobility == EComponentMobility::Movable)
+	const bool bMovable = RootComp && RootComp->Mobility == EComponentMobility::Movable;
+	if (bMovable)
 	{
 		const auto PrimComp = Cast<UPrimitiveComponent>(RootComp);
 		if (PrimComp && PrimComp->IsSimulatingPhysics())
@@ -158,15 +580,46 @@ void USpudState::WriteCoreActorData(AActor* Actor, FArchive& Out) const
 			Velocity = MoveComponent->Velocity;
 		}
 	}
-
 	
 	if (const auto Pawn = Cast<APawn>(Actor))
 	{
 		ControlRotation = Pawn->GetControlRotation();
 	}
-	SpudPropertyUtil::WriteRaw(Velocity, Out);
-	SpudPropertyUtil::WriteRaw(AngularVelocity, Out);
-	SpudPropertyUtil::WriteRaw(ControlRotation, Out);
+
+	// Only the transform of a movable root is ever restored, but it's kept for the others unless we've been told
+	// not to, in case mobility changes
+	const FTransform& XForm = Actor->GetTransform();
+	const bool bStoreTransform = RootComp && (bMovable || bStoreNonMovableTransforms);
+
+	uint8 Flags = 0;
+	if (Actor->IsHidden())
+		Flags |= SCDF_Hidden;
+	if (bStoreTransform)
+		Flags |= SCDF_Transform;
+	if (bStoreTransform && XForm.GetScale3D() != FVector::OneVector)
+		Flags |= SCDF_Scale;
+	if (Velocity != FVector::ZeroVector)
+		Flags |= SCDF_Velocity;
+	if (AngularVelocity != FVector::ZeroVector)
+		Flags |= SCDF_AngularVelocity;
+	if (ControlRotation != FRotator::ZeroRotator)
+		Flags |= SCDF_ControlRotation;
+
+	SpudPropertyUtil::WriteRaw(CoreDataVersion, Out);
+	SpudPropertyUtil::WriteRaw(Flags, Out);
+	if (Flags & SCDF_Transform)
+	{
+		SpudPropertyUtil::WriteRaw(XForm.GetLocation(), Out);
+		SpudPropertyUtil::WriteRaw(XForm.GetRotation(), Out);
+	}
+	if (Flags & SCDF_Scale)
+		SpudPropertyUtil::WriteRaw(XForm.GetScale3D(), Out);
+	if (Flags & SCDF_Velocity)
+		SpudPropertyUtil::WriteRaw(Velocity, Out);
+	if (Flags & SCDF_AngularVelocity)
+		SpudPropertyUtil::WriteRaw(AngularVelocity, Out);
+	if (Flags & SCDF_ControlRotation)
+		SpudPropertyUtil::WriteRaw(ControlRotation, Out);
 
 }
 
@@ -223,16 +676,34 @@ void USpudState::ReleaseAllLevelData()
 	SaveData.WriteAndReleaseAllLevelData(GetActiveGameLevelFolder());
 }
 
+USpudState::FCustomDataScope::FCustomDataScope(USpudState& InState, FArchive* Ar)
+	: State(InState)
+{
+	if (State.CustomDataWrappers.Num() <= State.CustomDataDepth)
+		State.CustomDataWrappers.Add(NewObject<USpudStateCustomData>(&State));
+	Wrapper = State.CustomDataWrappers[State.CustomDataDepth++];
+	Wrapper->Init(Ar);
+}
+
+USpudState::FCustomDataScope::~FCustomDataScope()
+{
+	Wrapper->Init(nullptr);
+	--State.CustomDataDepth;
+}
+
 FSpudNamedObjectData* USpudState::GetLevelActorData(const AActor* Actor, FSpudSaveData::TLevelDataPtr LevelData, bool AutoCreate)
 {
-	// FNames are constant within a level
-	const auto Name = SpudPropertyUtil::GetLevelActorName(Actor);
+	// FNames are constant within a level, and are what we key on so we only need the string for new entries
+	const FName Name = Actor->GetFName();
 	FSpudNamedObjectData* Ret = LevelData->LevelActors.Contents.Find(Name);
 
 	if (!Ret && AutoCreate)
 	{
-		Ret = &LevelData->LevelActors.Contents.Add(Name);
-		Ret->Name = Name;
+		// If this actor had an entry before the store started, that's reused (including its name)
+		bool bReused;
+		Ret = &LevelData->LevelActors.AddReused(Name, bReused);
+		if (!bReused)
+			Ret->Name = SpudPropertyUtil::GetLevelActorName(Actor);
 	}
 	
 	return Ret;
@@ -264,11 +735,11 @@ FSpudSpawnedActorData* USpudState::GetSpawnedActorData(AActor* Actor, FSpudSaveD
 		return nullptr;			
 	}
 	
-	const auto GuidStr = Guid.ToString(SPUDDATA_GUID_KEY_FORMAT);
-	FSpudSpawnedActorData* Ret = LevelData->SpawnedActors.Contents.Find(GuidStr);
+	FSpudSpawnedActorData* Ret = LevelData->SpawnedActors.Contents.Find(Guid);
 	if (!Ret && AutoCreate)
 	{
-		Ret = &LevelData->SpawnedActors.Contents.Emplace(GuidStr);
+		bool bReused;
+		Ret = &LevelData->SpawnedActors.AddReused(Guid, bReused);
 		Ret->Guid = Guid;
 		const FString ClassName = SpudPropertyUtil::GetClassName(Actor); 
 		Ret->ClassID = LevelData->Metadata.FindOrAddClassIDFromName(ClassName);
@@ -285,7 +756,12 @@ void USpudState::StoreActor(AActor* Obj)
 	const FString LevelName = GetLevelNameForObject(Obj);
 
 	auto LevelData = GetLevelData(LevelName, true);
-	StoreActor(Obj, LevelData);
+	if (LevelData.IsValid())
+	{
+		FSpudScopeLock LevelLock(&LevelData->Mutex);
+		LevelData->DetachFromMappedFile();
+		StoreActor(Obj, LevelData);
+	}
 		
 }
 
@@ -307,10 +783,11 @@ FSpudNamedObjectData* USpudState::GetGlobalObjectData(const UObject* Obj, bool A
 
 FSpudNamedObjectData* USpudState::GetGlobalObjectData(const FString& ID, bool AutoCreate)
 {
-	FSpudNamedObjectData* Ret = SaveData.GlobalData.Objects.Contents.Find(ID);
+	const FName Key(*ID);
+	FSpudNamedObjectData* Ret = SaveData.GlobalData.Objects.Contents.Find(Key);
 	if (!Ret && AutoCreate)
 	{
-		Ret = &SaveData.GlobalData.Objects.Contents.Add(ID);
+		Ret = &SaveData.GlobalData.Objects.Contents.Add(Key);
 		Ret->Name = ID;
 	}
 
@@ -346,20 +823,20 @@ void USpudState::StoreGlobalObject(UObject* Obj, FSpudNamedObjectData* Data)
 		if (bIsCallback)
 			ISpudObjectCallback::Execute_SpudPreStore(Obj, this);
 
-		PropData.Empty();
+		PropData.Reset();
 		FMemoryWriter PropertyWriter(PropData);
 
 		// visit all properties and write out
-		StorePropertyVisitor Visitor(this, ClassDef, PropOffsets, Meta, PropertyWriter);
-		SpudPropertyUtil::VisitPersistentProperties(Obj, Visitor);
+		StoreObjectProperties(Obj, ClassDef, PropOffsets, Meta, PropertyWriter);
 		
 		if (bIsCallback)
 		{
-			Data->CustomData.Data.Empty();
+			Data->CustomData.Data.Reset();
 			FMemoryWriter CustomDataWriter(Data->CustomData.Data);
-			auto CustomDataStruct = NewObject<USpudStateCustomData>();
-			CustomDataStruct->Init(&CustomDataWriter);
-			ISpudObjectCallback::Execute_SpudStoreCustomData(Obj, this, CustomDataStruct);
+			{
+				FCustomDataScope CustomData(*this, &CustomDataWriter);
+				ISpudObjectCallback::Execute_SpudStoreCustomData(Obj, this, CustomData.Wrapper);
+			}
 			
 			ISpudObjectCallback::Execute_SpudPostStore(Obj, this);
 		}
@@ -379,6 +856,8 @@ void USpudState::RestoreLevel(ULevel* Level)
 {
 	if (!IsValid(Level))
 		return;
+
+	SPUD_SCOPED_STAT(RestoreLevel);
 	
 	FString LevelName = GetLevelName(Level);
 	auto LevelData = GetLevelData(LevelName, false);
@@ -390,38 +869,222 @@ void USpudState::RestoreLevel(ULevel* Level)
 	}
 
 	// Mutex lock the level (load and unload events on streaming can be in loading threads)
-	FScopeLock LevelLock(&LevelData->Mutex);
+	FSpudScopeLock LevelLock(&LevelData->Mutex);
 	
 	UE_LOG(LogSpudState, Verbose, TEXT("RESTORE level %s - Start"), *LevelName);
-	TMap<FGuid, UObject*> RuntimeObjectsByGuid;
-	// Respawn dynamic actors first; they need to exist in order for cross-references in level actors to work
-	for (auto&& SpawnedActor : LevelData->SpawnedActors.Contents)
+	// Same as a time sliced restore, just all in one go
+	FLevelRestoreJob Job;
+	Job.Level = Level;
+	Job.LevelName = LevelName;
+	StepLevelRestore(Job, LevelData, DBL_MAX);
+	UE_LOG(LogSpudState, Verbose, TEXT("RESTORE level %s - Complete"), *LevelName);
+	// Respawned actors keep their classes in memory now
+	ReleaseClassPreload(LevelName);
+
+}
+
+bool USpudState::StepLevelRestore(FLevelRestoreJob& Job, FSpudSaveData::TLevelDataPtr LevelData, double Deadline)
+{
+	ULevel* Level = Job.Level.Get();
+	if (!Level)
 	{
-		auto Actor = RespawnActor(SpawnedActor.Value, LevelData->Metadata, Level);
-		if (Actor)
-			RuntimeObjectsByGuid.Add(SpawnedActor.Value.Guid, Actor);
-		// Spawned actors will have been added to Level->Actors, their state will be restored there
+		Job.Phase = FLevelRestoreJob::EPhase::Done;
+		return true;
 	}
-	// Restore existing actor state
-	for (auto Actor : Level->Actors)
+
+	// We check the time after every item, which is cheap compared to restoring an actor
+	auto OutOfTime = [Deadline]() { return Deadline < DBL_MAX && FPlatformTime::Seconds() >= Deadline; };
+
+	if (Job.Phase == FLevelRestoreJob::EPhase::Respawn)
 	{
-		if (SpudPropertyUtil::IsPersistentObject(Actor))
+		// Respawn dynamic actors first; they need to exist in order for cross-references in level actors to work
+		// This means ALL of them, before any actor is restored, even if it takes several slices
+		if (Job.NextIndex == 0)
+			LevelData->SpawnedActors.Contents.GenerateKeyArray(Job.SpawnedActorGuids);
+
+		while (Job.NextIndex < Job.SpawnedActorGuids.Num())
 		{
-			RestoreActor(Actor, LevelData, &RuntimeObjectsByGuid);
-			auto Guid = SpudPropertyUtil::GetGuidProperty(Actor);
-			if (Guid.IsValid())
+			// The entry could have gone in between slices, if the actor was respawned & destroyed again already
+			const auto SpawnedActor = LevelData->SpawnedActors.Contents.Find(Job.SpawnedActorGuids[Job.NextIndex++]);
+			if (SpawnedActor)
+			{
+				auto Actor = RespawnActor(*SpawnedActor, LevelData->Metadata, Level);
+				if (Actor)
+					Job.RuntimeObjects.ByGuid.Add(SpawnedActor->Guid, Actor);
+				// Spawned actors will have been added to Level->Actors, their state will be restored there
+			}
+			if (OutOfTime())
+				return false;
+		}
+
+		// Take a copy of the actors now, since Level->Actors can change while we're spread over several frames
+		Job.Actors.Reset(Level->Actors.Num());
+		for (auto Actor : Level->Actors)
+		{
+			if (SpudPropertyUtil::IsPersistentObject(Actor))
+				Job.Actors.Add(Actor);
+		}
+		Job.SpawnedActorGuids.Empty();
+		// One lookup of all the actors in the level by name, for references to level actors and destroying actors,
+		// rather than finding each of them in the global object hash
+		Job.RuntimeObjects.AddLevelActors(Level);
+		// And of the level actors referred to by name index, so those references are just an array lookup
+		Job.RuntimeObjects.ResolveActorNames(LevelData->Metadata, Level);
+		Job.Phase = FLevelRestoreJob::EPhase::RestoreActors;
+		Job.NextIndex = 0;
+	}
+
+	if (Job.Phase == FLevelRestoreJob::EPhase::RestoreActors)
+	{
+		// Restore existing actor state
+		while (Job.NextIndex < Job.Actors.Num())
+		{
+			if (AActor* Actor = Job.Actors[Job.NextIndex++].Get())
 			{
-				RuntimeObjectsByGuid.Add(Guid, Actor);
+				RestoreActor(Actor, LevelData, &Job.RuntimeObjects);
+				auto Guid = SpudPropertyUtil::GetGuidProperty(Actor);
+				if (Guid.IsValid())
+				{
+					Job.RuntimeObjects.ByGuid.Add(Guid, Actor);
+				}
 			}
+			if (OutOfTime())
+				return false;
 		}
+		Job.Actors.Empty();
+		Job.Phase = FLevelRestoreJob::EPhase::DestroyActors;
+		Job.NextIndex = 0;
 	}
-	// Destroy actors in level but missing from save state
-	for (auto&& DestroyedActor : LevelData->DestroyedActors.Values)
+
+	if (Job.Phase == FLevelRestoreJob::EPhase::DestroyActors)
 	{
-		DestroyActor(DestroyedActor, Level);			
+		// Destroy actors in level but missing from save state
+		// Anything added to this since we started was destroyed in the meantime anyway
+		while (Job.NextIndex < LevelData->DestroyedActors.Values.Num())
+		{
+			DestroyActor(LevelData->DestroyedActors.Values[Job.NextIndex++], Level, &Job.RuntimeObjects);
+			if (OutOfTime())
+				return false;
+		}
+		Job.Phase = FLevelRestoreJob::EPhase::Done;
 	}
-	UE_LOG(LogSpudState, Verbose, TEXT("RESTORE level %s - Complete"), *LevelName);
 
+	return true;
+}
+
+void USpudState::RestoreLevelTimeSliced(ULevel* Level, TFunction<void(bool)> OnComplete)
+{
+	if (!IsValid(Level))
+	{
+		if (OnComplete)
+			OnComplete(false);
+		return;
+	}
+
+	const FString LevelName = GetLevelName(Level);
+	if (!GetLevelData(LevelName, false).IsValid())
+	{
+		UE_LOG(LogSpudState, Log, TEXT("Skipping restore level %s, no data (this may be fine)"), *LevelName);
+		if (OnComplete)
+			OnComplete(true);
+		return;
+	}
+
+	UE_LOG(LogSpudState, Verbose, TEXT("RESTORE level %s - Start (time sliced)"), *LevelName);
+	auto Job = MakeShared<FLevelRestoreJob>();
+	Job->Level = Level;
+	Job->LevelName = LevelName;
+	Job->OnComplete = OnComplete;
+	PendingRestoreJobs.Add(Job);
+}
+
+bool USpudState::StepPendingRestore(FLevelRestoreJob& Job, double Deadline, bool& bOutSuccess)
+{
+	SPUD_SCOPED_STAT(RestoreLevel);
+	bOutSuccess = false;
+	if (!Job.Level.IsValid())
+	{
+		UE_LOG(LogSpudState, Log, TEXT("Abandoning restore of level %s, level has been unloaded"), *Job.LevelName);
+		return true;
+	}
+
+	// Level data is only locked for a slice at a time, and could have been released in between, so (re)load it
+	auto LevelData = GetLevelData(Job.LevelName, false);
+	if (!LevelData.IsValid())
+	{
+		UE_LOG(LogSpudState, Log, TEXT("Abandoning restore of level %s, level data has been cleared"), *Job.LevelName);
+		return true;
+	}
+
+	FSpudScopeLock LevelLock(&LevelData->Mutex);
+	bOutSuccess = true;
+	return StepLevelRestore(Job, LevelData, Deadline);
+}
+
+void USpudState::FinishPendingRestore(FLevelRestoreJob& Job, bool bSuccess)
+{
+	if (bSuccess)
+		UE_LOG(LogSpudState, Verbose, TEXT("RESTORE level %s - Complete (time sliced)"), *Job.LevelName);
+
+	ReleaseClassPreload(Job.LevelName);
+
+	if (Job.OnComplete)
+		Job.OnComplete(bSuccess);
+}
+
+void USpudState::TickTimeSlicedRestores(double TimeBudgetSeconds)
+{
+	const double Deadline = FPlatformTime::Seconds() + TimeBudgetSeconds;
+	while (PendingRestoreJobs.Num() > 0)
+	{
+		// Keep a reference of our own, completion callbacks can change PendingRestoreJobs 
+		const auto Job = PendingRestoreJobs[0];
+		bool bSuccess;
+		if (!StepPendingRestore(*Job, Deadline, bSuccess))
+			break;
+
+		PendingRestoreJobs.RemoveAt(0);
+		FinishPendingRestore(*Job, bSuccess);
+
+		if (FPlatformTime::Seconds() >= Deadline)
+			break;
+	}
+}
+
+void USpudState::CompletePendingRestore(const FString& LevelName)
+{
+	const int32 Index = PendingRestoreJobs.IndexOfByPredicate([&LevelName](const TSharedPtr<FLevelRestoreJob>& Job)
+	{
+		return Job->LevelName == LevelName;
+	});
+	if (Index == INDEX_NONE)
+		return;
+
+	const auto Job = PendingRestoreJobs[Index];
+	PendingRestoreJobs.RemoveAt(Index);
+	bool bSuccess;
+	StepPendingRestore(*Job, DBL_MAX, bSuccess);
+	FinishPendingRestore(*Job, bSuccess);
+}
+
+void USpudState::CompleteAllPendingRestores()
+{
+	while (PendingRestoreJobs.Num() > 0)
+	{
+		CompletePendingRestore(PendingRestoreJobs[0]->LevelName);
+	}
+}
+
+void USpudState::CancelAllPendingRestores()
+{
+	// Take them all first, in case the callbacks start any more
+	auto Jobs = MoveTemp(PendingRestoreJobs);
+	PendingRestoreJobs.Empty();
+	for (auto& Job : Jobs)
+	{
+		UE_LOG(LogSpudState, Log, TEXT("Cancelled restore of level %s"), *Job->LevelName);
+		FinishPendingRestore(*Job, false);
+	}
 }
 
 bool USpudState::PreLoadLevelData(const FString& LevelName)
@@ -431,6 +1094,146 @@ bool USpudState::PreLoadLevelData(const FString& LevelName)
 	return Data != nullptr;
 }
 
+void USpudState::PreLoadLevelDataAsync(const FString& LevelName, TFunction<void()> OnLoaded)
+{
+	SaveData.GetLevelDataAsync(LevelName, GetActiveGameLevelFolder(), [OnLoaded](FSpudSaveData::TLevelDataPtr)
+	{
+		if (!OnLoaded)
+			return;
+
+		if (IsInGameThread())
+			OnLoaded();
+		else
+			AsyncTask(ENamedThreads::GameThread, [OnLoaded]() { OnLoaded(); });
+	});
+}
+
+void USpudState::PreloadSpawnedActorClassesAsync(const FString& LevelName, TFunction<void()> OnLoaded)
+{
+	check(IsInGameThread());
+
+	if (auto Existing = ClassPreloads.Find(LevelName))
+	{
+		// Already on the way, just wait for that
+		const auto Preload = *Existing;
+		if (Preload->Handle.IsValid() && Preload->Handle->IsLoadingInProgress())
+		{
+			if (OnLoaded)
+				Preload->OnLoaded.Add(OnLoaded);
+			return;
+		}
+	}
+
+	// Gather the unique classes which aren't in memory yet
+	TArray<FSoftObjectPath> ClassPaths;
+	auto LevelData = SaveData.GetLevelData(LevelName, false, GetActiveGameLevelFolder());
+	if (LevelData.IsValid())
+	{
+		FSpudScopeLock LevelLock(&LevelData->Mutex);
+		if (LevelData->IsLoaded())
+		{
+			TSet<uint32> ClassIDs;
+			for (auto&& SpawnedActor : LevelData->SpawnedActors.Contents)
+			{
+				ClassIDs.Add(SpawnedActor.Value.ClassID);
+			}
+			for (const uint32 ClassID : ClassIDs)
+			{
+				// Anything which is already in memory just gets cached for the restore
+				if (!LevelData->Metadata.ResolveClass(ClassID, false))
+					ClassPaths.Add(FSoftClassPath(LevelData->Metadata.GetClassNameFromID(ClassID)));
+			}
+		}
+	}
+
+	if (ClassPaths.Num() == 0)
+	{
+		if (OnLoaded)
+			OnLoaded();
+		return;
+	}
+
+	UE_LOG(LogSpudState, Verbose, TEXT("Preloading %d spawned actor classes for level %s"), ClassPaths.Num(), *LevelName);
+	auto Preload = MakeShared<FClassPreload>();
+	if (OnLoaded)
+		Preload->OnLoaded.Add(OnLoaded);
+	ClassPreloads.Add(LevelName, Preload);
+
+	// This may call back immediately if they turn out to be loaded already
+	TWeakPtr<FClassPreload> WeakPreload(Preload);
+	Preload->Handle = UAssetManager::GetStreamableManager().RequestAsyncLoad(ClassPaths, FStreamableDelegate::CreateLambda([WeakPreload]()
+	{
+		if (const auto P = WeakPreload.Pin())
+		{
+			auto Callbacks = MoveTemp(P->OnLoaded);
+			P->OnLoaded.Empty();
+			for (auto& Callback : Callbacks)
+			{
+				Callback();
+			}
+		}
+	}));
+}
+
+void USpudState::ReleaseClassPreload(const FString& LevelName)
+{
+	TSharedPtr<FClassPreload> Preload;
+	if (ClassPreloads.RemoveAndCopyValue(LevelName, Preload))
+	{
+		// Nobody should be left waiting for this, but don't leave them stranded if they are; the classes will still
+		// load, we just don't hold on to them any more
+		auto Callbacks = MoveTemp(Preload->OnLoaded);
+		Preload->OnLoaded.Empty();
+		for (auto& Callback : Callbacks)
+		{
+			Callback();
+		}
+	}
+}
+
+void USpudState::RestoreLevelAsync(ULevel* Level, TFunction<void(bool)> OnComplete)
+{
+	TWeakObjectPtr<USpudState> WeakThis(this);
+	TWeakObjectPtr<ULevel> WeakLevel(Level);
+	PreLoadLevelDataAsync(GetLevelName(Level), [WeakThis, WeakLevel, OnComplete]()
+	{
+		const bool bRestore = WeakThis.IsValid() && WeakLevel.IsValid();
+		if (bRestore)
+			WeakThis->RestoreLevel(WeakLevel.Get());
+
+		if (OnComplete)
+			OnComplete(bRestore);
+	});
+}
+
+int64 USpudState::GetUnloadedLevelDataSize(const FString& LevelName)
+{
+	auto LevelData = SaveData.GetLevelData(LevelName, false, "");
+	if (!LevelData.IsValid())
+		return 0;
+
+	// Someone else is working on it, so it's not a candidate
+	if (!LevelData->Mutex.TryLock())
+		return 0;
+	const bool bUnloaded = LevelData->Status == LDS_Unloaded;
+	const int64 PendingSize = LevelData->PendingSource.IsSet() ? LevelData->PendingSource.Size : -1;
+	LevelData->Mutex.Unlock();
+
+	if (!bUnloaded)
+		return 0;
+	// Not extracted from the save file yet
+	if (PendingSize >= 0)
+		return PendingSize;
+
+	const int64 Size = IFileManager::Get().FileSize(*FSpudSaveData::GetLevelDataPath(GetActiveGameLevelFolder(), LevelName));
+	return FMath::Max<int64>(Size, 0);
+}
+
+void USpudState::ReleaseUnmodifiedLevelData(const FString& LevelName)
+{
+	SaveData.ReleaseUnmodifiedLevelData(LevelName);
+}
+
 void USpudState::RestoreActor(AActor* Actor)
 {
 	if (Actor->HasAnyFlags(RF_ClassDefaultObject|RF_ArchetypeObject|RF_BeginDestroyed))
@@ -453,11 +1256,12 @@ AActor* USpudState::RespawnActor(const FSpudSpawnedActorData& SpawnedActor,
                                  const FSpudClassMetadata& Meta,
                                  ULevel* Level)
 {
-	const FString ClassName = Meta.GetClassNameFromID(SpawnedActor.ClassID);
-	const FSoftClassPath CP(ClassName);
-	const auto Class = CP.TryLoadClass<AActor>();
+	SPUD_SCOPED_STAT(RespawnActor);
+	const FString& ClassName = Meta.GetClassNameFromID(SpawnedActor.ClassID);
+	// Cached per class ID, since there are often lots of actors of only a few classes
+	UClass* Class = Meta.ResolveClass(SpawnedActor.ClassID);
 
-	if (!Class)
+	if (!Class || !Class->IsChildOf(AActor::StaticClass()))
 	{
 		UE_LOG(LogSpudState, Error, TEXT("Cannot respawn instance of %s, class not found"), *ClassName);
 		return nullptr;
@@ -483,11 +1287,10 @@ AActor* USpudState::RespawnActor(const FSpudSpawnedActorData& SpawnedActor,
 	return Actor;
 }
 
-void USpudState::DestroyActor(const FSpudDestroyedLevelActor& DestroyedActor, ULevel* Level)
+void USpudState::DestroyActor(const FSpudDestroyedLevelActor& DestroyedActor, ULevel* Level, const SpudPropertyUtil::RuntimeObjectMap* RuntimeObjects)
 {
 	// We only ever have to destroy level actors, not runtime objects (those are just missing on restore)
-	auto Obj = StaticFindObject(AActor::StaticClass(), Level, *DestroyedActor.Name);
-	if (auto Actor = Cast<AActor>(Obj))
+	if (auto Actor = SpudPropertyUtil::RuntimeObjectMap::FindLevelActor(RuntimeObjects, Level, DestroyedActor.Name))
 	{
 		UE_LOG(LogSpudState, Verbose, TEXT(" * Destroying actor %s"), *DestroyedActor.Name);
 		Level->GetWorld()->DestroyActor(Actor);
@@ -529,7 +1332,7 @@ bool USpudState::ShouldActorBeRespawnedOnRestore(AActor* Actor) const
 }
 
 
-void USpudState::RestoreActor(AActor* Actor, FSpudSaveData::TLevelDataPtr LevelData, const TMap<FGuid, UObject*>* RuntimeObjects)
+void USpudState::RestoreActor(AActor* Actor, FSpudSaveData::TLevelDataPtr LevelData, const SpudPropertyUtil::RuntimeObjectMap* RuntimeObjects)
 {
 	if (Actor->HasAnyFlags(RF_ClassDefaultObject|RF_ArchetypeObject|RF_BeginDestroyed))
 		return;
@@ -550,12 +1353,16 @@ void USpudState::RestoreActor(AActor* Actor, FSpudSaveData::TLevelDataPtr LevelD
 
 	if (ActorData)
 	{
+		SPUD_SCOPED_STAT(RestoreActor);
 		PreRestoreObject(Actor, LevelData->GetUserDataModelVersion());
 		
 		RestoreCoreActorData(Actor, ActorData->CoreData);
 		RestoreObjectProperties(Actor, ActorData->Properties, LevelData->Metadata, RuntimeObjects);
+		// Now matches the stored data; done before PostRestore so that can mark it dirty again if it wants
+		DirtyActors.Remove(Actor);
 
 		PostRestoreObject(Actor, ActorData->CustomData, LevelData->GetUserDataModelVersion());		
+		SPUD_COUNT(ActorsRestored, 1);
 	}
 }
 
@@ -579,10 +1386,11 @@ void USpudState::PostRestoreObject(UObject* Obj, const FSpudCustomData& FromCust
 		if (GCurrentUserDataModelVersion != StoredUserVersion)
 			ISpudObjectCallback::Execute_SpudPostRestoreDataModelUpgrade(Obj, this, StoredUserVersion, GCurrentUserDataModelVersion);
 
-		FMemoryReader Reader(FromCustomData.Data);
-		auto CustomData = NewObject<USpudStateCustomData>();
-		CustomData->Init(&Reader);
-		ISpudObjectCallback::Execute_SpudRestoreCustomData(Obj, this, CustomData);
+		FSpudMemoryViewReader Reader(FromCustomData.GetData());
+		{
+			FCustomDataScope CustomData(*this, &Reader);
+			ISpudObjectCallback::Execute_SpudRestoreCustomData(Obj, this, CustomData.Wrapper);
+		}
 		ISpudObjectCallback::Execute_SpudPostRestore(Obj, this);
 	}
 }
@@ -592,15 +1400,20 @@ void USpudState::RestoreCoreActorData(AActor* Actor, const FSpudCoreActorData& F
 	// Restore core data based on version
 	// Unlike properties this is packed data, versioned
 
-	FMemoryReader In(FromData.Data);
+	FSpudMemoryViewReader In(FromData.GetData());
 	
 	// All formats have version number first (this is separate from the file version)
 	uint16 InVersion = 0;
 	SpudPropertyUtil::ReadRaw(InVersion, In);
 
+	bool Hidden = false;
+	bool bHasTransform = false;
+	FTransform XForm = FTransform::Identity;
+	FVector Velocity = FVector::ZeroVector;
+	FVector AngularVelocity = FVector::ZeroVector;
+	FRotator ControlRotation = FRotator::ZeroRotator;
 	if (InVersion == 1)
 	{
-		// First, and only version right now
 		// V1 Format:
 		// - Version (uint16)
 		// - Hidden (bool)
@@ -609,76 +1422,98 @@ void USpudState::RestoreCoreActorData(AActor* Actor, const FSpudCoreActorData& F
 		// - AngularVelocity (FVector)
 		// - Control rotation (FRotator) (non-zero for Pawns only)
 
-		bool Hidden;
 		SpudPropertyUtil::ReadRaw(Hidden, In);
-		Actor->SetActorHiddenInGame(Hidden);
-
-		FTransform XForm;
 		SpudPropertyUtil::ReadRaw(XForm, In);
-
-		FVector Velocity, AngularVelocity;
+		bHasTransform = true;
 		SpudPropertyUtil::ReadRaw(Velocity, In);
 		SpudPropertyUtil::ReadRaw(AngularVelocity, In);
-
-		FRotator ControlRotation;
 		SpudPropertyUtil::ReadRaw(ControlRotation, In);
-
-
-		auto Pawn = Cast<APawn>(Actor);
-		if (Pawn && Pawn->IsPlayerControlled() &&
-			!GetSpudSubsystem(Pawn->GetWorld())->IsLoadingGame())
+	}
+	else if (InVersion == 2)
+	{
+		// V2 Format: see WriteCoreActorData
+		uint8 Flags;
+		SpudPropertyUtil::ReadRaw(Flags, In);
+		Hidden = (Flags & SCDF_Hidden) != 0;
+		bHasTransform = (Flags & SCDF_Transform) != 0;
+		if (bHasTransform)
 		{
-			// This is a player-controlled pawn, and we're not loading the game
-			// That means this was a map transition. In this case we do NOT want to reset the pawn's position
-			// because we don't know that the player wants to appear at the last place they were
-			// Let user code decide which player start is used
-			// SKIP the rest - but we must have still read data above
-			return;
-			
+			FVector Location;
+			FQuat Rotation;
+			SpudPropertyUtil::ReadRaw(Location, In);
+			SpudPropertyUtil::ReadRaw(Rotation, In);
+			XForm.SetLocation(Location);
+			XForm.SetRotation(Rotation);
 		}
-
-		const auto RootComp = Actor->GetRootComponent();
-		if (RootComp && RootComp->Mobility == EComponentMobility::Movable)
+		if (Flags & SCDF_Scale)
 		{
-			// Only set the actor transform if movable, to avoid editor warnings about static/stationary objects
-			Actor->SetActorTransform(XForm, false, nullptr, ETeleportType::ResetPhysics);
-			
-			if (Velocity.SizeSquared() > FLT_EPSILON || AngularVelocity.SizeSquared() > FLT_EPSILON)
-			{
-				const auto PrimComp = Cast<UPrimitiveComponent>(RootComp);
-
-				// note: DO NOT use IsSimulatingPhysics() since that's dependent on BodyInstance.BodySetup being valid, which
-				// it might not be at setup. We only want the *intention* to simulate physics, not whether it's currently happening
-				if (PrimComp && PrimComp->BodyInstance.bSimulatePhysics)
-				{
-					PrimComp->SetAllPhysicsLinearVelocity(Velocity);
-					PrimComp->SetAllPhysicsAngularVelocityInDegrees(AngularVelocity);
-				}
-				else if (const auto	MoveComponent = Cast<UMovementComponent>(Actor->FindComponentByClass(UMovementComponent::StaticClass())))
-				{
-					MoveComponent->Velocity = Velocity;
-				}
-			}
+			FVector Scale;
+			SpudPropertyUtil::ReadRaw(Scale, In);
+			XForm.SetScale3D(Scale);
 		}
+		if (Flags & SCDF_Velocity)
+			SpudPropertyUtil::ReadRaw(Velocity, In);
+		if (Flags & SCDF_AngularVelocity)
+			SpudPropertyUtil::ReadRaw(AngularVelocity, In);
+		if (Flags & SCDF_ControlRotation)
+			SpudPropertyUtil::ReadRaw(ControlRotation, In);
+	}
+	else
+	{
+		UE_LOG(LogSpudState, Error, TEXT("Core Actor Data for %s is corrupt, not restoring"), *Actor->GetName())
+		return;
+	}
 
+	Actor->SetActorHiddenInGame(Hidden);
 
-		if (Pawn)
+	auto Pawn = Cast<APawn>(Actor);
+	if (Pawn && Pawn->IsPlayerControlled() &&
+		!GetSpudSubsystem(Pawn->GetWorld())->IsLoadingGame())
+	{
+		// This is a player-controlled pawn, and we're not loading the game
+		// That means this was a map transition. In this case we do NOT want to reset the pawn's position
+		// because we don't know that the player wants to appear at the last place they were
+		// Let user code decide which player start is used
+		// SKIP the rest
+		return;
+		
+	}
+
+	const auto RootComp = Actor->GetRootComponent();
+	if (bHasTransform && RootComp && RootComp->Mobility == EComponentMobility::Movable)
+	{
+		// Only set the actor transform if movable, to avoid editor warnings about static/stationary objects
+		Actor->SetActorTransform(XForm, false, nullptr, ETeleportType::ResetPhysics);
+		
+		if (Velocity.SizeSquared() > FLT_EPSILON || AngularVelocity.SizeSquared() > FLT_EPSILON)
 		{
-			if (auto Controller = Pawn->GetController())
+			const auto PrimComp = Cast<UPrimitiveComponent>(RootComp);
+
+			// note: DO NOT use IsSimulatingPhysics() since that's dependent on BodyInstance.BodySetup being valid, which
+			// it might not be at setup. We only want the *intention* to simulate physics, not whether it's currently happening
+			if (PrimComp && PrimComp->BodyInstance.bSimulatePhysics)
+			{
+				PrimComp->SetAllPhysicsLinearVelocity(Velocity);
+				PrimComp->SetAllPhysicsAngularVelocityInDegrees(AngularVelocity);
+			}
+			else if (const auto	MoveComponent = Cast<UMovementComponent>(Actor->FindComponentByClass(UMovementComponent::StaticClass())))
 			{
-				Controller->SetControlRotation(ControlRotation);
+				MoveComponent->Velocity = Velocity;
 			}
 		}
-
 	}
-	else
+
+
+	if (Pawn)
 	{
-		UE_LOG(LogSpudState, Error, TEXT("Core Actor Data for %s is corrupt, not restoring"), *Actor->GetName())
-		return;
+		if (auto Controller = Pawn->GetController())
+		{
+			Controller->SetControlRotation(ControlRotation);
+		}
 	}
 }
 
-void USpudState::RestoreObjectProperties(UObject* Obj, const FSpudPropertyData& FromData, const FSpudClassMetadata& Meta, const TMap<FGuid, UObject*>* RuntimeObjects)
+void USpudState::RestoreObjectProperties(UObject* Obj, const FSpudPropertyData& FromData, const FSpudClassMetadata& Meta, const SpudPropertyUtil::RuntimeObjectMap* RuntimeObjects)
 {
 	const auto ClassName = SpudPropertyUtil::GetClassName(Obj);
 	const auto ClassDef = Meta.GetClassDef(ClassName);
@@ -695,21 +1530,37 @@ void USpudState::RestoreObjectProperties(UObject* Obj, const FSpudPropertyData&
 	UE_LOG(LogSpudState, Verbose, TEXT(" |- Class: %s"), *ClassDef->ClassName);
 
 	if (bUseFastPath)
+	{
+		SPUD_SCOPED_STAT(RestoreFastPath);
+		SPUD_COUNT(FastPathRestores, 1);
 		RestoreObjectPropertiesFast(Obj, FromData, Meta, ClassDef, RuntimeObjects);
+	}
 	else
+	{
+		SPUD_SCOPED_STAT(RestoreSlowPath);
+		SPUD_COUNT(SlowPathRestores, 1);
 		RestoreObjectPropertiesSlow(Obj, FromData, Meta, ClassDef, RuntimeObjects);
+	}
 }
 
 
 void USpudState::RestoreObjectPropertiesFast(UObject* Obj, const FSpudPropertyData& FromData,
                                                        const FSpudClassMetadata& Meta,
                                                        const FSpudClassDef* ClassDef,
-                                                       const TMap<FGuid, UObject*>* RuntimeObjects)
+                                                       const SpudPropertyUtil::RuntimeObjectMap* RuntimeObjects)
 {
 	UE_LOG(LogSpudState, Verbose, TEXT(" |- FAST path, %d properties"), ClassDef->Properties.Num());
 	const auto StoredPropertyIterator = ClassDef->Properties.CreateConstIterator();
 
-	FMemoryReader In(FromData.Data);
+	FSpudMemoryViewReader In(FromData.GetData());
+
+	const auto Plan = FSpudPropertyPlan::Get(Obj->GetClass());
+	if (Plan.IsValid() && Plan->CanRestore(*ClassDef, Meta))
+	{
+		Plan->Restore(Obj, *ClassDef, Meta, RuntimeObjects, In);
+		return;
+	}
+
 	RestoreFastPropertyVisitor Visitor(this, StoredPropertyIterator, In, *ClassDef, Meta, RuntimeObjects);
 	SpudPropertyUtil::VisitPersistentProperties(Obj, Visitor);
 	
@@ -718,12 +1569,21 @@ void USpudState::RestoreObjectPropertiesFast(UObject* Obj, const FSpudPropertyDa
 void USpudState::RestoreObjectPropertiesSlow(UObject* Obj, const FSpudPropertyData& FromData,
                                                        const FSpudClassMetadata& Meta,
                                                        const FSpudClassDef* ClassDef,
-                                                       const TMap<FGuid, UObject*>* RuntimeObjects)
+                                                       const SpudPropertyUtil::RuntimeObjectMap* RuntimeObjects)
 {
 	UE_LOG(LogSpudState, Verbose, TEXT(" |- SLOW path, %d properties"), ClassDef->Properties.Num());
 
-	FMemoryReader In(FromData.Data);
-	RestoreSlowPropertyVisitor Visitor(this, In, *ClassDef, Meta, RuntimeObjects);
+	FSpudMemoryViewReader In(FromData.GetData());
+
+	// The plan works out where each property was stored once per class def, rather than looking up each one by name
+	const auto Plan = FSpudPropertyPlan::Get(Obj->GetClass());
+	if (Plan.IsValid() && Plan->IsValid())
+	{
+		Plan->RestoreRemapped(Obj, *ClassDef, Meta, RuntimeObjects, FromData.PropertyOffsets, In);
+		return;
+	}
+
+	RestoreSlowPropertyVisitor Visitor(this, In, *ClassDef, Meta, RuntimeObjects, FromData.PropertyOffsets);
 	SpudPropertyUtil::VisitPersistentProperties(Obj, Visitor);
 }
 
@@ -812,6 +1672,9 @@ bool USpudState::RestoreSlowPropertyVisitor::VisitProperty(UObject* RootObject,
 		return true;		
 	}
 	auto& StoredProperty = ClassDef.Properties[*PropertyIndexPtr];
+	// Stored properties may be in a different order, or include some which no longer exist
+	if (PropertyOffsets.IsValidIndex(*PropertyIndexPtr))
+		DataIn.Seek(PropertyOffsets[*PropertyIndexPtr]);
 	
 	SpudPropertyUtil::RestoreProperty(RootObject, Property, ContainerPtr, StoredProperty, RuntimeObjects, Meta, DataIn);
 	return true;
@@ -865,11 +1728,13 @@ void USpudState::RestoreGlobalObject(UObject* Obj, const FSpudNamedObjectData* D
 	}
 	
 }
-void USpudState::StoreActor(AActor* Actor, FSpudSaveData::TLevelDataPtr LevelData)
+void USpudState::StoreActor(AActor* Actor, FSpudSaveData::TLevelDataPtr LevelData, TArray<FDeferredPropertyStore>* Deferred)
 {
 	if (Actor->HasAnyFlags(RF_ClassDefaultObject|RF_ArchetypeObject|RF_BeginDestroyed))
 		return;
 
+	SPUD_SCOPED_STAT(StoreActor);
+
 	// GetUniqueID() is unique in the current play session but not across games
 	// GetFName() is unique within a level, and stable for objects loaded from a level
 	// For runtime created objects we need another stable GUID
@@ -886,7 +1751,8 @@ void USpudState::StoreActor(AActor* Actor, FSpudSaveData::TLevelDataPtr LevelDat
 	TArray<uint8>* pDestPropertyData = nullptr;
 	TArray<uint8>* pDestCustomData = nullptr;
 	FSpudClassMetadata& Meta = LevelData->Metadata;
-	FSpudClassDef& ClassDef = Meta.FindOrAddClassDef(SpudPropertyUtil::GetClassName(Actor));
+	const FString ClassName = SpudPropertyUtil::GetClassName(Actor);
+	FSpudClassDef& ClassDef = Meta.FindOrAddClassDef(ClassName);
 	TArray<uint32>* pOffsets = nullptr;
 	if (bRespawn)
 	{
@@ -926,7 +1792,8 @@ void USpudState::StoreActor(AActor* Actor, FSpudSaveData::TLevelDataPtr LevelDat
 	else
 		UE_LOG(LogSpudState, Verbose, TEXT("* STORE Level Actor: %s/%s"), *LevelData->Name, *Name);
 
-	pDestPropertyData->Empty();
+	// Buffers are Reset rather than emptied, so that storing over existing data doesn't reallocate
+	pDestPropertyData->Reset();
 	FMemoryWriter PropertyWriter(*pDestPropertyData);
 
 	bool bIsCallback = Actor->GetClass()->ImplementsInterface(USpudObjectCallback::StaticClass());
@@ -935,38 +1802,54 @@ void USpudState::StoreActor(AActor* Actor, FSpudSaveData::TLevelDataPtr LevelDat
 		ISpudObjectCallback::Execute_SpudPreStore(Actor, this);
 
 	// Core data first
-	pDestCoreData->Empty();
+	pDestCoreData->Reset();
 	FMemoryWriter CoreDataWriter(*pDestCoreData);
 	WriteCoreActorData(Actor, CoreDataWriter);
 
 	// Now properties, visit all and write out
-	StorePropertyVisitor Visitor(this, ClassDef, *pOffsets, Meta, PropertyWriter);
-	SpudPropertyUtil::VisitPersistentProperties(Actor, Visitor);
+	// If allowed, actors that don't need calling back can have that done later, off the game thread
+	if (Deferred && !bIsCallback)
+	{
+		auto Plan = FSpudPropertyPlan::Get(Actor->GetClass());
+		if (Plan.IsValid() && Plan->IsValid())
+		{
+			Deferred->Add(FDeferredPropertyStore { Actor, Plan, ClassName, Actor->GetFName(), Guid, bRespawn });
+			DirtyActors.Remove(Actor);
+			return;
+		}
+	}
+	StoreObjectProperties(Actor, ClassDef, *pOffsets, Meta, PropertyWriter);
 
 	if (bIsCallback)
 	{
 		if (pDestCustomData)
 		{
-			pDestCustomData->Empty();
+			pDestCustomData->Reset();
 			FMemoryWriter CustomDataWriter(*pDestCustomData);
-			auto CustomDataStruct = NewObject<USpudStateCustomData>();
-			CustomDataStruct->Init(&CustomDataWriter);
-			ISpudObjectCallback::Execute_SpudStoreCustomData(Actor, this, CustomDataStruct);
+			FCustomDataScope CustomData(*this, &CustomDataWriter);
+			ISpudObjectCallback::Execute_SpudStoreCustomData(Actor, this, CustomData.Wrapper);
 		}			
 	
 		ISpudObjectCallback::Execute_SpudPostStore(Actor, this);
 	}
+
+	// Stored data is now up to date
+	DirtyActors.Remove(Actor);
+	SPUD_COUNT(ActorsStored, 1);
 }
 
 
 void USpudState::StoreLevelActorDestroyed(AActor* Actor, FSpudSaveData::TLevelDataPtr LevelData)
 {
+	// The level may be being written in the background (async save), so lock
+	FSpudScopeLock LevelLock(&LevelData->Mutex);
 	// We don't check for duplicates, because it should only be possible to destroy a uniquely named level actor once
 	LevelData->DestroyedActors.Add(SpudPropertyUtil::GetLevelActorName(Actor));
 }
 
 void USpudState::SaveToArchive(FArchive& Ar)
 {
+	SPUD_SCOPED_STAT(WriteSaveGame);
 	// We use separate read / write in order to more clearly support chunked file format
 	// with the backwards compatibility that comes with 
 	FSpudChunkedDataArchive ChunkedAr(Ar);
@@ -976,15 +1859,60 @@ void USpudState::SaveToArchive(FArchive& Ar)
 
 }
 
-void USpudState::LoadFromArchive(FArchive& Ar, bool bFullyLoadAllLevelData)
+void USpudState::LoadFromArchive(FArchive& Ar, bool bFullyLoadAllLevelData, const FString& SourceFilename)
+{
+	// Firstly, destroy any active game level files. Drop the existing data before that, since loaded levels can
+	// have their files mapped
+	SaveData.Reset();
+	RemoveAllActiveGameLevelFiles();
+
+	Source = Ar.GetArchiveName();
+	
+	SPUD_SCOPED_STAT(ReadSaveGame);
+	FSpudChunkedDataArchive ChunkedAr(Ar);
+	SaveData.ReadFromArchive(ChunkedAr, bFullyLoadAllLevelData, GetActiveGameLevelFolder(), SourceFilename);
+}
+
+bool USpudState::LoadFromArchiveStaged(FArchive& Ar, TFunctionRef<void()> OnInitialDataReady, const FString& SourceFilename)
 {
-	// Firstly, destroy any active game level files
+	// Same as LoadFromArchive
+	SaveData.Reset();
 	RemoveAllActiveGameLevelFiles();
 
 	Source = Ar.GetArchiveName();
 	
+	SPUD_SCOPED_STAT(ReadSaveGame);
 	FSpudChunkedDataArchive ChunkedAr(Ar);
-	SaveData.ReadFromArchive(ChunkedAr, bFullyLoadAllLevelData, GetActiveGameLevelFolder());
+	return SaveData.ReadFromArchiveStaged(ChunkedAr, GetActiveGameLevelFolder(), OnInitialDataReady, SourceFilename);
+}
+
+void USpudState::ExtractPendingLevelData()
+{
+	SaveData.ExtractPendingLevelData(GetActiveGameLevelFolder());
+}
+
+FSpudStateSnapshot::Ptr USpudState::CaptureSnapshot(const FString& Name, const FSpudStateSnapshot* Previous)
+{
+	return SaveData.CaptureSnapshot(Name, GetActiveGameLevelFolder(), Previous);
+}
+
+void USpudState::RestoreSnapshot(const FSpudStateSnapshot& Snapshot)
+{
+	ResetState();
+	Source = Snapshot.Name;
+	SaveData.RestoreSnapshot(Snapshot);
+}
+
+void USpudState::WriteSnapshotToArchive(const FSpudStateSnapshot& Snapshot, FArchive& Ar, const FText& Title)
+{
+	SPUD_SCOPED_STAT(WriteSaveGame);
+	// Levels all come straight from the snapshot's data, so a temporary save data is all we need to write it
+	FSpudSaveData Data;
+	Data.RestoreSnapshot(Snapshot);
+	if (!Title.IsEmpty())
+		Data.Info.Title = Title;
+	FSpudChunkedDataArchive ChunkedAr(Ar);
+	Data.WriteToArchive(ChunkedAr, FString());
 }
 
 bool USpudState::IsLevelDataLoaded(const FString& LevelName)
@@ -1011,6 +1939,7 @@ bool USpudState::LoadSaveInfoFromArchive(FArchive& Ar, USpudSaveGameInfo& OutInf
 	{
 		OutInfo.Title = StorageInfo.Title;
 		OutInfo.Timestamp = StorageInfo.Timestamp;
+		OutInfo.bHasThumbnail = StorageInfo.Screenshot.ImageData.Num() > 0;
 		if (StorageInfo.Screenshot.ImageData.Num() > 0)
 			OutInfo.Thumbnail = FImageUtils::ImportBufferAsTexture2D(StorageInfo.Screenshot.ImageData);
 		else
@@ -1022,9 +1951,84 @@ bool USpudState::LoadSaveInfoFromArchive(FArchive& Ar, USpudSaveGameInfo& OutInf
 	
 }
 
+void USpudSaveGameInfo::LoadThumbnailAsync()
+{
+	if (Thumbnail || !bHasThumbnail || Filename.IsEmpty())
+	{
+		OnThumbnailLoaded.Broadcast(this);
+		return;
+	}
+	if (bThumbnailLoadPending)
+		return;
+
+	bThumbnailLoadPending = true;
+	// Module loading has to happen on the game thread, the decoding itself doesn't
+	IImageWrapperModule* ImageWrapperModule = &FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+	TWeakObjectPtr<USpudSaveGameInfo> WeakThis(this);
+	const FString File = Filename;
+	Async(EAsyncExecution::ThreadPool, [WeakThis, File, ImageWrapperModule]()
+	{
+		// Reading the header & decompressing the PNG is the expensive part, only creating the texture needs the game thread
+		int32 Width = 0, Height = 0;
+		TArray<uint8> RawData;
+		auto Archive = TUniquePtr<FArchive>(IFileManager::Get().CreateFileReader(*File));
+		if (Archive)
+		{
+			FSpudChunkedDataArchive ChunkedAr(*Archive);
+			FSpudSaveInfo StorageInfo;
+			if (FSpudSaveData::ReadSaveInfoFromArchive(ChunkedAr, StorageInfo) &&
+				StorageInfo.Screenshot.ImageData.Num() > 0)
+			{
+				const auto& ImageData = StorageInfo.Screenshot.ImageData;
+				const EImageFormat Format = ImageWrapperModule->DetectImageFormat(ImageData.GetData(), ImageData.Num());
+				TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule->CreateImageWrapper(Format);
+				if (ImageWrapper.IsValid() && ImageWrapper->SetCompressed(ImageData.GetData(), ImageData.Num()) &&
+					ImageWrapper->GetRaw(ERGBFormat::BGRA, 8, RawData))
+				{
+					Width = ImageWrapper->GetWidth();
+					Height = ImageWrapper->GetHeight();
+				}
+			}
+			Archive->Close();
+		}
+		if (Width == 0)
+			UE_LOG(LogSpudState, Warning, TEXT("Unable to load thumbnail from %s"), *File);
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, Width, Height, RawData = MoveTemp(RawData)]()
+		{
+			if (!WeakThis.IsValid())
+				return;
+
+			WeakThis->bThumbnailLoadPending = false;
+			if (Width > 0 && Height > 0)
+				WeakThis->Thumbnail = CreateThumbnailTexture(Width, Height, RawData);
+			WeakThis->OnThumbnailLoaded.Broadcast(WeakThis.Get());
+		});
+	});
+}
+
+UTexture2D* USpudSaveGameInfo::CreateThumbnailTexture(int32 Width, int32 Height, const TArray<uint8>& BGRAData)
+{
+	// This is the part of FImageUtils::ImportBufferAsTexture2D which has to be on the game thread
+	UTexture2D* Tex = UTexture2D::CreateTransient(Width, Height, PF_B8G8R8A8);
+	if (!Tex || BGRAData.Num() != Width * Height * 4)
+		return nullptr;
+
+	FTexture2DMipMap& Mip = Tex->PlatformData->Mips[0];
+	void* Dest = Mip.BulkData.Lock(LOCK_READ_WRITE);
+	FMemory::Memcpy(Dest, BGRAData.GetData(), BGRAData.Num());
+	Mip.BulkData.Unlock();
+	Tex->UpdateResource();
+
+	return Tex;
+}
+
 
 FString USpudState::GetActiveGameLevelFolder()
 {
+	if (!LevelCacheFolder.IsEmpty())
+		return LevelCacheFolder;
+
 	return FString::Printf(TEXT("%sSpudCache/"), *FPaths::ProjectSavedDir());	
 }
 
@@ -1060,9 +2064,12 @@ bool USpudState::RenameClass(const FString& OldClassName, const FString& NewClas
 	// to have the correct class name. Everything else doesn't really, the class ID is just used to find
 	// the property def in the save file which will still work even if the runtime class isn't called that any more
 	bool Changed = SaveData.GlobalData.Metadata.RenameClass(OldClassName, NewClassName);
-	for (auto && Pair : SaveData.LevelDataMap)
+	for (auto && LevelData : SaveData.GetLevelDataSnapshot())
 	{
-		Changed = Pair.Value->Metadata.RenameClass(OldClassName, NewClassName) || Changed;
+		Changed = ModifyLevelMetadata(LevelData, [&](FSpudClassMetadata& Meta)
+		{
+			return Meta.RenameClass(OldClassName, NewClassName);
+		}) || Changed;
 	}
 	return Changed;
 }
@@ -1077,13 +2084,42 @@ bool USpudState::RenameProperty(const FString& ClassName, const FString& OldProp
 	// But still only affects metadata; instances just have a list of data offsets corresponding with the class def,
 	// which is what looks after the naming
 	bool Changed = SaveData.GlobalData.Metadata.RenameProperty(ClassName, OldPropertyName, NewPropertyName, OldPrefix, NewPrefix);
-	for (auto && Pair : SaveData.LevelDataMap)
+	for (auto && LevelData : SaveData.GetLevelDataSnapshot())
 	{
-		Changed = Pair.Value->Metadata.RenameProperty(ClassName, OldPropertyName, NewPropertyName, OldPrefix, NewPrefix) || Changed;
+		Changed = ModifyLevelMetadata(LevelData, [&](FSpudClassMetadata& Meta)
+		{
+			return Meta.RenameProperty(ClassName, OldPropertyName, NewPropertyName, OldPrefix, NewPrefix);
+		}) || Changed;
 	}
 	return Changed;
 }
 
+bool USpudState::ModifyLevelMetadata(FSpudSaveData::TLevelDataPtr LevelData, TFunctionRef<bool(FSpudClassMetadata&)> Modifier)
+{
+	bool bWasLoaded;
+	{
+		FSpudScopeLock LevelLock(&LevelData->Mutex);
+		bWasLoaded = LevelData->Status != LDS_Unloaded;
+	}
+	if (!bWasLoaded)
+		FSpudSaveData::LoadLevelDataIfNeeded(LevelData, FSpudSaveData::GetLevelDataPath(GetActiveGameLevelFolder(), LevelData->Name));
+
+	bool bChanged;
+	{
+		FSpudScopeLock LevelLock(&LevelData->Mutex);
+		bChanged = Modifier(LevelData->Metadata);
+	}
+
+	if (!bWasLoaded)
+	{
+		if (bChanged)
+			SaveData.WriteAndReleaseLevelData(LevelData->Name, GetActiveGameLevelFolder(), true);
+		else
+			SaveData.ReleaseUnmodifiedLevelData(LevelData->Name);
+	}
+	return bChanged;
+}
+
 bool USpudState::RenameGlobalObject(const FString& OldName, const FString& NewName)
 {
 	return SaveData.GlobalData.Objects.RenameObject(OldName, NewName);
@@ -1094,7 +2130,7 @@ bool USpudState::RenameLevelObject(const FString& LevelName, const FString& OldN
 	auto LevelData = GetLevelData(LevelName, false);
 	if (LevelData.IsValid())
 	{
-		FScopeLock LevelLock(&LevelData->Mutex);
+		FSpudScopeLock LevelLock(&LevelData->Mutex);
 
 		return LevelData->LevelActors.RenameObject(OldName, NewName);
 	}
@@ -1104,11 +2140,9 @@ bool USpudState::RenameLevelObject(const FString& LevelName, const FString& OldN
 TArray<FString> USpudState::GetLevelNames(bool bLoadedOnly)
 {
 	TArray<FString> Ret;
-	FScopeLock MapLock(&SaveData.LevelDataMapMutex);
-	for (auto && Pair : SaveData.LevelDataMap)
+	for (auto && Lvl : SaveData.GetLevelDataSnapshot())
 	{
-		auto Lvl = Pair.Value;
-		FScopeLock LvlLock(&Lvl->Mutex);
+		FSpudScopeLock LvlLock(&Lvl->Mutex);
 		if (!bLoadedOnly || Lvl->Status != LDS_Unloaded)
 		{
 			Ret.Add(Lvl->Name);
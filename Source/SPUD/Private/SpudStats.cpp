@@ -0,0 +1,74 @@
+#include "SpudStats.h"
+
+DEFINE_STAT(STAT_SpudStoreLevel);
+DEFINE_STAT(STAT_SpudStoreActor);
+DEFINE_STAT(STAT_SpudStoreDeferredProperties);
+DEFINE_STAT(STAT_SpudRestoreLevel);
+DEFINE_STAT(STAT_SpudRespawnActor);
+DEFINE_STAT(STAT_SpudRestoreActor);
+DEFINE_STAT(STAT_SpudRestoreFastPath);
+DEFINE_STAT(STAT_SpudRestoreSlowPath);
+DEFINE_STAT(STAT_SpudWriteSaveGame);
+DEFINE_STAT(STAT_SpudReadSaveGame);
+DEFINE_STAT(STAT_SpudLoadLevelData);
+DEFINE_STAT(STAT_SpudWriteLevelData);
+DEFINE_STAT(STAT_SpudPipeLevelData);
+DEFINE_STAT(STAT_SpudParseLevelData);
+DEFINE_STAT(STAT_SpudCaptureSnapshot);
+DEFINE_STAT(STAT_SpudEncodeScreenshot);
+
+DEFINE_STAT(STAT_SpudActorsStored);
+DEFINE_STAT(STAT_SpudActorsRestored);
+DEFINE_STAT(STAT_SpudFastPathRestores);
+DEFINE_STAT(STAT_SpudSlowPathRestores);
+DEFINE_STAT(STAT_SpudBytesRead);
+DEFINE_STAT(STAT_SpudBytesWritten);
+DEFINE_STAT(STAT_SpudLockWaitMs);
+
+CSV_DEFINE_CATEGORY_MODULE(SPUD_API, Spud, true);
+
+TAtomic<int64> FSpudMetrics::Counters[static_cast<int32>(ESpudCounter::Num)];
+
+FSpudMetrics::FSnapshot FSpudMetrics::Snapshot()
+{
+	FSnapshot Ret;
+	for (int32 i = 0; i < static_cast<int32>(ESpudCounter::Num); ++i)
+	{
+		Ret.Values[i] = Counters[i].Load();
+	}
+	Ret.Cycles = FPlatformTime::Cycles64();
+	return Ret;
+}
+
+void FSpudOperationTracker::Begin(ESpudOperation InOperation, const FString& InTarget)
+{
+	Operation = InOperation;
+	Target = InTarget;
+	Start = FSpudMetrics::Snapshot();
+	bActive = true;
+}
+
+FSpudOperationMetrics FSpudOperationTracker::Finish(bool bSuccess)
+{
+	const auto End = FSpudMetrics::Snapshot();
+	auto Delta = [this, &End](ESpudCounter Counter)
+	{
+		return End.Get(Counter) - Start.Get(Counter);
+	};
+
+	FSpudOperationMetrics Ret;
+	Ret.Operation = Operation;
+	Ret.Target = Target;
+	Ret.bSuccess = bSuccess;
+	Ret.DurationMs = FPlatformTime::ToMilliseconds64(End.Cycles - Start.Cycles);
+	Ret.ActorsStored = static_cast<int32>(Delta(ESpudCounter::ActorsStored));
+	Ret.ActorsRestored = static_cast<int32>(Delta(ESpudCounter::ActorsRestored));
+	Ret.FastPathRestores = static_cast<int32>(Delta(ESpudCounter::FastPathRestores));
+	Ret.SlowPathRestores = static_cast<int32>(Delta(ESpudCounter::SlowPathRestores));
+	Ret.BytesRead = Delta(ESpudCounter::BytesRead);
+	Ret.BytesWritten = Delta(ESpudCounter::BytesWritten);
+	Ret.LockWaitMs = FPlatformTime::ToMilliseconds64(Delta(ESpudCounter::LockWaitCycles));
+
+	bActive = false;
+	return Ret;
+}
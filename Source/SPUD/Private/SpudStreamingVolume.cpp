@@ -3,6 +3,8 @@
 #include "Engine/CollisionProfile.h"
 #include "SpudSubsystem.h"
 #include "Components/BrushComponent.h"
+#include "Camera/PlayerCameraManager.h"
+#include "GameFramework/PlayerController.h"
 #include "Kismet/GameplayStatics.h"
 
 ASpudStreamingVolume::ASpudStreamingVolume(const FObjectInitializer& ObjectInitializer)
@@ -21,6 +23,10 @@ ASpudStreamingVolume::ASpudStreamingVolume(const FObjectInitializer& ObjectIniti
 	BrushColor.G = 165;
 	BrushColor.B = 0;
 	BrushColor.A = 255;
+
+	// Only ticks to check the prefetch margin, if there is one
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
 }
 
 void ASpudStreamingVolume::BeginPlay()
@@ -36,6 +42,12 @@ void ASpudStreamingVolume::BeginPlay()
 	{
 		GI->GetOnPawnControllerChanged().AddDynamic(this, &ASpudStreamingVolume::OnPawnControllerChanged);
 	}
+
+	if (PrefetchMargin > 0)
+	{
+		SetActorTickInterval(PrefetchCheckInterval);
+		SetActorTickEnabled(true);
+	}
 	
 }
 
@@ -48,9 +60,61 @@ void ASpudStreamingVolume::EndPlay(const EEndPlayReason::Type EndPlayReason)
 	{
 		GI->GetOnPawnControllerChanged().RemoveDynamic(this, &ASpudStreamingVolume::OnPawnControllerChanged);
 	}
+
+	SetPrefetchRequested(false);
 	
 }
 
+void ASpudStreamingVolume::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	SetPrefetchRequested(IsAnyPlayerWithinPrefetchMargin());
+}
+
+bool ASpudStreamingVolume::IsAnyPlayerWithinPrefetchMargin() const
+{
+	// Same idea as relevant actors, player controlled pawns and cameras, just with a bit of room around the volume
+	for (auto It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PC = It->Get();
+		if (!PC)
+			continue;
+
+		const APawn* Pawn = PC->GetPawn();
+		if (Pawn && EncompassesPoint(Pawn->GetActorLocation(), PrefetchMargin))
+			return true;
+
+		if (PC->PlayerCameraManager && EncompassesPoint(PC->PlayerCameraManager->GetCameraLocation(), PrefetchMargin))
+			return true;
+	}
+	return false;
+}
+
+void ASpudStreamingVolume::SetPrefetchRequested(bool bRequest)
+{
+	if (bRequest == bPrefetchRequested)
+		return;
+
+	bPrefetchRequested = bRequest;
+	auto PS = GetSpudSubsystem(GetWorld());
+	if (PS)
+	{
+		for (auto Level : StreamingLevels)
+		{
+			if (!Level.IsNull())
+			{
+				// Can't use GetAssetPathName in PIE because it gets prefixed with UEDPIE_0_ for uniqueness with editor version
+				const FName LevelName = FName(Level.GetAssetName());
+				if (bRequest)
+					PS->AddPrefetchRequestForStreamingLevel(this, LevelName);
+				else
+					PS->WithdrawPrefetchRequestForStreamingLevel(this, LevelName);
+			}
+		}
+	}
+}
+
 bool ASpudStreamingVolume::IsRelevantActor(AActor* Actor) const
 {
 	// This gets called for Cameras and Pawns (I just prefer this to cameras-only for 3rd person setups, having to
@@ -131,7 +195,7 @@ void ASpudStreamingVolume::AddRelevantActor(AActor* Actor)
 					// Can't use GetAssetPathName in PIE because it gets prefixed with UEDPIE_0_ for uniqueness with editor version
 					const FName LevelName = FName(Level.GetAssetName());
 					//UE_LOG(LogTemp, Verbose, TEXT("Requesting Stream Load: %s"), *Level.GetAssetName());
-					PS->AddRequestForStreamingLevel(this, LevelName, false);				
+					PS->AddRequestForStreamingLevel(this, LevelName, false, StreamingPriority);				
 				}
 			}
 		}
@@ -2,8 +2,16 @@
 #include "EngineUtils.h"
 #include "SpudState.h"
 #include "Engine/LevelStreaming.h"
+#include "GameFramework/PlayerController.h"
 #include "Kismet/GameplayStatics.h"
 #include "ImageUtils.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/Compression.h"
+#include "UObject/GarbageCollection.h"
 
 DEFINE_LOG_CATEGORY(LogSpudSubsystem)
 
@@ -23,6 +31,10 @@ void USpudSubsystem::Initialize(FSubsystemCollectionBase& Collection)
 	// Seamless travel is only supported on 4.26+ since event is only present there
 	OnSeamlessTravelHandle = FWorldDelegates::OnSeamlessTravelTransition.AddUObject(this, &USpudSubsystem::OnSeamlessTravelTransition);
 #endif
+
+	SetCompressLevelData(bCompressLevelData);
+	GSpudMapLevelFiles = bMapLevelFiles;
+	GSpudShareClassDefinitions = bShareClassDefinitions;
 	
 #if WITH_EDITORONLY_DATA
 	// The one problem we have is that in PIE mode, PostLoadMap doesn't get fired for the current map you're on
@@ -39,6 +51,11 @@ void USpudSubsystem::Initialize(FSubsystemCollectionBase& Collection)
 
 void USpudSubsystem::Deinitialize()
 {
+	// Don't let background saves/loads outlive us
+	WaitForPendingSave();
+	WaitForPendingLoad();
+	CancelAllPrefetches();
+	
 	FCoreUObjectDelegates::PostLoadMapWithWorld.Remove(OnPostLoadMapHandle);
 	FCoreUObjectDelegates::PreLoadMap.Remove(OnPreLoadMapHandle);
 #if ENGINE_MINOR_VERSION >= 26
@@ -74,8 +91,18 @@ bool USpudSubsystem::ServerCheck(bool LogWarning) const
 
 void USpudSubsystem::EndGame()
 {
+	// The state is about to be reset, which can't happen while it's being written or read
+	WaitForPendingSave();
+	WaitForPendingLoad();
+	CancelAllPrefetches();
+	// Snapshots belong to the game that's ending
+	Snapshots.Empty();
+	
 	if (ActiveState)
 		ActiveState->ResetState();
+	// Level stores / restores in progress were abandoned by the reset
+	LevelStoreTrackers.Empty();
+	LevelRestoreTrackers.Empty();
 	
 	// Allow GC to collect
 	ActiveState = nullptr;
@@ -128,10 +155,19 @@ void USpudSubsystem::OnPreLoadMap(const FString& MapName)
 	if (!ServerCheck(false))
 		return;
 
+	// A save being written in the background has already captured the state, so finish it rather than skip
+	// storing the map we're leaving because we're still saving
+	WaitForPendingSave();
+
 	PreTravelToNewMap.Broadcast(MapName);
 	// All streaming maps will be unloaded by travelling, so remove all
 	LevelRequests.Empty();
-	StopUnloadTimer();
+	// Prefetched levels belong to the old map, they would just sit in memory
+	if (CurrentState == ESpudSystemState::RunningIdle)
+		ReleaseAllPrefetches();
+	else
+		CancelAllPrefetches();
+	ResetStreamingQueues();
 	
 	FirstStreamRequestSinceMapLoad = true;
 
@@ -167,6 +203,9 @@ void USpudSubsystem::OnPostLoadMap(UWorld* World)
 {
 	if (!ServerCheck(false))
 		return;
+
+	// Same as OnPreLoadMap, otherwise a save still being written would stop the new map being restored
+	WaitForPendingSave();
 	
 	if (CurrentState == ESpudSystemState::RunningIdle ||
 		CurrentState == ESpudSystemState::LoadingGame)
@@ -222,6 +261,7 @@ void USpudSubsystem::SaveGame(const FString& SlotName, const FText& Title, bool
 	}
 
 	CurrentState = ESpudSystemState::SavingGame;
+	SaveGameTracker.Begin(ESpudOperation::SaveGame, SlotName);
 	PreSaveGame.Broadcast(SlotName);
 
 	if (bTakeScreenshot)
@@ -243,7 +283,7 @@ void USpudSubsystem::SaveGame(const FString& SlotName, const FText& Title, bool
 	}
 	else
 	{
-		FinishSaveGame(SlotName, Title, ExtraInfo, nullptr);
+		FinishSaveGame(SlotName, Title, ExtraInfo, TFuture<TArray<uint8>>());
 	}
 }
 
@@ -258,7 +298,7 @@ void USpudSubsystem::ScreenshotTimedOut()
 		"Widget Blueprints being open in the editor during PIE seems to break screenshots. Completing save game without a screenshot."))
 
 	ScreenshotTimeout = 0;
-	FinishSaveGame(SlotNameInProgress, TitleInProgress, ExtraInfoInProgress, nullptr);
+	FinishSaveGame(SlotNameInProgress, TitleInProgress, ExtraInfoInProgress, TFuture<TArray<uint8>>());
 	
 }
 
@@ -270,18 +310,36 @@ void USpudSubsystem::OnScreenshotCaptured(int32 Width, int32 Height, const TArra
 	ViewportClient->OnScreenshotCaptured().Remove(OnScreenshotHandle);
 	OnScreenshotHandle.Reset();
 
-	// Downscale the screenshot, pass to finish
-	TArray<FColor> RawDataCroppedResized;
-	FImageUtils::CropAndScaleImage(Width, Height, ScreenshotWidth, ScreenshotHeight, Colours, RawDataCroppedResized);
+	// Downscaling & PNG encoding a full resolution screenshot is slow, so do it on a worker while the world is stored;
+	// it's only waited for when the save file is written (which may be in the background too)
+	// Module loading has to happen on the game thread, so encode through the wrapper rather than
+	// FImageUtils::CompressImageArray, which loads it itself
+	IImageWrapperModule* ImageWrapperModule = &FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+	const int32 DestWidth = ScreenshotWidth;
+	const int32 DestHeight = ScreenshotHeight;
+	TFuture<TArray<uint8>> ScreenshotTask = Async(EAsyncExecution::ThreadPool,
+		[Width, Height, DestWidth, DestHeight, Colours, ImageWrapperModule]()
+		{
+			SPUD_SCOPED_STAT(EncodeScreenshot);
+			TArray<FColor> RawDataCroppedResized;
+			FImageUtils::CropAndScaleImage(Width, Height, DestWidth, DestHeight, Colours, RawDataCroppedResized);
+
+			TArray<uint8> PngData;
+			// FColor is BGRA, so no need to swap anything
+			TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule->CreateImageWrapper(EImageFormat::PNG);
+			if (ImageWrapper.IsValid() && ImageWrapper->SetRaw(RawDataCroppedResized.GetData(),
+				RawDataCroppedResized.Num() * sizeof(FColor), DestWidth, DestHeight, ERGBFormat::BGRA, 8))
+			{
+				const auto& Compressed = ImageWrapper->GetCompressed();
+				PngData.Append(Compressed.GetData(), static_cast<int32>(Compressed.Num()));
+			}
+			return PngData;
+		});
 
-	// Convert down to PNG
-	TArray<uint8> PngData;
-	FImageUtils::CompressImageArray(ScreenshotWidth, ScreenshotHeight, RawDataCroppedResized, PngData);
-	
-	FinishSaveGame(SlotNameInProgress, TitleInProgress, ExtraInfoInProgress, &PngData);
+	FinishSaveGame(SlotNameInProgress, TitleInProgress, ExtraInfoInProgress, MoveTemp(ScreenshotTask));
 	
 }
-void USpudSubsystem::FinishSaveGame(const FString& SlotName, const FText& Title, const USpudCustomSaveInfo* ExtraInfo, TArray<uint8>* ScreenshotData)
+void USpudSubsystem::StoreGlobalsAndWorld()
 {
 	auto State = GetActiveState();
 	auto World = GetWorld();
@@ -305,13 +363,63 @@ void USpudSubsystem::FinishSaveGame(const FString& SlotName, const FText& Title,
 
 	// Store any data that is currently active in the game world in the state object
 	StoreWorld(World, false, true);
+}
+
+void USpudSubsystem::FinishSaveGame(const FString& SlotName, const FText& Title, const USpudCustomSaveInfo* ExtraInfo, TFuture<TArray<uint8>> ScreenshotTask)
+{
+	auto State = GetActiveState();
+	StoreGlobalsAndWorld();
+
+	// If we're still extracting level data from a previous load, that has to finish first; the save might be going
+	// to the same file, and the level data being saved may not be in the cache yet
+	WaitForPendingLoad();
+	// Likewise a snapshot could still be being written to the same slot
+	WaitForPendingSnapshotSave();
 
 	State->SetTitle(Title);
 	State->SetTimestamp(FDateTime::Now());
 	State->SetCustomSaveInfo(ExtraInfo);
-	if (ScreenshotData)
-		State->SetScreenshot(*ScreenshotData);
 	
+	if (bSaveGameAsync)
+	{
+		// Everything the save needs is now captured in the state, the rest is just serialisation & I/O, which for
+		// a game with lots of visited levels can take a while (piping all the paged out level data). So do that in
+		// the background; we stay in the SavingGame state until it's done
+		TWeakObjectPtr<USpudSubsystem> WeakThis(this);
+		const uint32 Serial = ++PendingSaveSerial;
+		PendingSaveSlotName = SlotName;
+		PendingSaveTask = Async(EAsyncExecution::ThreadPool,
+			[WeakThis, State, SlotName, Serial, Screenshot = MoveTemp(ScreenshotTask)]() mutable
+		{
+			// The screenshot is usually done by now, it's had all of the world store to finish in
+			if (Screenshot.IsValid())
+			{
+				TArray<uint8> PngData = Screenshot.Get();
+				State->SetScreenshot(PngData);
+			}
+			const bool bSaveOK = WriteSaveGameFile(State, SlotName);
+			AsyncTask(ENamedThreads::GameThread, [WeakThis, SlotName, bSaveOK, Serial]()
+			{
+				if (WeakThis.IsValid())
+					WeakThis->AsyncSaveComplete(SlotName, bSaveOK, Serial);
+			});
+			return bSaveOK;
+		});
+	}
+	else
+	{
+		if (ScreenshotTask.IsValid())
+		{
+			TArray<uint8> PngData = ScreenshotTask.Get();
+			State->SetScreenshot(PngData);
+		}
+		SaveComplete(SlotName, WriteSaveGameFile(State, SlotName));
+	}
+
+}
+
+bool USpudSubsystem::WriteSaveGameFile(USpudState* State, const FString& SlotName)
+{
 	// UGameplayStatics::SaveGameToSlot prefixes our save with a lot of crap that we don't need
 	// And also wraps it with FObjectAndNameAsStringProxyArchive, which again we don't need
 	// Plus it writes it all to memory first, which we don't need another copy of. Write direct to file
@@ -324,6 +432,7 @@ void USpudSubsystem::FinishSaveGame(const FString& SlotName, const FText& Title,
 	if(Archive)
 	{
 		State->SaveToArchive(*Archive);
+		SPUD_COUNT_BYTES(BytesWritten, Archive->Tell());
 		// Always explicitly close to catch errors from flush/close
 		Archive->Close();
 
@@ -344,35 +453,110 @@ void USpudSubsystem::FinishSaveGame(const FString& SlotName, const FText& Title,
 		SaveOK = false;
 	}
 
-	SaveComplete(SlotName, SaveOK);
-
+	return SaveOK;
 }
 
 void USpudSubsystem::SaveComplete(const FString& SlotName, bool bSuccess)
 {
+	if (bSuccess)
+		UpdateSaveSlotIndexFromFile(SlotName);
+	
 	SlotNameInProgress = "";
 	TitleInProgress = FText();
 	ExtraInfoInProgress = nullptr;
 	CurrentState = ESpudSystemState::RunningIdle;
+	RecordOperationMetrics(SaveGameTracker, bSuccess);
 	PostSaveGame.Broadcast(SlotName, bSuccess);
 }
 
+void USpudSubsystem::AsyncSaveComplete(const FString& SlotName, bool bSuccess, uint32 Serial)
+{
+	// WaitForPendingSave may have completed this already
+	if (!PendingSaveTask.IsValid() || Serial != PendingSaveSerial)
+		return;
+	PendingSaveTask = TFuture<bool>();
+	
+	// EndGame may have happened while we were writing (it waits for us), in which case we mustn't flip the
+	// system back to idle, just report the result
+	if (CurrentState == ESpudSystemState::SavingGame)
+		SaveComplete(SlotName, bSuccess);
+	else
+	{
+		if (bSuccess)
+			UpdateSaveSlotIndexFromFile(SlotName);
+		RecordOperationMetrics(SaveGameTracker, bSuccess);
+		PostSaveGame.Broadcast(SlotName, bSuccess);
+	}
+}
+
+void USpudSubsystem::WaitForPendingLoad()
+{
+	if (PendingLoadTask.IsValid())
+	{
+		PendingLoadTask.Wait();
+		PendingLoadTask = TFuture<void>();
+	}
+}
+
+void USpudSubsystem::WaitForPendingSave()
+{
+	if (PendingSaveTask.IsValid())
+	{
+		// Complete it now rather than when the game thread gets its completion, which is then ignored
+		const bool bSuccess = PendingSaveTask.Get();
+		AsyncSaveComplete(PendingSaveSlotName, bSuccess, PendingSaveSerial);
+	}
+	WaitForPendingSnapshotSave();
+}
+
+void USpudSubsystem::WaitForPendingSnapshotSave()
+{
+	if (PendingSnapshotSaveTask.IsValid())
+	{
+		PendingSnapshotSaveTask.Wait();
+		PendingSnapshotSaveTask = TFuture<void>();
+	}
+}
+
 
 
 void USpudSubsystem::StoreWorld(UWorld* World, bool bReleaseLevels, bool bBlocking)
 {
-	for (auto && Level : World->GetLevels())
+	const auto& Levels = World->GetLevels();
+	if (bParallelStoreWorld && Levels.Num() > 1)
 	{
-		StoreLevel(Level, bReleaseLevels, bBlocking);
-	}	
+		// Levels are stored together, so they're measured as one operation
+		FSpudOperationTracker Tracker;
+		Tracker.Begin(ESpudOperation::StoreLevel, World->GetName());
+		for (auto && Level : Levels)
+		{
+			PreLevelStore.Broadcast(USpudState::GetLevelName(Level));
+		}
+		GetActiveState()->StoreLevels(Levels, bReleaseLevels, bBlocking);
+		for (auto && Level : Levels)
+		{
+			PostLevelStore.Broadcast(USpudState::GetLevelName(Level), true);
+		}
+		RecordOperationMetrics(Tracker, true);
+	}
+	else
+	{
+		for (auto && Level : Levels)
+		{
+			StoreLevel(Level, bReleaseLevels, bBlocking);
+		}
+	}
 }
 
 void USpudSubsystem::StoreLevel(ULevel* Level, bool bRelease, bool bBlocking)
 {
 	const FString LevelName = USpudState::GetLevelName(Level);
+	FSpudOperationTracker Tracker;
+	Tracker.Begin(ESpudOperation::StoreLevel, LevelName);
 	PreLevelStore.Broadcast(LevelName);
 	GetActiveState()->StoreLevel(Level, bRelease, bBlocking);
 	PostLevelStore.Broadcast(LevelName, true);
+	RecordOperationMetrics(Tracker, true);
 }
 
 void USpudSubsystem::LoadGame(const FString& SlotName)
@@ -392,23 +576,77 @@ void USpudSubsystem::LoadGame(const FString& SlotName)
 	}
 
 	CurrentState = ESpudSystemState::LoadingGame;
+	LoadGameTracker.Begin(ESpudOperation::LoadGame, SlotName);
 	PreLoadGame.Broadcast(SlotName);
 
 	UE_LOG(LogSpudSubsystem, Verbose, TEXT("Loading Game from slot %s"), *SlotName);		
 
+	// A previous load may still be extracting level data, which must finish before we reset
+	WaitForPendingLoad();
+	// And we might be about to read a slot that a snapshot is still being written to
+	WaitForPendingSnapshotSave();
+	CancelAllPrefetches();
+
 	auto State = GetActiveState();
 
 	State->ResetState();
+	LevelStoreTrackers.Empty();
+	LevelRestoreTrackers.Empty();
 
-	// TODO: async load
+	if (bLoadGameAsync)
+	{
+		// Read the file & split out the level data in the background. We only need to wait for the global data and
+		// the data for the map we're travelling to, everything else can carry on being extracted while the map loads 
+		TWeakObjectPtr<USpudSubsystem> WeakThis(this);
+		const FString Filename = GetSaveGameFilePath(SlotName);
+		PendingLoadTask = Async(EAsyncExecution::ThreadPool, [WeakThis, State, SlotName, Filename]()
+		{
+			bool bInitialDataReady = false;
+			IFileManager& FileMgr = IFileManager::Get();
+			auto Archive = TUniquePtr<FArchive>(FileMgr.CreateFileReader(*Filename));
+			if (Archive)
+			{
+				State->LoadFromArchiveStaged(*Archive, [WeakThis, SlotName, &bInitialDataReady]()
+				{
+					bInitialDataReady = true;
+					AsyncTask(ENamedThreads::GameThread, [WeakThis, SlotName]()
+					{
+						if (WeakThis.IsValid())
+							WeakThis->TravelToLoadedGame(SlotName);
+					});
+				}, Filename);
+				Archive->Close();
+
+				if (Archive->IsError() || Archive->IsCriticalError())
+				{
+					UE_LOG(LogSpudSubsystem, Error, TEXT("Error while loading game from %s"), *SlotName);
+				}
+			}
+			else
+			{
+				UE_LOG(LogSpudSubsystem, Error, TEXT("Error while opening save game for slot %s"), *SlotName);		
+			}
+
+			if (!bInitialDataReady)
+			{
+				AsyncTask(ENamedThreads::GameThread, [WeakThis, SlotName]()
+				{
+					if (WeakThis.IsValid() && WeakThis->IsLoadingGame())
+						WeakThis->LoadComplete(SlotName, false);
+				});
+			}
+		});
+		return;
+	}
 
 	IFileManager& FileMgr = IFileManager::Get();
-	auto Archive = TUniquePtr<FArchive>(FileMgr.CreateFileReader(*GetSaveGameFilePath(SlotName)));
+	const FString Filename = GetSaveGameFilePath(SlotName);
+	auto Archive = TUniquePtr<FArchive>(FileMgr.CreateFileReader(*Filename));
 
 	if(Archive)
 	{
 		// Load only global data and page in level data as needed
-		State->LoadFromArchive(*Archive, false);
+		State->LoadFromArchive(*Archive, false, Filename);
 		Archive->Close();
 
 		if (Archive->IsError() || Archive->IsCriticalError())
@@ -417,6 +655,13 @@ void USpudSubsystem::LoadGame(const FString& SlotName)
 			LoadComplete(SlotName, false);
 			return;
 		}
+
+		// If the save had a level index, level data is still in the save file & read from there when needed.
+		// Copy it all into the level cache in the background; saving / deleting waits for this like an async load
+		PendingLoadTask = Async(EAsyncExecution::ThreadPool, [State]()
+		{
+			State->ExtractPendingLevelData();
+		});
 	}
 	else
 	{
@@ -425,6 +670,17 @@ void USpudSubsystem::LoadGame(const FString& SlotName)
 		return;
 	}
 
+	TravelToLoadedGame(SlotName);
+}
+
+void USpudSubsystem::TravelToLoadedGame(const FString& SlotName)
+{
+	// Might have been cancelled while loading in the background
+	if (CurrentState != ESpudSystemState::LoadingGame)
+		return;
+
+	auto State = GetActiveState();
+	
 	// Just do the reverse of what we did
 	// Global objects first before map, these should be only objects which survive map load
 	for (auto Ptr : GlobalObjects)
@@ -449,6 +705,7 @@ void USpudSubsystem::LoadComplete(const FString& SlotName, bool bSuccess)
 {
 	CurrentState = ESpudSystemState::RunningIdle;
 	SlotNameInProgress = "";
+	RecordOperationMetrics(LoadGameTracker, bSuccess);
 	PostLoadGame.Broadcast(SlotName, bSuccess);
 }
 
@@ -456,9 +713,196 @@ bool USpudSubsystem::DeleteSave(const FString& SlotName)
 {
 	if (!ServerCheck(true))
 		return false;
+
+	// Can't delete a file we might still be reading from, or writing a snapshot to
+	WaitForPendingLoad();
+	WaitForPendingSnapshotSave();
 	
 	IFileManager& FileMgr = IFileManager::Get();
-	return FileMgr.Delete(*GetSaveGameFilePath(SlotName), false, true);
+	const bool bDeleted = FileMgr.Delete(*GetSaveGameFilePath(SlotName), false, true);
+	if (bDeleted)
+	{
+		LoadSaveSlotIndexIfNeeded();
+		if (SaveSlotIndex.Contents.Remove(SlotName) > 0)
+			WriteSaveSlotIndex();
+	}
+	return bDeleted;
+}
+
+bool USpudSubsystem::CaptureSnapshot(const FString& Name)
+{
+	if (!ServerCheck(true))
+		return false;
+
+	if (CurrentState != ESpudSystemState::RunningIdle)
+	{
+		UE_LOG(LogSpudSubsystem, Error, TEXT("Cannot capture snapshot %s while saving or loading"), *Name);
+		return false;
+	}
+
+	StoreGlobalsAndWorld();
+
+	auto State = GetActiveState();
+	State->SetTimestamp(FDateTime::Now());
+	auto Snapshot = State->CaptureSnapshot(Name, Snapshots.Num() > 0 ? Snapshots.Last().Get() : nullptr);
+
+	Snapshots.RemoveAll([&Name](const FSpudStateSnapshot::Ptr& S) { return S->Name == Name; });
+	Snapshots.Add(Snapshot);
+	while (Snapshots.Num() > FMath::Max(MaxSnapshots, 1))
+		Snapshots.RemoveAt(0);
+
+	UE_LOG(LogSpudSubsystem, Verbose, TEXT("Captured snapshot %s, %d levels, %lld bytes"), *Name,
+		Snapshot->Levels.Num(), Snapshot->GetDataSize());
+	return true;
+}
+
+bool USpudSubsystem::RestoreSnapshot(const FString& Name)
+{
+	if (!ServerCheck(true))
+		return false;
+
+	if (CurrentState != ESpudSystemState::RunningIdle)
+	{
+		UE_LOG(LogSpudSubsystem, Error, TEXT("Cannot restore snapshot %s while saving or loading"), *Name);
+		return false;
+	}
+
+	const auto Snapshot = FindSnapshot(Name);
+	if (!Snapshot.IsValid())
+	{
+		UE_LOG(LogSpudSubsystem, Error, TEXT("Cannot restore snapshot %s, it doesn't exist"), *Name);
+		return false;
+	}
+
+	// Same as LoadGame, except the state comes straight from memory
+	CurrentState = ESpudSystemState::LoadingGame;
+	LoadGameTracker.Begin(ESpudOperation::LoadGame, Name);
+	PreLoadGame.Broadcast(Name);
+
+	UE_LOG(LogSpudSubsystem, Verbose, TEXT("Restoring snapshot %s"), *Name);
+
+	WaitForPendingLoad();
+	CancelAllPrefetches();
+
+	GetActiveState()->RestoreSnapshot(*Snapshot);
+	LevelStoreTrackers.Empty();
+	LevelRestoreTrackers.Empty();
+
+	TravelToLoadedGame(Name);
+	return true;
+}
+
+bool USpudSubsystem::RewindSnapshot()
+{
+	if (Snapshots.Num() == 0)
+		return false;
+
+	const FString Name = Snapshots.Last()->Name;
+	if (!RestoreSnapshot(Name))
+		return false;
+	DeleteSnapshot(Name);
+	return true;
+}
+
+bool USpudSubsystem::HasSnapshot(const FString& Name) const
+{
+	return FindSnapshot(Name).IsValid();
+}
+
+TArray<FString> USpudSubsystem::GetSnapshotNames() const
+{
+	TArray<FString> Ret;
+	for (auto& Snapshot : Snapshots)
+	{
+		Ret.Add(Snapshot->Name);
+	}
+	return Ret;
+}
+
+void USpudSubsystem::DeleteSnapshot(const FString& Name)
+{
+	Snapshots.RemoveAll([&Name](const FSpudStateSnapshot::Ptr& S) { return S->Name == Name; });
+}
+
+void USpudSubsystem::DeleteAllSnapshots()
+{
+	Snapshots.Empty();
+}
+
+FSpudStateSnapshot::Ptr USpudSubsystem::FindSnapshot(const FString& Name) const
+{
+	const auto Found = Snapshots.FindByPredicate([&Name](const FSpudStateSnapshot::Ptr& S) { return S->Name == Name; });
+	return Found ? *Found : FSpudStateSnapshot::Ptr();
+}
+
+bool USpudSubsystem::SaveSnapshotToSlot(const FString& Name, const FString& SlotName, const FText& Title)
+{
+	const auto Snapshot = FindSnapshot(Name);
+	if (!Snapshot.IsValid())
+	{
+		UE_LOG(LogSpudSubsystem, Error, TEXT("Cannot save snapshot %s, it doesn't exist"), *Name);
+		return false;
+	}
+	if (SlotName.IsEmpty())
+	{
+		UE_LOG(LogSpudSubsystem, Error, TEXT("Cannot save a snapshot with a blank slot name"));
+		return false;
+	}
+
+	// The slot might be the file we're loading from, or being written already
+	WaitForPendingLoad();
+	WaitForPendingSave();
+
+	// Its own tracker, since the game can be saved normally while this is being written
+	FSpudOperationTracker Tracker;
+	Tracker.Begin(ESpudOperation::SaveGame, SlotName);
+	PreSaveGame.Broadcast(SlotName);
+
+	// The snapshot never changes, so it's all the background thread needs; nothing touches the active state
+	// Written to a temp file first so the slot is never left half written, and nothing reads it until it's replaced
+	TWeakObjectPtr<USpudSubsystem> WeakThis(this);
+	const FString Filename = GetSaveGameFilePath(SlotName);
+	PendingSnapshotSaveTask = Async(EAsyncExecution::ThreadPool, [WeakThis, Snapshot, SlotName, Filename, Title, Tracker]()
+	{
+		IFileManager& FileMgr = IFileManager::Get();
+		const FString TempFilename = Filename + ".tmp";
+		bool bSaveOK = false;
+		auto Archive = TUniquePtr<FArchive>(FileMgr.CreateFileWriter(*TempFilename));
+		if (Archive)
+		{
+			USpudState::WriteSnapshotToArchive(*Snapshot, *Archive, Title);
+			SPUD_COUNT_BYTES(BytesWritten, Archive->Tell());
+			bSaveOK = Archive->Close() && !Archive->IsError() && !Archive->IsCriticalError();
+			Archive.Reset();
+		}
+		if (bSaveOK)
+			bSaveOK = FileMgr.Move(*Filename, *TempFilename, true, true);
+		if (!bSaveOK)
+		{
+			UE_LOG(LogSpudSubsystem, Error, TEXT("Error while saving snapshot %s to slot %s"), *Snapshot->Name, *SlotName);
+			FileMgr.Delete(*TempFilename, false, true, true);
+		}
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, SlotName, bSaveOK, Tracker]()
+		{
+			if (WeakThis.IsValid())
+				WeakThis->SnapshotSaveComplete(SlotName, bSaveOK, Tracker);
+		});
+	});
+	return true;
+}
+
+void USpudSubsystem::SnapshotSaveComplete(const FString& SlotName, bool bSuccess, FSpudOperationTracker Tracker)
+{
+	// Could already have been waited for & replaced by another one
+	if (PendingSnapshotSaveTask.IsValid() && PendingSnapshotSaveTask.IsReady())
+		PendingSnapshotSaveTask = TFuture<void>();
+	if (bSuccess)
+	{
+		UE_LOG(LogSpudSubsystem, Log, TEXT("Save snapshot to slot %s: Success"), *SlotName);
+		UpdateSaveSlotIndexFromFile(SlotName);
+	}
+	RecordOperationMetrics(Tracker, bSuccess);
+	PostSaveGame.Broadcast(SlotName, bSuccess);
 }
 
 void USpudSubsystem::AddPersistentGlobalObject(UObject* Obj)
@@ -488,22 +932,59 @@ void USpudSubsystem::ClearLevelState(const FString& LevelName)
 	
 }
 
-void USpudSubsystem::AddRequestForStreamingLevel(UObject* Requester, FName LevelName, bool BlockingLoad)
+void USpudSubsystem::AddRequestForStreamingLevel(UObject* Requester, FName LevelName, bool BlockingLoad, float Priority)
 {
 	if (!ServerCheck(false))
 		return;
 
 	auto && Request = LevelRequests.FindOrAdd(LevelName);
 	Request.Requesters.AddUnique(Requester);
-	if (Request.bPendingUnload)
+	if (Request.bPendingStore)
+	{
+		// Still loaded, we'd just started storing it ready to unload. Actors stored so far have their new data, the
+		// rest keep their previous data, and it'll all be brought up to date when it's next stored
+		Request.bPendingStore = false;
+		Request.LastRequestExpiredTime = 0;
+		GetActiveState()->CancelPendingStore(LevelName.ToString());
+	}
+	else if (Request.bPendingUnload)
 	{
-		Request.bPendingUnload = false; // no load required, just flip the unload flag
+		// no load required, just flip the unload flag; its entry in StreamUnloadQueue is now stale and will be skipped
+		Request.bPendingUnload = false;
 		Request.LastRequestExpiredTime = 0;
 	}
 	else if (Request.Requesters.Num() == 1)
 	{
-		// Load on the first request only		
-		LoadStreamLevel(LevelName, BlockingLoad);		
+		// Load on the first request only
+		if (BlockingLoad || MaxConcurrentStreamingLoads <= 0)
+		{
+			LoadStreamLevel(LevelName, BlockingLoad);
+		}
+		else
+		{
+			QueuedStreamLoads.Add(FQueuedStreamLoad { LevelName, Priority, FPlatformTime::Seconds() });
+			DispatchQueuedStreamLoads();
+		}
+	}
+	else
+	{
+		// Already requested, but if it's still queued this request might make it more urgent
+		const int32 QueuedIndex = QueuedStreamLoads.IndexOfByPredicate([LevelName](const FQueuedStreamLoad& Q)
+		{
+			return Q.LevelName == LevelName;
+		});
+		if (QueuedIndex != INDEX_NONE)
+		{
+			if (BlockingLoad)
+			{
+				QueuedStreamLoads.RemoveAt(QueuedIndex);
+				LoadStreamLevel(LevelName, true);
+			}
+			else
+			{
+				QueuedStreamLoads[QueuedIndex].Priority = FMath::Max(QueuedStreamLoads[QueuedIndex].Priority, Priority);
+			}
+		}
 	}
 }
 
@@ -517,64 +998,333 @@ void USpudSubsystem::WithdrawRequestForStreamingLevel(UObject* Requester, FName
 		Request->Requesters.Remove(Requester);
 		if (Request->Requesters.Num() == 0)
 		{
+			// If it never started loading, it just doesn't need to any more
+			const int32 NumDequeued = QueuedStreamLoads.RemoveAll([LevelName](const FQueuedStreamLoad& Q)
+			{
+				return Q.LevelName == LevelName;
+			});
+			if (NumDequeued > 0)
+				return;
+
 			// This level can be unloaded after time delay
+			const float Now = UGameplayStatics::GetTimeSeconds(GetWorld());
 			Request->bPendingUnload = true;
-			Request->LastRequestExpiredTime = UGameplayStatics::GetTimeSeconds(GetWorld());
-			StartUnloadTimer();
+			Request->LastRequestExpiredTime = Now;
+			QueueStreamLevelUnload(LevelName, Now + StreamLevelUnloadDelay);
 		}
 	}
 }
 
-void USpudSubsystem::StartUnloadTimer()
+void USpudSubsystem::AddPrefetchRequestForStreamingLevel(UObject* Requester, FName LevelName)
 {
-	if (!StreamLevelUnloadTimerHandle.IsValid())
+	if (!ServerCheck(false))
+		return;
+
+	auto && Prefetch = LevelPrefetches.FindOrAdd(LevelName);
+	Prefetch.Requesters.AddUnique(Requester);
+	Prefetch.LastRequestExpiredTime = 0;
+
+	// Already prefetching / prefetched
+	if (Prefetch.Task.IsValid())
+		return;
+
+	// Only worth doing if there's data in the level cache which isn't loaded yet
+	auto State = GetActiveState();
+	const FString LevelNameStr = LevelName.ToString();
+	const int64 Size = State->GetUnloadedLevelDataSize(LevelNameStr);
+	if (Size <= 0)
+		return;
+
+	if (!MakeRoomForPrefetch(Size))
 	{
-		// Set up a timer which repeatedly checks for actual unload
-		// This doesn't need to be every tick, just every 0.5s
-		GetWorld()->GetTimerManager().SetTimer(StreamLevelUnloadTimerHandle, this, &USpudSubsystem::CheckStreamUnload, 0.5, true);
-	}	
+		UE_LOG(LogSpudSubsystem, Verbose, TEXT("Not prefetching level data for %s, prefetch memory budget is full"), *LevelNameStr);
+		return;
+	}
+
+	UE_LOG(LogSpudSubsystem, Verbose, TEXT("Prefetching level data for %s"), *LevelNameStr);
+	Prefetch.Size = Size;
+	Prefetch.Task = Async(EAsyncExecution::ThreadPool, [State, LevelNameStr]()
+	{
+		State->PreLoadLevelData(LevelNameStr);
+	});
 }
 
+void USpudSubsystem::WithdrawPrefetchRequestForStreamingLevel(UObject* Requester, FName LevelName)
+{
+	if (!ServerCheck(false))
+		return;
+
+	if (auto Prefetch = LevelPrefetches.Find(LevelName))
+	{
+		Prefetch->Requesters.Remove(Requester);
+		if (Prefetch->Requesters.Num() == 0)
+		{
+			// Keep it for a while in case it's wanted again (see CheckPrefetchExpiry)
+			Prefetch->LastRequestExpiredTime = FPlatformTime::Seconds();
+		}
+	}
+}
 
-void USpudSubsystem::StopUnloadTimer()
+bool USpudSubsystem::MakeRoomForPrefetch(int64 Size)
 {
-	if (StreamLevelUnloadTimerHandle.IsValid())
+	if (PrefetchMemoryBudgetKB <= 0)
+		return true;
+
+	const int64 Budget = int64(PrefetchMemoryBudgetKB) * 1024;
+	int64 Used = 0;
+	for (auto && Pair : LevelPrefetches)
 	{
-		GetWorld()->GetTimerManager().ClearTimer(StreamLevelUnloadTimerHandle);
-	}	
+		if (Pair.Value.Task.IsValid())
+			Used += Pair.Value.Size;
+	}
+
+	// Evict the prefetches nobody wants any more, oldest first, until there's room
+	while (Used + Size > Budget)
+	{
+		FName Oldest = NAME_None;
+		double OldestTime = 0;
+		for (auto && Pair : LevelPrefetches)
+		{
+			const FLevelPrefetch& Prefetch = Pair.Value;
+			if (Prefetch.Task.IsValid() && Prefetch.Requesters.Num() == 0 &&
+				(Oldest.IsNone() || Prefetch.LastRequestExpiredTime < OldestTime))
+			{
+				Oldest = Pair.Key;
+				OldestTime = Prefetch.LastRequestExpiredTime;
+			}
+		}
+		if (Oldest.IsNone())
+			return false;
+
+		FLevelPrefetch& Evicted = LevelPrefetches[Oldest];
+		Used -= Evicted.Size;
+		ReleasePrefetch(Oldest, Evicted);
+		LevelPrefetches.Remove(Oldest);
+	}
+	return true;
 }
 
-void USpudSubsystem::CheckStreamUnload()
+void USpudSubsystem::CheckPrefetchExpiry()
 {
-	const float UnloadBeforeTime = UGameplayStatics::GetTimeSeconds(GetWorld()) - StreamLevelUnloadDelay;
-	bool bAnyStillWaiting = false;
-	for (auto && Pair : LevelRequests)
+	const double ReleaseBeforeTime = FPlatformTime::Seconds() - PrefetchExpiryDelay;
+	for (auto It = LevelPrefetches.CreateIterator(); It; ++It)
 	{
-		const FName& LevelName = Pair.Key;
-		FStreamLevelRequests& Request = Pair.Value;
-		if (Request.bPendingUnload)
+		FLevelPrefetch& Prefetch = It.Value();
+		// Don't hold up the game thread waiting for a prefetch to finish, just check again later
+		if (Prefetch.Task.IsValid() && !Prefetch.Task.IsReady())
+			continue;
+
+		if (Prefetch.Requesters.Num() == 0 &&
+			Prefetch.LastRequestExpiredTime <= ReleaseBeforeTime)
 		{
-			if (Request.Requesters.Num() == 0 &&
-				Request.LastRequestExpiredTime <= UnloadBeforeTime)
+			ReleasePrefetch(It.Key(), Prefetch);
+			It.RemoveCurrent();
+		}
+	}
+}
+
+void USpudSubsystem::ReleasePrefetch(FName LevelName, FLevelPrefetch& Prefetch)
+{
+	if (!Prefetch.Task.IsValid())
+		return;
+
+	Prefetch.Task.Wait();
+	Prefetch.Task = TFuture<void>();
+
+	// If the level got loaded some other way since (e.g. not through a streaming request) the data is in use now
+	auto StreamLevel = IsValid(GetWorld()) ? UGameplayStatics::GetStreamingLevel(GetWorld(), LevelName) : nullptr;
+	if (StreamLevel && StreamLevel->GetLoadedLevel())
+		return;
+
+	UE_LOG(LogSpudSubsystem, Verbose, TEXT("Releasing prefetched level data for %s"), *LevelName.ToString());
+	GetActiveState()->ReleaseUnmodifiedLevelData(LevelName.ToString());
+}
+
+void USpudSubsystem::ReleaseAllPrefetches()
+{
+	for (auto && Pair : LevelPrefetches)
+	{
+		ReleasePrefetch(Pair.Key, Pair.Value);
+	}
+	LevelPrefetches.Empty();
+}
+
+void USpudSubsystem::CancelAllPrefetches()
+{
+	for (auto && Pair : LevelPrefetches)
+	{
+		if (Pair.Value.Task.IsValid())
+			Pair.Value.Task.Wait();
+	}
+	LevelPrefetches.Empty();
+}
+
+/// Squared distance from the closest player viewpoint to the closest requester actor, or MAX_flt if either is unknown
+static float GetStreamRequestDistanceSq(const TArray<TWeakObjectPtr<>>& Requesters, const TArray<FVector>& ViewPoints)
+{
+	float Ret = MAX_flt;
+	for (auto && Requester : Requesters)
+	{
+		const AActor* Actor = Cast<AActor>(Requester.Get());
+		if (!Actor)
+			continue;
+
+		// Bounds rather than location, volumes are usually big & the player is often already inside them
+		const FBox Bounds = Actor->GetComponentsBoundingBox(true);
+		for (auto && ViewPoint : ViewPoints)
+		{
+			const float DistSq = Bounds.IsValid ? Bounds.ComputeSquaredDistanceToPoint(ViewPoint)
+			                                    : FVector::DistSquared(Actor->GetActorLocation(), ViewPoint);
+			Ret = FMath::Min(Ret, DistSq);
+		}
+	}
+	return Ret;
+}
+
+void USpudSubsystem::DispatchQueuedStreamLoads()
+{
+	if (QueuedStreamLoads.Num() == 0 ||
+		(MaxConcurrentStreamingLoads > 0 && StreamLevelsLoading.Num() >= MaxConcurrentStreamingLoads))
+		return;
+
+	// Limit may have been removed since these were queued
+	const int32 NumSlots = MaxConcurrentStreamingLoads > 0 ?
+		MaxConcurrentStreamingLoads - StreamLevelsLoading.Num() : QueuedStreamLoads.Num();
+
+	// Distances only need working out if there's a choice to make
+	TArray<float> DistancesSq;
+	if (NumSlots < QueuedStreamLoads.Num())
+	{
+		TArray<FVector> ViewPoints;
+		for (auto It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+		{
+			if (const APlayerController* PC = It->Get())
 			{
-				Request.bPendingUnload = false;
-				UnloadStreamLevel(LevelName);
+				FVector Location;
+				FRotator Rotation;
+				PC->GetPlayerViewPoint(Location, Rotation);
+				ViewPoints.Add(Location);
 			}
-			else
-				bAnyStillWaiting = true;
+		}
+		DistancesSq.Reserve(QueuedStreamLoads.Num());
+		for (auto && Queued : QueuedStreamLoads)
+		{
+			const FStreamLevelRequests* Request = LevelRequests.Find(Queued.LevelName);
+			DistancesSq.Add(Request ? GetStreamRequestDistanceSq(Request->Requesters, ViewPoints) : MAX_flt);
 		}
 	}
 
-	// Only run the timer while we have something to do
-	if (!bAnyStillWaiting)
-		StopUnloadTimer();
+	TArray<FName> ToLoad;
+	for (int32 Slot = 0; Slot < NumSlots && QueuedStreamLoads.Num() > 0; ++Slot)
+	{
+		// Highest priority first, then closest, then oldest
+		int32 Best = 0;
+		for (int32 i = 1; i < QueuedStreamLoads.Num() && DistancesSq.Num() > 0; ++i)
+		{
+			const FQueuedStreamLoad& Q = QueuedStreamLoads[i];
+			const FQueuedStreamLoad& B = QueuedStreamLoads[Best];
+			if (Q.Priority != B.Priority)
+			{
+				if (Q.Priority > B.Priority)
+					Best = i;
+			}
+			else if (DistancesSq[i] != DistancesSq[Best])
+			{
+				if (DistancesSq[i] < DistancesSq[Best])
+					Best = i;
+			}
+			else if (Q.QueuedTime < B.QueuedTime)
+			{
+				Best = i;
+			}
+		}
+		ToLoad.Add(QueuedStreamLoads[Best].LevelName);
+		QueuedStreamLoads.RemoveAt(Best);
+		if (DistancesSq.Num() > 0)
+			DistancesSq.RemoveAt(Best);
+	}
+
+	for (auto && LevelName : ToLoad)
+	{
+		UE_LOG(LogSpudSubsystem, Verbose, TEXT("Starting queued load of streaming level %s"), *LevelName.ToString());
+		LoadStreamLevel(LevelName, false);
+	}
+}
+
+void USpudSubsystem::FinishStreamLevelLoading(FName LevelName)
+{
+	// Queued loads are started from Tick, not in the middle of someone else's callbacks
+	StreamLevelsLoading.Remove(LevelName);
 }
 
+void USpudSubsystem::QueueStreamLevelUnload(FName LevelName, float UnloadTime)
+{
+	const auto Request = LevelRequests.Find(LevelName);
+	if (!Request)
+		return;
+
+	StreamUnloadQueue.HeapPush(FStreamUnloadExpiry { LevelName, UnloadTime, Request->LastRequestExpiredTime });
+}
 
+void USpudSubsystem::ProcessStreamUnloadQueue()
+{
+	const float Now = UGameplayStatics::GetTimeSeconds(GetWorld());
+	int32 NumStarted = 0;
+	while (StreamUnloadQueue.Num() > 0 && StreamUnloadQueue.HeapTop().UnloadTime <= Now)
+	{
+		if (MaxStreamingUnloadsPerFrame > 0 && NumStarted >= MaxStreamingUnloadsPerFrame)
+			break;
+
+		FStreamUnloadExpiry Expiry;
+		StreamUnloadQueue.HeapPop(Expiry, false);
+
+		// Skip if it's been requested again since this was queued (it might have been withdrawn again too, in which
+		// case there's a later entry for it)
+		FStreamLevelRequests* Request = LevelRequests.Find(Expiry.LevelName);
+		if (!Request ||
+			!Request->bPendingUnload ||
+			Request->Requesters.Num() > 0 ||
+			Request->LastRequestExpiredTime != Expiry.RequestExpiredTime)
+			continue;
+
+		Request->bPendingUnload = false;
+		if (LevelStoreTimeBudgetMs > 0 && CurrentState != ESpudSystemState::LoadingGame)
+		{
+			Request->bPendingStore = true;
+			StartTimeSlicedUnload(Expiry.LevelName);
+		}
+		else
+		{
+			UnloadStreamLevel(Expiry.LevelName);
+		}
+		++NumStarted;
+	}
+}
 
+void USpudSubsystem::ResetStreamingQueues()
+{
+	QueuedStreamLoads.Empty();
+	StreamLevelsLoading.Empty();
+	StreamUnloadQueue.Empty();
+}
 
 void USpudSubsystem::LoadStreamLevel(FName LevelName, bool Blocking)
 {
+	// If this level's data was prefetched it's now the live data, so it must not be released as a stale prefetch
+	// If the prefetch is somehow still in progress, the level would be waiting for that data anyway
+	if (FLevelPrefetch* Prefetch = LevelPrefetches.Find(LevelName))
+	{
+		if (Prefetch->Task.IsValid())
+			Prefetch->Task.Wait();
+		LevelPrefetches.Remove(LevelName);
+	}
+
+	StreamLevelsLoading.Add(LevelName);
+
+	// If we already have the level data we can start loading the classes of actors to respawn while the level streams
+	if (!Blocking && GetActiveState()->IsLevelDataLoaded(LevelName.ToString()))
+		GetActiveState()->PreloadSpawnedActorClassesAsync(LevelName.ToString());
+
 	FScopeLock PendingLoadLock(&LevelsPendingLoadMutex);
 	PreLoadStreamingLevel.Broadcast(LevelName);
 	
@@ -621,19 +1371,28 @@ void USpudSubsystem::PostLoadStreamLevel(int32 LinkID)
 			StreamLevel->SetShouldBeVisible(true);
 		}		
 
-		// Defer the restore to the game thread, streaming calls happen in loading thread?
-		// However, quickly ping the state to force it to pre-load the leveldata
-		// that way the loading occurs in this thread, less latency
-		GetActiveState()->PreLoadLevelData(LevelName.ToString());			
-
-		AsyncTask(ENamedThreads::GameThread, [this, LevelName]()
+		// Load the level data in the background, we only come back to the game thread to restore once it's in
+		// memory, so the game thread never waits on the disk for it
+		TWeakObjectPtr<USpudSubsystem> WeakThis(this);
+		GetActiveState()->PreLoadLevelDataAsync(LevelName.ToString(), [WeakThis, LevelName]()
         {
-			// But also add a slight delay so we get a tick in between so physics works
-			FTimerHandle H;
-			GetWorld()->GetTimerManager().SetTimer(H, [this, LevelName]()
+			if (!WeakThis.IsValid() || !IsValid(WeakThis->GetWorld()))
+				return;
+
+			// Same for the classes of actors which need respawning (this is usually already underway, or done)
+			WeakThis->GetActiveState()->PreloadSpawnedActorClassesAsync(LevelName.ToString(), [WeakThis, LevelName]()
 			{
-				PostLoadStreamLevelGameThread(LevelName);				
-			}, 0.01, false);
+				if (!WeakThis.IsValid() || !IsValid(WeakThis->GetWorld()))
+					return;
+
+				// But also add a slight delay so we get a tick in between so physics works
+				FTimerHandle H;
+				WeakThis->GetWorld()->GetTimerManager().SetTimer(H, [WeakThis, LevelName]()
+				{
+					if (WeakThis.IsValid())
+						WeakThis->PostLoadStreamLevelGameThread(LevelName);
+				}, 0.01, false);
+			});
         });		
 	}
 	else
@@ -645,7 +1404,10 @@ void USpudSubsystem::PostLoadStreamLevel(int32 LinkID)
 
 void USpudSubsystem::PostLoadStreamLevelGameThread(FName LevelName)
 {
-	PostLoadStreamingLevel.Broadcast(LevelName);
+	// When time sliced, the level isn't really loaded as far as anyone else is concerned until it's been restored
+	const bool bTimeSliced = LevelRestoreTimeBudgetMs > 0;
+	if (!bTimeSliced)
+		PostLoadStreamingLevel.Broadcast(LevelName);
 	auto StreamLevel = UGameplayStatics::GetStreamingLevel(GetWorld(), LevelName);
 
 	if (StreamLevel)
@@ -654,26 +1416,138 @@ void USpudSubsystem::PostLoadStreamLevelGameThread(FName LevelName)
 		if (!Level)
 		{
 			UE_LOG(LogSpudSubsystem, Log, TEXT("PostLoadStreamLevel called for %s but level is null; probably unloaded again?"), *LevelName.ToString());
+			FinishStreamLevelLoading(LevelName);
 			return;
 		}
+		LevelRestoreTrackers.FindOrAdd(LevelName).Begin(ESpudOperation::RestoreLevel, LevelName.ToString());
 		PreLevelRestore.Broadcast(LevelName.ToString());
 		// It's important to note that this streaming level won't be added to UWorld::Levels yet
 		// This is usually where things like the TActorIterator get actors from, ULevel::Actors
 		// we have the ULevel here right now, so restore it directly
-		GetActiveState()->RestoreLevel(Level);
+		if (bTimeSliced)
+		{
+			// Restore is advanced from Tick
+			TWeakObjectPtr<USpudSubsystem> WeakThis(this);
+			GetActiveState()->RestoreLevelTimeSliced(Level, [WeakThis, LevelName](bool bSuccess)
+			{
+				if (WeakThis.IsValid())
+					WeakThis->PostRestoreStreamLevel(LevelName, bSuccess, true);
+			});
+		}
+		else
+		{
+			GetActiveState()->RestoreLevel(Level);
+			PostRestoreStreamLevel(LevelName, true, false);
+		}
+	}
+	else
+	{
+		FinishStreamLevelLoading(LevelName);
+	}
+}
 
-		// NB: after restoring the level, we could release MOST of the memory for this level
-		// However, we don't for 2 reasons:
-		// 1. Destroyed actors for this level are logged continuously while running, so that still needs to be active
-		// 2. We can assume that we'll need to write data back to save when this level is unloaded. It's actually less
-		//    memory thrashing to re-use the same memory we have until unload, since it'll likely be almost identical in structure
+void USpudSubsystem::PostRestoreStreamLevel(FName LevelName, bool bSuccess, bool bTimeSliced)
+{
+	// NB: after restoring the level, we could release MOST of the memory for this level
+	// However, we don't for 2 reasons:
+	// 1. Destroyed actors for this level are logged continuously while running, so that still needs to be active
+	// 2. We can assume that we'll need to write data back to save when this level is unloaded. It's actually less
+	//    memory thrashing to re-use the same memory we have until unload, since it'll likely be almost identical in structure
+	FinishStreamLevelLoading(LevelName);
+	auto StreamLevel = UGameplayStatics::GetStreamingLevel(GetWorld(), LevelName);
+	ULevel* Level = StreamLevel ? StreamLevel->GetLoadedLevel() : nullptr;
+	if (bSuccess && Level)
+	{
 		StreamLevel->SetShouldBeVisible(true);
 		SubscribeLevelObjectEvents(Level);
-		PostLevelRestore.Broadcast(LevelName.ToString(), true);
+	}
+	FSpudOperationTracker Tracker;
+	if (LevelRestoreTrackers.RemoveAndCopyValue(LevelName, Tracker))
+		RecordOperationMetrics(Tracker, bSuccess);
+	PostLevelRestore.Broadcast(LevelName.ToString(), bSuccess);
+	if (bTimeSliced && bSuccess)
+		PostLoadStreamingLevel.Broadcast(LevelName);
+}
+
+void USpudSubsystem::RecordOperationMetrics(FSpudOperationTracker& Tracker, bool bSuccess)
+{
+	// Failures before an operation got started (e.g. overlapping saves) aren't measured
+	if (!Tracker.bActive)
+		return;
+
+	const FSpudOperationMetrics Metrics = Tracker.Finish(bSuccess);
+	UE_LOG(LogSpudSubsystem, Verbose, TEXT("%s %s took %.2fms: %d actors stored, %d restored (%d fast, %d slow), %lld bytes read, %lld written, %.2fms lock wait"),
+		*UEnum::GetValueAsString(Metrics.Operation), *Metrics.Target, Metrics.DurationMs, Metrics.ActorsStored,
+		Metrics.ActorsRestored, Metrics.FastPathRestores, Metrics.SlowPathRestores, Metrics.BytesRead,
+		Metrics.BytesWritten, Metrics.LockWaitMs);
+	LastOperationMetrics.Add(Metrics.Operation, Metrics);
+	PostOperationMetrics.Broadcast(Metrics);
+}
+
+FSpudOperationMetrics USpudSubsystem::GetLastOperationMetrics(ESpudOperation Operation) const
+{
+	if (const auto Metrics = LastOperationMetrics.Find(Operation))
+		return *Metrics;
+
+	FSpudOperationMetrics Ret;
+	Ret.Operation = Operation;
+	return Ret;
+}
+
+void USpudSubsystem::StartTimeSlicedUnload(FName LevelName)
+{
+	auto StreamLevel = UGameplayStatics::GetStreamingLevel(GetWorld(), LevelName);
+	ULevel* Level = StreamLevel ? StreamLevel->GetLoadedLevel() : nullptr;
+	if (!Level)
+	{
+		// Already unloaded
+		if (auto Request = LevelRequests.Find(LevelName))
+			Request->bPendingStore = false;
+		return;
+	}
+
+	// Store is advanced from Tick, then the level data is written in the background while we unload
+	LevelStoreTrackers.FindOrAdd(LevelName).Begin(ESpudOperation::StoreLevel, LevelName.ToString());
+	PreLevelStore.Broadcast(LevelName.ToString());
+	TWeakObjectPtr<USpudSubsystem> WeakThis(this);
+	GetActiveState()->StoreLevelTimeSliced(Level, true, [WeakThis, LevelName](bool bSuccess)
+	{
+		if (WeakThis.IsValid())
+			WeakThis->PostTimeSlicedStore(LevelName, bSuccess);
+	});
+}
+
+void USpudSubsystem::PostTimeSlicedStore(FName LevelName, bool bSuccess)
+{
+	auto Request = LevelRequests.Find(LevelName);
+	const bool bWasPending = Request && Request->bPendingStore;
+	if (Request)
+		Request->bPendingStore = false;
+
+	FSpudOperationTracker Tracker;
+	if (LevelStoreTrackers.RemoveAndCopyValue(LevelName, Tracker))
+		RecordOperationMetrics(Tracker, bSuccess);
+	PostLevelStore.Broadcast(LevelName.ToString(), bSuccess);
+
+	if (!bWasPending)
+	{
+		// Cancelled because the level is wanted again
+		return;
+	}
+
+	if (bSuccess)
+	{
+		UnloadStreamLevel(LevelName, false);
+	}
+	else if (Request->Requesters.Num() == 0)
+	{
+		// Cancelled by something else storing the level (e.g. a save game); we still want it gone, so try again
+		Request->bPendingUnload = true;
+		QueueStreamLevelUnload(LevelName, UGameplayStatics::GetTimeSeconds(GetWorld()));
 	}
 }
 
-void USpudSubsystem::UnloadStreamLevel(FName LevelName)
+void USpudSubsystem::UnloadStreamLevel(FName LevelName, bool bStore)
 {
 	auto StreamLevel = UGameplayStatics::GetStreamingLevel(GetWorld(), LevelName);
 
@@ -686,9 +1560,11 @@ void USpudSubsystem::UnloadStreamLevel(FName LevelName)
 			// Already unloaded
 			return;
 		}
+		// A time sliced restore needs to finish before we unsubscribe, and so that the store doesn't lose anything
+		GetActiveState()->CompletePendingRestore(USpudState::GetLevelName(Level));
 		UnsubscribeLevelObjectEvents(Level);
 	
-		if (CurrentState != ESpudSystemState::LoadingGame)
+		if (bStore && CurrentState != ESpudSystemState::LoadingGame)
 		{
 			// save the state, if not loading game
 			// when loading game we will unload the current level and streaming and don't want to restore the active state from that
@@ -726,6 +1602,22 @@ int32 USpudSubsystem::GetUserDataModelVersion() const
 	return GCurrentUserDataModelVersion;
 }
 
+void USpudSubsystem::MarkActorDirty(AActor* Actor)
+{
+	GetActiveState()->MarkActorDirty(Actor);
+}
+
+void USpudSubsystem::SetCompressLevelData(bool bCompress)
+{
+	bCompressLevelData = bCompress;
+	if (bCompress && !FCompression::IsFormatValid(LevelDataCompressionFormat))
+	{
+		UE_LOG(LogSpudSubsystem, Error, TEXT("Level data compression format %s is not available, falling back on Zlib"), *LevelDataCompressionFormat.ToString());
+		LevelDataCompressionFormat = NAME_Zlib;
+	}
+	GSpudLevelDataCompressionFormat = bCompress ? LevelDataCompressionFormat : NAME_None;
+}
+
 void USpudSubsystem::PostUnloadStreamLevel(int32 LinkID)
 {
 	FScopeLock PendingUnloadLock(&LevelsPendingUnloadMutex);
@@ -803,7 +1695,9 @@ void USpudSubsystem::UnsubscribeLevelObjectEvents(ULevel* Level)
 
 void USpudSubsystem::OnActorDestroyed(AActor* Actor)
 {
-	if (CurrentState == ESpudSystemState::RunningIdle)
+	// Saving is included because with background saves, the game keeps running while the file is written
+	if (CurrentState == ESpudSystemState::RunningIdle ||
+		CurrentState == ESpudSystemState::SavingGame)
 	{
 		auto Level = Actor->GetLevel();
 		// Ignore actor destruction caused by levels being unloaded
@@ -841,14 +1735,44 @@ struct FSaveSorter
 
 TArray<USpudSaveGameInfo*> USpudSubsystem::GetSaveGameList(bool bIncludeQuickSave, bool bIncludeAutoSave, ESpudSaveSorting Sorting)
 {
+	LoadSaveSlotIndexIfNeeded();
 
-	TArray<FString> SaveFiles;
-	ListSaveGameFiles(SaveFiles);
+	// Check the index against what's actually on disk. A directory listing gives us sizes & timestamps without
+	// opening anything, so only saves which are new or have changed since they were indexed need their header read
+	bool bIndexChanged = false;
+	TSet<FString> PresentSlots;
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.IterateDirectoryStat(*GetSaveGameDirectory(), [this, &bIndexChanged, &PresentSlots](const TCHAR* Filename, const FFileStatData& Stat)
+	{
+		if (Stat.bIsDirectory || FPaths::GetExtension(Filename) != TEXT("sav"))
+			return true;
+
+		const FString SlotName = FPaths::GetBaseFilename(Filename);
+		const auto Entry = SaveSlotIndex.Contents.Find(SlotName);
+		if (!Entry || Entry->FileSize != Stat.FileSize || Entry->FileTimestamp != Stat.ModificationTime)
+		{
+			bIndexChanged = true;
+			if (!UpdateSaveSlotIndex(SlotName, Stat.FileSize, Stat.ModificationTime))
+				return true;
+		}
+		PresentSlots.Add(SlotName);
+		return true;
+	});
+	for (auto It = SaveSlotIndex.Contents.CreateIterator(); It; ++It)
+	{
+		if (!PresentSlots.Contains(It.Key()))
+		{
+			It.RemoveCurrent();
+			bIndexChanged = true;
+		}
+	}
+	if (bIndexChanged)
+		WriteSaveSlotIndex();
 
 	TArray<USpudSaveGameInfo*> Ret;
-	for (auto && File : SaveFiles)
+	for (auto && Pair : SaveSlotIndex.Contents)
 	{
-		FString SlotName = FPaths::GetBaseFilename(File);
+		const FString& SlotName = Pair.Key;
 
 		if ((!bIncludeQuickSave && SlotName == SPUD_QUICKSAVE_SLOTNAME) ||
 			(!bIncludeAutoSave && SlotName == SPUD_AUTOSAVE_SLOTNAME))
@@ -856,9 +1780,7 @@ TArray<USpudSaveGameInfo*> USpudSubsystem::GetSaveGameList(bool bIncludeQuickSav
 			continue;			
 		}
 
-		auto Info = GetSaveGameInfo(SlotName);
-		if (Info)
-			Ret.Add(Info);
+		Ret.Add(CreateSaveGameInfo(Pair.Value));
 	}
 
 	if (Sorting != ESpudSaveSorting::None)
@@ -884,6 +1806,7 @@ USpudSaveGameInfo* USpudSubsystem::GetSaveGameInfo(const FString& SlotName)
 		
 	auto Info = NewObject<USpudSaveGameInfo>();
 	Info->SlotName = SlotName;
+	Info->Filename = AbsoluteFilename;
 
 	USpudState::LoadSaveInfoFromArchive(*Archive, *Info);
 	Archive->Close();
@@ -891,6 +1814,98 @@ USpudSaveGameInfo* USpudSubsystem::GetSaveGameInfo(const FString& SlotName)
 	return Info;
 }
 
+USpudSaveGameInfo* USpudSubsystem::CreateSaveGameInfo(const FSpudSaveSlotInfo& SlotInfo)
+{
+	auto Info = NewObject<USpudSaveGameInfo>();
+	Info->SlotName = SlotInfo.SlotName;
+	Info->Filename = GetSaveGameFilePath(SlotInfo.SlotName);
+	Info->Title = SlotInfo.Title;
+	Info->Timestamp = SlotInfo.Timestamp;
+	Info->bHasThumbnail = SlotInfo.bHasScreenshot;
+	Info->Thumbnail = nullptr;
+	Info->CustomInfo = NewObject<USpudCustomSaveInfo>();
+	Info->CustomInfo->SetData(SlotInfo.CustomInfo);
+	return Info;
+}
+
+void USpudSubsystem::LoadSaveSlotIndexIfNeeded()
+{
+	if (bSaveSlotIndexLoaded)
+		return;
+
+	bSaveSlotIndexLoaded = true;
+	SaveSlotIndex.Empty();
+	// It's fine for this not to exist, it'll be rebuilt from the saves
+	auto Archive = TUniquePtr<FArchive>(IFileManager::Get().CreateFileReader(*GetSaveSlotIndexFilePath(), FILEREAD_Silent));
+	if (Archive)
+	{
+		FSpudChunkedDataArchive ChunkedAr(*Archive);
+		SaveSlotIndex.ReadFromArchive(ChunkedAr, SPUD_CURRENT_SYSTEM_VERSION);
+		Archive->Close();
+
+		if (Archive->IsError() || Archive->IsCriticalError())
+		{
+			UE_LOG(LogSpudSubsystem, Warning, TEXT("Save slot index %s is unreadable, rebuilding it"), *GetSaveSlotIndexFilePath());
+			SaveSlotIndex.Empty();
+		}
+	}
+}
+
+void USpudSubsystem::WriteSaveSlotIndex()
+{
+	auto Archive = TUniquePtr<FArchive>(IFileManager::Get().CreateFileWriter(*GetSaveSlotIndexFilePath()));
+	if (Archive)
+	{
+		FSpudChunkedDataArchive ChunkedAr(*Archive);
+		SaveSlotIndex.WriteToArchive(ChunkedAr);
+		Archive->Close();
+
+		if (Archive->IsError() || Archive->IsCriticalError())
+		{
+			UE_LOG(LogSpudSubsystem, Error, TEXT("Error while writing save slot index %s"), *GetSaveSlotIndexFilePath());
+		}
+	}
+	else
+	{
+		UE_LOG(LogSpudSubsystem, Error, TEXT("Unable to open save slot index %s for writing"), *GetSaveSlotIndexFilePath());
+	}
+}
+
+bool USpudSubsystem::UpdateSaveSlotIndex(const FString& SlotName, int64 FileSize, const FDateTime& FileTimestamp)
+{
+	FSpudSaveInfo StorageInfo;
+	bool bOK = false;
+	auto Archive = TUniquePtr<FArchive>(IFileManager::Get().CreateFileReader(*GetSaveGameFilePath(SlotName)));
+	if (Archive)
+	{
+		FSpudChunkedDataArchive ChunkedAr(*Archive);
+		bOK = FSpudSaveData::ReadSaveInfoFromArchive(ChunkedAr, StorageInfo);
+		Archive->Close();
+	}
+
+	if (!bOK)
+	{
+		UE_LOG(LogSpudSubsystem, Warning, TEXT("Unable to read info for save slot %s, ignoring it"), *SlotName);
+		SaveSlotIndex.Contents.Remove(SlotName);
+		return false;
+	}
+
+	FSpudSaveSlotInfo& Entry = SaveSlotIndex.Contents.FindOrAdd(SlotName);
+	Entry.SlotName = SlotName;
+	Entry.SetFromSaveInfo(StorageInfo);
+	Entry.FileSize = FileSize;
+	Entry.FileTimestamp = FileTimestamp;
+	return true;
+}
+
+void USpudSubsystem::UpdateSaveSlotIndexFromFile(const FString& SlotName)
+{
+	LoadSaveSlotIndexIfNeeded();
+	const FFileStatData Stat = FPlatformFileManager::Get().GetPlatformFile().GetStatData(*GetSaveGameFilePath(SlotName));
+	if (Stat.bIsValid && UpdateSaveSlotIndex(SlotName, Stat.FileSize, Stat.ModificationTime))
+		WriteSaveSlotIndex();
+}
+
 USpudSaveGameInfo* USpudSubsystem::GetLatestSaveGame()
 {
 	auto SaveGameList = GetSaveGameList();
@@ -924,6 +1939,12 @@ FString USpudSubsystem::GetSaveGameFilePath(const FString& SlotName)
 	return FString::Printf(TEXT("%s%s.sav"), *GetSaveGameDirectory(), *SlotName);
 }
 
+FString USpudSubsystem::GetSaveSlotIndexFilePath()
+{
+	// Not a .sav so it's never mistaken for a save
+	return FString::Printf(TEXT("%sSpudSaveIndex.idx"), *GetSaveGameDirectory());
+}
+
 void USpudSubsystem::ListSaveGameFiles(TArray<FString>& OutSaveFileList)
 {
 	IFileManager& FM = IFileManager::Get();
@@ -953,68 +1974,132 @@ public:
 	{
 		bool bUpgradeAlways;
 		FSpudUpgradeSaveDelegate UpgradeCallback;
+		int32 MaxConcurrency;
+		/// The callback is only ever called for one save at a time, so it doesn't have to be thread safe
+		FCriticalSection CallbackMutex;
 		
-		FUpgradeTask(bool InUpgradeAlways, FSpudUpgradeSaveDelegate InCallback) : bUpgradeAlways(InUpgradeAlways), UpgradeCallback(InCallback) {}
+		FUpgradeTask(bool InUpgradeAlways, FSpudUpgradeSaveDelegate InCallback, int32 InMaxConcurrency)
+			: bUpgradeAlways(InUpgradeAlways), UpgradeCallback(InCallback), MaxConcurrency(InMaxConcurrency) {}
 
-		bool SaveNeedsUpgrading(const USpudState* State)
+		bool SaveNeedsUpgrading(USpudState* State)
 		{
 			if (State->SaveData.GlobalData.IsUserDataModelOutdated())
 				return true;
 
-			for (auto& Pair : State->SaveData.LevelDataMap)
+			for (auto& LevelData : State->SaveData.GetLevelDataSnapshot())
 			{
-				if (Pair.Value->IsUserDataModelOutdated())
+				// Only one level in memory at a time
+				FSpudSaveData::LoadLevelDataIfNeeded(LevelData, FSpudSaveData::GetLevelDataPath(State->LevelCacheFolder, LevelData->Name));
+				bool bOutdated;
+				{
+					FSpudScopeLock LevelLock(&LevelData->Mutex);
+					bOutdated = LevelData->IsUserDataModelOutdated();
+				}
+				State->SaveData.ReleaseUnmodifiedLevelData(LevelData->Name);
+				if (bOutdated)
 					return true;				
 			}
 
 			return false;
 		}
 
-		void DoWork()
+		void UpgradeSave(const FString& SaveFile)
 		{
-			if (!UpgradeCallback.IsBound())
-				return;
-			
 			IFileManager& FileMgr = IFileManager::Get();
-			TArray<FString> SaveFiles;
-			USpudSubsystem::ListSaveGameFiles(SaveFiles);
+			const FString AbsoluteFilename = FPaths::Combine(USpudSubsystem::GetSaveGameDirectory(), SaveFile);
+			auto Archive = TUniquePtr<FArchive>(FileMgr.CreateFileReader(*AbsoluteFilename));
+			if (!Archive)
+				return;
 
-			for (auto && SaveFile : SaveFiles)
+			// Most saves won't need upgrading, so find that out from just the metadata versions if we can
+			bool bKnowIfOutdated = false;
+			if (!bUpgradeAlways)
 			{
-				FString AbsoluteFilename = FPaths::Combine(USpudSubsystem::GetSaveGameDirectory(), SaveFile);
-				auto Archive = TUniquePtr<FArchive>(FileMgr.CreateFileReader(*AbsoluteFilename));
+				FSpudChunkedDataArchive ChunkedAr(*Archive);
+				bool bOutdated = false;
+				bKnowIfOutdated = FSpudSaveData::ReadIsUserDataModelOutdated(ChunkedAr, bOutdated);
+				if (bKnowIfOutdated && !bOutdated)
+					return;
+				Archive->Seek(0);
+			}
 
-				if(Archive)
-				{
-					auto State = NewObject<USpudState>();
-					// Load all data because we want to upgrade
-					State->LoadFromArchive(*Archive, true);
-					Archive->Close();
+			USpudState* State;
+			{
+				// Not on the game thread, so keep GC away from the state while we're using it
+				FGCScopeGuard GCGuard;
+				State = NewObject<USpudState>();
+				State->AddToRoot();
+			}
+			// Our own level files, so saves can be upgraded in parallel without touching the active game's
+			State->LevelCacheFolder = FString::Printf(TEXT("%sSpudUpgrade/%s/"), *FPaths::ProjectSavedDir(), *FPaths::GetBaseFilename(SaveFile));
+
+			// Levels are only loaded as they're needed, one at a time (@see USpudState::ModifyLevelMetadata), read
+			// straight from the save file where possible
+			State->LoadFromArchive(*Archive, false, AbsoluteFilename);
+			Archive->Close();
 
-					if (Archive->IsError() || Archive->IsCriticalError())
+			if (Archive->IsError() || Archive->IsCriticalError())
+			{
+				UE_LOG(LogSpudSubsystem, Error, TEXT("Error while loading game to check for upgrades: %s"), *SaveFile);
+			}
+			else if (bUpgradeAlways || bKnowIfOutdated || SaveNeedsUpgrading(State))
+			{
+				bool bChanged;
+				{
+					FScopeLock CallbackLock(&CallbackMutex);
+					bChanged = UpgradeCallback.Execute(State);
+				}
+				if (bChanged)
+				{
+					// Levels we didn't need to touch are still read from the original, so write a new file first
+					const FString TempFilename = AbsoluteFilename + ".tmp";
+					auto OutArchive = TUniquePtr<FArchive>(FileMgr.CreateFileWriter(*TempFilename));
+					bool bWritten = false;
+					if (OutArchive)
 					{
-						UE_LOG(LogSpudSubsystem, Error, TEXT("Error while loading game to check for upgrades: %s"), *SaveFile);
-						continue;
+						State->SaveToArchive(*OutArchive);
+						bWritten = OutArchive->Close() && !OutArchive->IsError();
 					}
 
-					if (bUpgradeAlways || SaveNeedsUpgrading(State))
+					if (bWritten)
 					{
-						if (UpgradeCallback.Execute(State))
-						{
-							// Move aside old save
-							FString BackupFilename = AbsoluteFilename + ".bak"; 
-							FileMgr.Move(*BackupFilename, *AbsoluteFilename, true, true);
-							// Now save
-							auto OutArchive = TUniquePtr<FArchive>(FileMgr.CreateFileWriter(*AbsoluteFilename));
-							if (OutArchive)
-							{
-								State->SaveToArchive(*OutArchive);
-							}
-						}
+						// Move aside old save
+						const FString BackupFilename = AbsoluteFilename + ".bak";
+						FileMgr.Move(*BackupFilename, *AbsoluteFilename, true, true);
+						FileMgr.Move(*AbsoluteFilename, *TempFilename, true, true);
+					}
+					else
+					{
+						UE_LOG(LogSpudSubsystem, Error, TEXT("Error while writing upgraded save game %s, left unchanged"), *SaveFile);
+						FileMgr.Delete(*TempFilename, false, true, true);
 					}
 				}
 			}
 
+			FSpudSaveData::DeleteAllLevelDataFiles(State->LevelCacheFolder);
+			FileMgr.DeleteDirectory(*State->LevelCacheFolder, false, true);
+			State->RemoveFromRoot();
+		}
+
+		void DoWork()
+		{
+			if (!UpgradeCallback.IsBound())
+				return;
+			
+			TArray<FString> SaveFiles;
+			USpudSubsystem::ListSaveGameFiles(SaveFiles);
+
+			// A fixed number of workers each taking the next save, so no more than MaxConcurrency are in memory at once
+			TAtomic<int32> NextSave(0);
+			const int32 NumWorkers = FMath::Clamp(MaxConcurrency, 1, FMath::Max(SaveFiles.Num(), 1));
+			ParallelFor(NumWorkers, [&](int32)
+			{
+				for (int32 i = NextSave++; i < SaveFiles.Num(); i = NextSave++)
+				{
+					UpgradeSave(SaveFiles[i]);
+				}
+			}, NumWorkers == 1);
+
 		}
 
 		FORCEINLINE TStatId GetStatId() const
@@ -1026,11 +2111,11 @@ public:
 
 	FAsyncTask<FUpgradeTask> UpgradeTask;
 
-	FUpgradeAllSavesAction(bool UpgradeAlways, FSpudUpgradeSaveDelegate InUpgradeCallback, const FLatentActionInfo& LatentInfo)
+	FUpgradeAllSavesAction(bool UpgradeAlways, FSpudUpgradeSaveDelegate InUpgradeCallback, int32 MaxConcurrency, const FLatentActionInfo& LatentInfo)
         : ExecutionFunction(LatentInfo.ExecutionFunction)
         , OutputLink(LatentInfo.Linkage)
         , CallbackTarget(LatentInfo.CallbackTarget)
-        , UpgradeTask(UpgradeAlways, InUpgradeCallback)
+        , UpgradeTask(UpgradeAlways, InUpgradeCallback, MaxConcurrency)
 	{
 		// We do the actual upgrade work in a background task, this action is just to monitor when it's done
 		UpgradeTask.StartBackgroundTask();
@@ -1061,7 +2146,7 @@ void USpudSubsystem::UpgradeAllSaveGames(bool bUpgradeEvenIfNoUserDataModelVersi
 	{
 		LatentActionManager.AddNewAction(LatentInfo.CallbackTarget, LatentInfo.UUID,
 		                                 new FUpgradeAllSavesAction(bUpgradeEvenIfNoUserDataModelVersionDifferences,
-		                                                            SaveNeedsUpgradingCallback, LatentInfo));
+		                                                            SaveNeedsUpgradingCallback, MaxConcurrentSaveUpgrades, LatentInfo));
 	}
 }
 
@@ -1077,6 +2162,23 @@ USpudCustomSaveInfo* USpudSubsystem::CreateCustomSaveInfo()
 
 void USpudSubsystem::Tick(float DeltaTime)
 {
+	if (LevelPrefetches.Num() > 0)
+		CheckPrefetchExpiry();
+
+	if (IsValid(GetWorld()))
+	{
+		if (StreamUnloadQueue.Num() > 0)
+			ProcessStreamUnloadQueue();
+		if (QueuedStreamLoads.Num() > 0)
+			DispatchQueuedStreamLoads();
+	}
+
+	if (IsValid(ActiveState) && ActiveState->HasPendingRestores())
+		ActiveState->TickTimeSlicedRestores(FMath::Max(LevelRestoreTimeBudgetMs, 0.f) / 1000.0);
+
+	if (IsValid(ActiveState) && ActiveState->HasPendingStores())
+		ActiveState->TickTimeSlicedStores(FMath::Max(LevelStoreTimeBudgetMs, 0.f) / 1000.0);
+
 	if (ScreenshotTimeout > 0)
 	{
 		ScreenshotTimeout -= DeltaTime;
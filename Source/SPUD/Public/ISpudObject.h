@@ -35,6 +35,13 @@ public:
 	/// they always have the same names between save & load. 
 	/// This can only be changed in C++ implementations and not Blueprints since they don't support this default impl
     virtual ESpudRespawnMode GetSpudRespawnMode() const { return ESpudRespawnMode::Default; }
+
+	/// Return true if this object tells SPUD whenever its persistent state changes, by calling MarkActorDirty on
+	/// USpudSubsystem. When incremental level stores are enabled (bIncrementalLevelStore), tracked objects which have
+	/// already been stored once are only stored again after they've been marked dirty, which makes storing levels
+	/// where most things don't change much cheaper. Untracked objects (the default) are stored every time.
+	/// This can only be changed in C++ implementations and not Blueprints since they don't support this default impl
+	virtual bool IsSpudDirtyTracked() const { return false; }
 	
 };
 
@@ -1,10 +1,21 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "Async/MappedFileHandle.h"
+#include "Serialization/MemoryArchive.h"
+#include "UObject/WeakObjectPtr.h"
+#include "UObject/WeakObjectPtrTemplates.h"
 
 DECLARE_LOG_CATEGORY_EXTERN(LogSpudData, Verbose, Verbose);
 
 extern int32 GCurrentUserDataModelVersion;
+/// The FCompression format used for level data written from now on, or NAME_None to write it uncompressed
+extern FName GSpudLevelDataCompressionFormat;
+/// Whether level files in the cache are memory mapped when loaded, rather than read into owned buffers
+extern bool GSpudMapLevelFiles;
+/// Whether level class definitions are written as references into the save-wide shared table, rather than in full
+extern bool GSpudShareClassDefinitions;
 
 // Chunk IDs
 #define SPUDDATA_SAVEGAME_MAGIC "SAVE"
@@ -17,12 +28,19 @@ extern int32 GCurrentUserDataModelVersion;
 #define SPUDDATA_CLASSDEF_MAGIC "CDEF"
 #define SPUDDATA_CLASSNAMEINDEX_MAGIC "CNIX"
 #define SPUDDATA_PROPERTYNAMEINDEX_MAGIC "PNIX"
+#define SPUDDATA_ACTORNAMEINDEX_MAGIC "ANIX"
+#define SPUDDATA_SHAREDCLASSES_MAGIC "SHCL"
+#define SPUDDATA_SHAREDCLASSREFS_MAGIC "CREF"
 #define SPUDDATA_VERSIONINFO_MAGIC "VERS"
 #define SPUDDATA_NAMEDOBJECT_MAGIC "NOBJ"
 #define SPUDDATA_SPAWNEDACTOR_MAGIC "SPWN"
 #define SPUDDATA_DESTROYEDACTOR_MAGIC "KILL"
 #define SPUDDATA_LEVELDATAMAP_MAGIC "LVLS"
+#define SPUDDATA_LEVELINDEX_MAGIC "LIDX"
+#define SPUDDATA_SAVESLOTINDEX_MAGIC "SIDX"
+#define SPUDDATA_SAVESLOTINFO_MAGIC "SLOT"
 #define SPUDDATA_LEVELDATA_MAGIC "LEVL"
+#define SPUDDATA_COMPRESSEDLEVELDATA_MAGIC "LEVZ"
 #define SPUDDATA_GLOBALDATA_MAGIC "GLOB"
 #define SPUDDATA_GLOBALOBJECTLIST_MAGIC "GOBS"
 #define SPUDDATA_LEVELACTORLIST_MAGIC "LATS"
@@ -56,6 +74,8 @@ extern int32 GCurrentUserDataModelVersion;
 // - Save Info Chunk
 // - Global Data Chunk
 // - Level Chunks x N
+// - Shared Class Definitions Chunk (optional, older saves don't have it): class definitions referenced by levels
+// - Level Index Chunk (optional, older saves don't have it): name, offset & length of each level chunk
 
 // Save Info is a chunk of the minimal data needed to describe the save game, for easy access to a description of the
 // save. Global Data includes what map the player is on, and the state of global objects like GameInstance.
@@ -96,10 +116,31 @@ enum SPUD_API ESpudStorageType // (stored as uint16 but not using enum class to
 	/// 1. Element Count (uint16 - max 65536 elements)
 	/// 2. Data x Element Count
 	ESST_ArrayOf = 0x1000,
+	/// LargeArrayOf is combined with ArrayOf to indicate the larger array encoding (an encoding detail, not a type
+	/// difference, so ignored when comparing types):
+	/// 1. Element Count (uint32)
+	/// 2. Data x Element Count. For plain data elements (numbers, FVector, FRotator, FGuid) this is written and read
+	///    as a single block
+	ESST_LargeArrayOf = 0x2000,
+	/// PackedActorRef is combined with actor references (stored as String) to indicate the binary encoding; again
+	/// only an encoding detail, ignored when comparing actor reference types:
+	/// 1. Tag (uint8, ESpudActorRefTag)
+	/// 2. For RuntimeGuid, the actor's SpudGuid (FGuid); for LevelActor, the index of its name in the
+	///    metadata's ActorNameIndex (uint32); nothing for None
+	/// Without it, actor references are a string: empty, a braced GUID for runtime actors, or a level actor's name
+	ESST_PackedActorRef = 0x4000,
 	ESST_Single = 0x0 // to indicate not an array, useful sometimes
 	
 };
 
+/// What a packed actor reference refers to (@see ESST_PackedActorRef)
+enum class ESpudActorRefTag : uint8
+{
+	None = 0,
+	RuntimeGuid = 1,
+	LevelActor = 2
+};
+
 /// Common header for all data types
 struct SPUD_API FSpudChunkHeader
 {
@@ -160,8 +201,45 @@ struct SPUD_API FSpudChunkHeader
 	}
 };
 
+/// A whole file memory mapped for reading. Shared by the level data read from it, and unmapped when the last
+/// reference goes away
+struct SPUD_API FSpudMappedFile
+{
+	// Order matters, region must be released before the handle
+	TUniquePtr<IMappedFileHandle> Handle;
+	TUniquePtr<IMappedFileRegion> Region;
+
+	TArrayView<const uint8> GetView() const;
+
+	/// Map a file, or return null if that's not possible (e.g. the platform doesn't support it)
+	static TSharedPtr<FSpudMappedFile, ESPMode::ThreadSafe> Open(const FString& Filename);
+};
+
+/// Read-only archive over memory we don't own; like FMemoryReader but doesn't need a TArray
+class SPUD_API FSpudMemoryViewReader : public FMemoryArchive
+{
+public:
+	explicit FSpudMemoryViewReader(TArrayView<const uint8> InView) : View(InView)
+	{
+		SetIsLoading(true);
+	}
+
+	virtual void Serialize(void* Data, int64 Num) override;
+	virtual int64 TotalSize() override { return View.Num(); }
+	virtual FString GetArchiveName() const override { return TEXT("FSpudMemoryViewReader"); }
+
+protected:
+	TArrayView<const uint8> View;
+};
+
 struct SPUD_API FSpudChunkedDataArchive : public FArchiveProxy
 {
+	/// If the inner archive is reading a memory mapped file, the whole of that file. Data holders can then refer
+	/// to their data in place rather than copying it (@see FSpudMappedFile)
+	TArrayView<const uint8> MappedView;
+	/// Set if the inner archive is reading from memory, so seeking around is cheap (@see IsMemoryBacked)
+	bool bMemoryBacked = false;
+
 	FSpudChunkedDataArchive(FArchive& InInnerArchive)
         : FArchiveProxy(InInnerArchive)
 	{
@@ -174,6 +252,14 @@ struct SPUD_API FSpudChunkedDataArchive : public FArchiveProxy
 	bool NextChunkIs(uint32 EncodedMagic);
 	bool NextChunkIs(const char* Magic);
 	void SkipNextChunk();
+	/// Whether the inner archive is reading from memory, either its own or a mapped file
+	bool IsMemoryBacked() const { return bMemoryBacked || MappedView.Num() > 0; }
+	/// Flag an error on the inner archive too, since that's the one whoever opened it will be checking
+	void SetError()
+	{
+		FArchiveProxy::SetError();
+		InnerArchive.SetError();
+	}
 };
 
 struct SPUD_API FSpudChunk
@@ -192,6 +278,10 @@ struct SPUD_API FSpudChunk
 	bool ChunkStart(FArchive& Ar);
 	void ChunkEnd(FArchive& Ar);
 	bool IsStillInChunk(FArchive& Ar) const;
+	/// Count the child chunks with a given magic left in this chunk, without reading them, so containers can be
+	/// sized before they're populated. Only valid when loading; the archive is left where it was.
+	/// This seeks over the whole chunk, so it's only worth it when the archive is memory backed
+	int32 CountChildChunks(FSpudChunkedDataArchive& Ar, uint32 EncodedMagic) const;
 };
 
 // An ad-hoc chunk used to wrap other chunks. 
@@ -277,6 +367,25 @@ struct SPUD_API FSpudClassDef : public FSpudChunk
 	/// Return Whether this Class definition matches the current runtime class properties exactly
 	/// Only calculated once after loading
 	bool MatchesRuntimeClass(const struct FSpudClassMetadata& ParentMeta) const;
+
+	/// The property index for each entry in the runtime property plan last used to store this class
+	/// (@see FSpudPropertyPlan). Not persisted
+	TArray<int> PlanPropertyIndexes;
+	/// Serial number of the plan PlanPropertyIndexes relates to, 0 if none
+	uint32 PlanSerial = 0;
+
+	/// When this definition doesn't match the runtime class, the stored property index for each entry in the runtime
+	/// property plan, or -1 if it wasn't stored, so restoring doesn't need to look properties up by name. Not persisted
+	mutable TArray<int> RemapPropertyIndexes;
+	/// For each entry in RemapPropertyIndexes, whether the stored type is exactly the runtime type
+	mutable TArray<bool> RemapTypeMatches;
+	/// Serial number of the plan RemapPropertyIndexes relates to, 0 if none
+	mutable uint32 RemapPlanSerial = 0;
+
+	/// The shared definition this is identical to, last time it was written (@see FSpudSharedClassTable). Not persisted
+	mutable uint32 SharedDefID = SPUDDATA_INDEX_NONE;
+	/// Serial number of the shared table SharedDefID relates to, 0 if none
+	mutable uint32 SharedTableSerial = 0;
 	
 };
 
@@ -285,6 +394,13 @@ struct SPUD_API FSpudClassDef : public FSpudChunk
 struct SPUD_API FSpudDataHolder : public FSpudChunk
 {
 	TArray<uint8> Data;
+	/// If read from a memory mapped level file, the data in that file instead of in Data
+	TArrayView<const uint8> MappedData;
+
+	/// The data, wherever it is. Use this for reading; writing should only ever be to Data
+	TArrayView<const uint8> GetData() const { return MappedData.Num() > 0 ? MappedData : TArrayView<const uint8>(Data); }
+	/// Copy any mapped data into Data, so that this no longer needs the mapped file
+	void DetachFromMappedFile();
 
 	virtual void WriteToArchive(FSpudChunkedDataArchive& Ar) override;
 	virtual void ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion) override;
@@ -301,6 +417,13 @@ struct SPUD_API FSpudPropertyData : public FSpudChunk
 	// (string lengths, array lengths can vary)
 	TArray<uint32> PropertyOffsets;
 	TArray<uint8> Data;
+	/// If read from a memory mapped level file, the data in that file instead of in Data
+	TArrayView<const uint8> MappedData;
+
+	/// The data, wherever it is. Use this for reading; writing should only ever be to Data
+	TArrayView<const uint8> GetData() const { return MappedData.Num() > 0 ? MappedData : TArrayView<const uint8>(Data); }
+	/// Copy any mapped data into Data, so that this no longer needs the mapped file
+	void DetachFromMappedFile();
 	
 	virtual const char* GetMagic() const override { return SPUDDATA_PROPERTYDATA_MAGIC; }
 	virtual void WriteToArchive(FSpudChunkedDataArchive& Ar) override;
@@ -330,6 +453,11 @@ struct SPUD_API FSpudObjectData : public FSpudChunk
 	FSpudPropertyData Properties;
 	// Chunk of custom data (may be empty, only present if ISpudCallback implementation populates it)
 	FSpudCustomData CustomData;
+
+	void DetachFromMappedFile();
+	/// Take the (emptied) buffers of another entry, so storing into this one can write over memory that's already
+	/// allocated. Other gets our buffers, and shouldn't be used again
+	void ReuseBuffersFrom(FSpudObjectData& Other);
 };
 
 
@@ -340,7 +468,15 @@ struct SPUD_API FSpudNamedObjectData : public FSpudObjectData
 	FString Name;
 
 	/// Key value for indexing this item; name is unique in the level
-	FString Key() const { return Name; }
+	/// In memory we key on an FName so lookups for actors don't have to build a string every time
+	FName Key() const { return FName(*Name); }
+
+	/// As FSpudObjectData::ReuseBuffersFrom, but also takes the name since it's the same for the same key
+	void ReuseBuffersFrom(FSpudNamedObjectData& Other)
+	{
+		FSpudObjectData::ReuseBuffersFrom(Other);
+		Swap(Name, Other.Name);
+	}
 
 	virtual const char* GetMagic() const override { return SPUDDATA_NAMEDOBJECT_MAGIC; }
 	virtual void WriteToArchive(FSpudChunkedDataArchive& Ar) override;
@@ -353,8 +489,8 @@ struct SPUD_API FSpudSpawnedActorData : public FSpudObjectData
 	uint32 ClassID; // ID for the ClassName (see FSpudClassNameIndex) 
 	FGuid Guid;
 
-	/// Key value for indexing this item; name is unique in the level
-	FString Key() const { return Guid.ToString(SPUDDATA_GUID_KEY_FORMAT); }
+	/// Key value for indexing this item; Guid is unique in the level
+	FGuid Key() const { return Guid; }
 
 	virtual const char* GetMagic() const override { return SPUDDATA_SPAWNEDACTOR_MAGIC; }
 	virtual void WriteToArchive(FSpudChunkedDataArchive& Ar) override;
@@ -382,8 +518,33 @@ template <typename K, typename V>
 struct FSpudStructMapData : public FSpudChunk
 {
 	TMap<K, V> Contents;
+	/// Entries moved aside by BeginReuse which haven't been added again yet. Not persisted
+	TMap<K, V> Recycled;
 
-	void Empty() { Contents.Empty(); }
+	void Empty() { Contents.Empty(); Recycled.Empty(); }
+
+	/// Clear the contents ready for re-populating, but keep the old entries aside so that adding an entry with the
+	/// same key again (@see AddReused) doesn't need to allocate anything
+	void BeginReuse()
+	{
+		Recycled.Reset();
+		Swap(Contents, Recycled);
+	}
+	/// Add an entry, taking the buffers of the recycled entry with the same key if there is one
+	V& AddReused(const K& Key, bool& bOutReused)
+	{
+		V& Ret = Contents.Add(Key);
+		V* Old = Recycled.Find(Key);
+		bOutReused = Old != nullptr;
+		if (Old)
+		{
+			Ret.ReuseBuffersFrom(*Old);
+			Recycled.Remove(Key);
+		}
+		return Ret;
+	}
+	/// Drop any recycled entries which weren't re-added, keeping the map storage
+	void EndReuse() { Recycled.Reset(); }
 
 	virtual const char* GetChildMagic() const = 0;
 
@@ -405,17 +566,19 @@ struct FSpudStructMapData : public FSpudChunk
 	{
 		if (ChunkStart(Ar))
 		{
-			Contents.Empty();
-
 			// Detect chunks & only load compatible
 			const uint32 ChildMagicID = FSpudChunkHeader::EncodeMagic(GetChildMagic());
-			V ChildData;
+			// Counting first is only cheaper than growing when we don't have to read everything twice
+			Contents.Empty(Ar.IsMemoryBacked() ? CountChildChunks(Ar, ChildMagicID) : 0);
 			while (IsStillInChunk(Ar))
 			{
 				if (Ar.NextChunkIs(ChildMagicID))
 				{
+					// Fresh entry each time & moved into the map, so its buffers aren't copied
+					V ChildData;
 					ChildData.ReadFromArchive(Ar, StoredSystemVersion);
-					Contents.Add(ChildData.Key(), ChildData);						
+					const K Key = ChildData.Key();
+					Contents.Add(Key, MoveTemp(ChildData));
 				}
 				else
 				{
@@ -429,6 +592,7 @@ struct FSpudStructMapData : public FSpudChunk
 	void Reset()
 	{
 		Contents.Empty();
+		Recycled.Empty();
 	}
 	
 };
@@ -457,17 +621,14 @@ struct FSpudArray : public FSpudChunk
 	{
 		if (ChunkStart(Ar))
 		{
-			Values.Empty();
-
 			// Detect chunks & only load compatible
 			const uint32 ChildMagicID = FSpudChunkHeader::EncodeMagic(GetChildMagic());
-			T ChildData;
+			Values.Empty(Ar.IsMemoryBacked() ? CountChildChunks(Ar, ChildMagicID) : 0);
 			while (IsStillInChunk(Ar))
 			{
 				if (Ar.NextChunkIs(ChildMagicID))
 				{
-					ChildData.ReadFromArchive(Ar, StoredSystemVersion);
-					Values.Add(ChildData);						
+					Values.AddDefaulted_GetRef().ReadFromArchive(Ar, StoredSystemVersion);
 				}
 				else
 				{
@@ -485,7 +646,7 @@ struct FSpudArray : public FSpudChunk
 	
 };
 
-struct FSpudNamedObjectMap : public FSpudStructMapData<FString /* FName or Guid String */, FSpudNamedObjectData>
+struct FSpudNamedObjectMap : public FSpudStructMapData<FName /* FName or Guid String */, FSpudNamedObjectData>
 {
 	virtual bool RenameObject(const FString& OldName, const FString& NewName);
 };
@@ -501,7 +662,7 @@ struct FSpudLevelActorMap : public FSpudNamedObjectMap
 	virtual const char* GetChildMagic() const override { return SPUDDATA_NAMEDOBJECT_MAGIC; }
 };
 
-struct FSpudSpawnedActorMap : public FSpudStructMapData<FString /*GUID String*/, FSpudSpawnedActorData>
+struct FSpudSpawnedActorMap : public FSpudStructMapData<FGuid, FSpudSpawnedActorData>
 {
 	virtual const char* GetMagic() const override { return SPUDDATA_SPAWNEDACTORLIST_MAGIC; }
 	virtual const char* GetChildMagic() const override { return SPUDDATA_SPAWNEDACTOR_MAGIC; }
@@ -613,6 +774,61 @@ struct FSpudPropertyNameIndex : public FSpudIndex<FString>
 {
 	virtual const char* GetMagic() const override { return SPUDDATA_PROPERTYNAMEINDEX_MAGIC; }
 };
+/// Names of level actors referred to by packed actor references, so each name is only stored once
+struct FSpudActorNameIndex : public FSpudIndex<FString>
+{
+	virtual const char* GetMagic() const override { return SPUDDATA_ACTORNAMEINDEX_MAGIC; }
+};
+
+/**
+ * @brief Save-wide table of class definitions, so that levels don't all have to carry their own copies of the same
+ * class & property names. Each distinct version of a class definition is only held once, and is never changed once
+ * added, so levels written at different times (and therefore possibly with different versions of a class) can all
+ * refer to it by ID. Levels still have their own FSpudClassMetadata in memory; it's only converted to & from shared
+ * references when they're written & read. The table is written into the save after all the levels, and has its own
+ * lock so it can be used by levels being written from any thread.
+ */
+struct SPUD_API FSpudSharedClassTable : public FSpudChunk
+{
+	typedef TSharedPtr<FSpudSharedClassTable, ESPMode::ThreadSafe> Ptr;
+
+	/// Every version of every class definition. Property & prefix IDs are from PropertyNameIndex
+	FSpudClassDefinitions ClassDefinitions;
+	/// Property Name string -> number index, for all the shared definitions
+	FSpudPropertyNameIndex PropertyNameIndex;
+
+	FSpudSharedClassTable();
+
+	virtual const char* GetMagic() const override { return SPUDDATA_SHAREDCLASSES_MAGIC; }
+	virtual void WriteToArchive(FSpudChunkedDataArchive& Ar) override;
+	virtual void ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion) override;
+
+	/**
+	 * @brief Find or add a shared definition identical to each class definition in some level metadata
+	 * @param Meta The level metadata
+	 * @return The shared definition ID for each class ID in Meta
+	 */
+	TArray<uint32> Share(const struct FSpudClassMetadata& Meta);
+	/**
+	 * @brief Rebuild level metadata from shared definitions. Class IDs are the same as when they were shared, but
+	 * property IDs are not necessarily.
+	 * @param DefIDs The shared definition ID for each class ID, as returned by Share
+	 * @param OutMeta The level metadata to populate
+	 * @return Whether all the definitions were found
+	 */
+	bool Unshare(const TArray<uint32>& DefIDs, struct FSpudClassMetadata& OutMeta) const;
+
+	bool IsEmpty() const;
+
+protected:
+	/// Unique per table, so class definitions can remember which shared definition they match
+	uint32 Serial;
+	/// Class name -> IDs of all the versions of that class definition we have
+	TMap<FString, TArray<uint32>> DefsByClassName;
+	mutable FCriticalSection Mutex;
+
+	uint32 FindOrAddDef(const FString& ClassName, const TArray<FSpudPropertyDef>& Properties);
+};
 
 struct SPUD_API FSpudClassMetadata : public FSpudChunk
 {
@@ -623,10 +839,30 @@ struct SPUD_API FSpudClassMetadata : public FSpudChunk
 	FSpudClassNameIndex ClassNameIndex;
 	/// Property Name string -> number index (also used for prefixes, but prefix and property name are separate to help name re-use)
 	FSpudPropertyNameIndex PropertyNameIndex;
+	/// Level actor names referred to by actor reference properties (@see ESST_PackedActorRef). Always per metadata,
+	/// never shared, since it depends on the instances not the classes
+	FSpudActorNameIndex ActorNameIndex;
 
 	/// The user data model version number when this metadata was generated
 	/// @see USpudSubsystem::SetUserDataModelVersion
 	FSpudVersionInfo UserDataModelVersion;
+
+	/// If set, class definitions are written as references into this table rather than in full (and can be read
+	/// either way). Not persisted, and not affected by Reset()
+	FSpudSharedClassTable::Ptr SharedClasses;
+
+protected:
+	/// Runtime class for a class ID, once it's been looked up (@see ResolveClass). Not persisted
+	struct FResolvedClass
+	{
+		TWeakObjectPtr<UClass> Class;
+		/// Looked up, but there's no such class
+		bool bMissing = false;
+	};
+	/// Indexed by class ID
+	mutable TArray<FResolvedClass> ResolvedClasses;
+
+public:
 	
 	virtual const char* GetMagic() const override { return SPUDDATA_METADATA_MAGIC; }
 	virtual void WriteToArchive(FSpudChunkedDataArchive& Ar) override;
@@ -644,6 +880,14 @@ struct SPUD_API FSpudClassMetadata : public FSpudChunk
 	const FString& GetClassNameFromID(uint32 ID) const;
 	uint32 FindOrAddClassIDFromName(const FString& Name);
 	uint32 GetClassIDFromName(const FString& Name) const;
+	/**
+	 * @brief Get the runtime class for a class ID. The result is cached, so a class is only looked up by name (and
+	 * loaded if necessary) the first time. Game thread only.
+	 * @param ClassID The class ID
+	 * @param bLoadIfNeeded If false, only return the class if it's already in memory
+	 * @return The class, or null if there isn't one of that name (or it's not loaded, if bLoadIfNeeded is false)
+	 */
+	UClass* ResolveClass(uint32 ClassID, bool bLoadIfNeeded = true) const;
 	void Reset();
 
 	
@@ -680,6 +924,40 @@ struct SPUD_API FSpudGlobalData : public FSpudChunk
 	uint32 GetUserDataModelVersion() const { return Metadata.GetUserDataModelVersion(); }
 };
 
+// Level data can optionally be compressed, in which case instead of a LEVL chunk it's written as:
+// Header:
+// - MAGIC (char[4]) "LEVZ"
+// - Total Data Length (uint32)
+// Data:
+// - Level Name (FString) - duplicated outside the compressed data so we can identify levels without decompressing
+// - Compression Format (FString) - an FCompression format name
+// - Uncompressed Length (int32)
+// - Compressed Data (uint8 x the rest of the chunk) - the complete LEVL chunk
+// Either form can appear in save games and the level cache, and is piped between them as-is
+/// Where the data for an unloaded level can be found in a save file, when it hasn't been extracted into the level
+/// cache yet (@see FSpudSaveData::ExtractPendingLevelData)
+struct SPUD_API FSpudLevelDataSource
+{
+	FString Filename;
+	/// Offset of the level chunk in the file (from the start of the file, not the save chunk)
+	int64 Offset = 0;
+	/// Total size of the level chunk including header
+	int64 Size = 0;
+	/// If set, the level chunk is held in memory instead (restored from a snapshot), and Filename / Offset aren't used
+	TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe> Memory;
+
+	bool IsSet() const { return !Filename.IsEmpty() || Memory.IsValid(); }
+	bool IsInMemory() const { return Memory.IsValid(); }
+	/// Open a reader positioned at the start of the level chunk, or null if the file can't be opened
+	TUniquePtr<FArchive> CreateReader() const;
+	void Reset()
+	{
+		Filename.Empty();
+		Offset = Size = 0;
+		Memory.Reset();
+	}
+};
+
 struct SPUD_API FSpudLevelData : public FSpudChunk
 {
 	/// Level Name
@@ -702,6 +980,14 @@ struct SPUD_API FSpudLevelData : public FSpudChunk
 
 	/// non-persistent status flag to support placeholder level data which is not currently loaded
 	ELevelDataStatus Status;
+	/// If this level was loaded from a memory mapped file, that file, which actor data may point into
+	TSharedPtr<FSpudMappedFile, ESPMode::ThreadSafe> MappedFile;
+	/// Non-persistent; if set, this level's stored data hasn't been extracted into the level cache yet and is still
+	/// only in the save file (or snapshot) it was loaded from. Cleared once the level cache file is written.
+	FSpudLevelDataSource PendingSource;
+	/// Non-persistent; different every time this level's file in the level cache is written, 0 if we don't know
+	/// what's in it. Lets snapshots tell whether a paged out level has changed since they last read it
+	uint32 CacheFileSerial = 0;
 	/// Mutex for the data in this level. You should lock this before altering any contents because levels can
 	/// be loaded in multiple threads
 	FCriticalSection Mutex;
@@ -711,9 +997,13 @@ struct SPUD_API FSpudLevelData : public FSpudChunk
 	void ReleaseMemory();
 	
 	/// Key value for indexing this item; name is unique
-	FString Key() const { return Name; }
+	FName Key() const { return FName(*Name); }
 
 	FSpudLevelData() {}
+	explicit FSpudLevelData(const FSpudSharedClassTable::Ptr& InSharedClasses)
+	{
+		Metadata.SharedClasses = InSharedClasses;
+	}
 
 	// We need an explicit copy constructor in order to not try to copy the mutex
 	FSpudLevelData(const FSpudLevelData& Other)
@@ -723,7 +1013,10 @@ struct SPUD_API FSpudLevelData : public FSpudChunk
 		  LevelActors(Other.LevelActors),
 		  SpawnedActors(Other.SpawnedActors),
 		  DestroyedActors(Other.DestroyedActors),
-		  Status(Other.Status)
+		  Status(Other.Status),
+		  MappedFile(Other.MappedFile),
+		  PendingSource(Other.PendingSource),
+		  CacheFileSerial(Other.CacheFileSerial)
 	{
 	}
 
@@ -731,16 +1024,34 @@ struct SPUD_API FSpudLevelData : public FSpudChunk
 	virtual void WriteToArchive(FSpudChunkedDataArchive& Ar) override;
 	virtual void ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion) override;
 
-	/// Empty the lists of actors ready to be re-populated
+	/// Empty the lists of actors ready to be re-populated. Existing entries are kept aside so that storing the same
+	/// actors again reuses their buffers; call PostStoreWorld once the level has been stored to drop the rest
 	virtual void PreStoreWorld();
+	/// Release anything kept aside by PreStoreWorld which the store didn't reuse
+	void PostStoreWorld();
+	/// Copy any actor data still pointing into MappedFile into owned buffers, and release the mapping. Must be
+	/// done before anything is stored in this level, or the level file is rewritten
+	void DetachFromMappedFile();
 
 	/// Read just enough of the next level chunk to retrieve the name, then optionally return the read pointer to where it was
 	static bool ReadLevelInfoFromArchive(FSpudChunkedDataArchive& Ar, bool bReturnToStart, FString& OutLevelName, int64& OutDataSize);
+	/// Return whether the next chunk is level data, compressed or not
+	static bool NextChunkIsLevelData(FSpudChunkedDataArchive& Ar);
 
 	void Reset();
 
+	/// Get a new value for CacheFileSerial
+	static uint32 NewCacheFileSerial();
+
 	bool IsUserDataModelOutdated() const { return Metadata.IsUserDataModelOutdated(); }
 	uint32 GetUserDataModelVersion() const { return Metadata.GetUserDataModelVersion(); }
+
+	/// Read a compressed level chunk and decompress it into a complete uncompressed level chunk
+	static bool ReadCompressedFromArchive(FSpudChunkedDataArchive& Ar, TArray<uint8>& OutUncompressedData);
+
+protected:
+	void WriteUncompressedToArchive(FSpudChunkedDataArchive& Ar);
+	void ReadUncompressedFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion);
 };
 
 /// Screenshot chunk
@@ -806,7 +1117,88 @@ struct SPUD_API FSpudSaveInfo : public FSpudChunk
 	void Reset();
 };
 
+/// Cached description of a save file, as held in the save slot index (@see FSpudSaveSlotIndex)
+struct SPUD_API FSpudSaveSlotInfo : public FSpudChunk
+{
+	FString SlotName;
+	FText Title;
+	FDateTime Timestamp;
+	FSpudSaveCustomInfo CustomInfo;
+	/// Whether the save has a screenshot; we don't keep the image itself here, that's read from the save on demand
+	bool bHasScreenshot = false;
+	/// Size of the save file when this was recorded, to detect when it's out of date
+	int64 FileSize = 0;
+	/// Modification time of the save file when this was recorded, to detect when it's out of date
+	FDateTime FileTimestamp;
+
+	FString Key() const { return SlotName; }
+
+	void SetFromSaveInfo(const FSpudSaveInfo& Info);
+
+	virtual const char* GetMagic() const override { return SPUDDATA_SAVESLOTINFO_MAGIC; }
+	virtual void WriteToArchive(FSpudChunkedDataArchive& Ar) override;
+	virtual void ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion) override;
+};
+
+/// A persistent cache of the descriptions of all save files, so listing saves doesn't have to open every one.
+/// It's only ever a cache; entries are checked against the size & modification time of each save and re-read from
+/// the save itself if they don't match, so it doesn't matter if it's deleted or saves are copied in from elsewhere.
+struct SPUD_API FSpudSaveSlotIndex : public FSpudStructMapData<FString, FSpudSaveSlotInfo>
+{
+	virtual const char* GetMagic() const override { return SPUDDATA_SAVESLOTINDEX_MAGIC; }
+	virtual const char* GetChildMagic() const override { return SPUDDATA_SAVESLOTINFO_MAGIC; }
+};
+
+/// Table of contents for the levels in a save file, so they can be found without reading through all of them
+struct SPUD_API FSpudLevelIndex : public FSpudChunk
+{
+	struct FEntry
+	{
+		FString Name;
+		/// Offset of the level chunk relative to the start of the save chunk
+		int64 Offset;
+		/// Total size of the level chunk including header
+		int64 Size;
+	};
+	TArray<FEntry> Entries;
+
+	virtual const char* GetMagic() const override { return SPUDDATA_LEVELINDEX_MAGIC; }
+	virtual void WriteToArchive(FSpudChunkedDataArchive& Ar) override;
+	virtual void ReadFromArchive(FSpudChunkedDataArchive& Ar, uint32 StoredSystemVersion) override;
+};
+
 /// The top-level structure for the entire save file
+/**
+ * @brief An in-memory copy of the complete state of a game, as it would be written to a save file, which can be
+ * restored without going through any files (@see USpudState::CaptureSnapshot). Snapshots never change once captured,
+ * so level data which is the same in several snapshots is shared between them rather than copied.
+ */
+struct SPUD_API FSpudStateSnapshot
+{
+	typedef TSharedPtr<const FSpudStateSnapshot, ESPMode::ThreadSafe> Ptr;
+
+	struct FLevel
+	{
+		FString Name;
+		/// The complete level chunk, compressed or not
+		TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe> Data;
+		/// FSpudLevelData::CacheFileSerial of the level cache file this was read from, 0 if it wasn't
+		uint32 CacheFileSerial = 0;
+	};
+
+	FString Name;
+	/// The save info & global data chunks
+	TArray<uint8> HeaderData;
+	TArray<FLevel> Levels;
+	/// The shared class table the levels refer to. Entries are never changed once added, so it doesn't matter that
+	/// the game carries on adding to it
+	FSpudSharedClassTable::Ptr SharedClasses;
+
+	const FLevel* FindLevel(const FString& LevelName) const;
+	/// Total size of the data, counting level data shared with other snapshots
+	int64 GetDataSize() const;
+};
+
 struct SPUD_API FSpudSaveData : public FSpudChunk
 {
 
@@ -817,9 +1209,16 @@ struct SPUD_API FSpudSaveData : public FSpudChunk
 	// Also we want threadsafe shared ptr for data holder so that we can write it in the background without holding the
 	// lock on the entire map while we do so
 	typedef TSharedPtr<FSpudLevelData, ESPMode::ThreadSafe> TLevelDataPtr;
-	TMap<FString, TLevelDataPtr> LevelDataMap;
-	// Mutex for altering the level data map
-	FCriticalSection LevelDataMapMutex;
+	/// Keyed on FName(LevelName), the string form is only needed for files
+	TMap<FName, TLevelDataPtr> LevelDataMap;
+	// Mutex for altering the level data map. This only ever guards the map itself, and should only be held for as
+	// long as it takes to find / add / remove an entry or take a snapshot; anything that does real work per level
+	// (especially I/O) should take a snapshot & then only hold each level's own lock. Never acquire this while
+	// holding a level lock, since other threads take them in the opposite order.
+	mutable FCriticalSection LevelDataMapMutex;
+	/// Class definitions referenced by level data, shared by all levels of this game (@see FSpudSharedClassTable).
+	/// Levels hold on to the table they were created with, so this is replaced rather than emptied on Reset
+	FSpudSharedClassTable::Ptr SharedClasses = MakeShared<FSpudSharedClassTable, ESPMode::ThreadSafe>();
 
 	virtual const char* GetMagic() const override { return SPUDDATA_SAVEGAME_MAGIC; }
 	void PrepareForWrite();
@@ -837,8 +1236,53 @@ struct SPUD_API FSpudSaveData : public FSpudChunk
 	 * @param Ar Source archive for the entire save file
 	 * @param bLoadAllLevels If true, all levels will be loaded into memory. If false, none will be & data will be split for later loading
 	 * @param LevelPath The parent directory where level chunks should be written as separate files
+	 * @param SourceFilename The file Ar is reading, if it's a file. If provided when not loading all levels and the
+	 * save has a level index, no level data is copied at all; levels are instead read directly from this file
+	 * when needed, until ExtractPendingLevelData has been called.
+	 */
+	virtual void ReadFromArchive(FSpudChunkedDataArchive& Ar, bool bLoadAllLevels, const FString& LevelPath,
+	                             const FString& SourceFilename = FString());
+
+	/**
+	 * @brief Read a save file in stages, splitting all level data out into separate files in LevelPath like
+	 * ReadFromArchive does when not loading all levels. Intended to be called from a background thread.
+	 * The global data is read first, and the level data for the current level of the save is extracted before any
+	 * others, at which point OnInitialDataReady is called (from the calling thread). The remaining levels are
+	 * then extracted before returning. All levels are present in LevelDataMap before OnInitialDataReady is called,
+	 * and each is locked until it has been extracted, so any other thread asking for a level which isn't ready yet
+	 * will simply wait for it.
+	 * @param Ar Source archive for the entire save file
+	 * @param LevelPath The parent directory where level chunks should be written as separate files
+	 * @param OnInitialDataReady Called once global data and the current level data are available
+	 * @param SourceFilename The file Ar is reading, if it's a file. If provided and the save has a level index,
+	 * OnInitialDataReady is called as soon as the global data has been read, and levels needed before they've been
+	 * extracted are read directly from this file instead of waiting.
+	 * @return Whether the data was read; if false, OnInitialDataReady was not called
+	 */
+	virtual bool ReadFromArchiveStaged(FSpudChunkedDataArchive& Ar, const FString& LevelPath, TFunctionRef<void()> OnInitialDataReady,
+	                                   const FString& SourceFilename = FString());
+
+	/**
+	 * @brief Copy the data for all levels which are still only in the save file they were loaded from into the level
+	 * cache. Levels are only locked one at a time, so can still be requested while this is running. Must be completed
+	 * before that save file is overwritten or deleted. Can be called from any thread.
+	 * @param LevelPath The parent directory where level chunks should be written as separate files
+	 */
+	void ExtractPendingLevelData(const FString& LevelPath);
+
+	/**
+	 * @brief Capture everything into an in-memory snapshot. Levels in memory are written out, paged out levels are
+	 * read from wherever their data is, unless an earlier snapshot already has exactly that data.
+	 * @param Name The name to give the snapshot
+	 * @param LevelPath The parent directory where level chunks can be found as separate files
+	 * @param Previous An earlier snapshot of this game to share unchanged level data with, may be null
+	 */
+	FSpudStateSnapshot::Ptr CaptureSnapshot(const FString& Name, const FString& LevelPath, const FSpudStateSnapshot* Previous);
+	/**
+	 * @brief Replace all contents with those of a snapshot. Levels are left unloaded, and read from the snapshot
+	 * rather than the level cache until they're next written.
 	 */
-	virtual void ReadFromArchive(FSpudChunkedDataArchive& Ar, bool bLoadAllLevels, const FString& LevelPath);
+	void RestoreSnapshot(const FSpudStateSnapshot& Snapshot);
 	
 	/**
 	 * @brief Retrieve data for a single level, loading it if necessary. Thread-safe.
@@ -849,6 +1293,18 @@ struct SPUD_API FSpudSaveData : public FSpudChunk
 	 */
 	virtual TLevelDataPtr GetLevelData(const FString& LevelName, bool bLoadIfNeeded, const FString& LevelPath);
 
+	/**
+	 * @brief Retrieve data for a single level, loading it on a background thread if necessary, so the calling thread
+	 * never waits for the disk (or for another thread which has the level locked). Thread-safe.
+	 * @param LevelName The name of the level
+	 * @param LevelPath The parent directory where level chunks can be found as separate files
+	 * @param OnLoaded Optional callback once the data is in memory (or known not to exist). Called on the loading
+	 * thread, or immediately on the calling thread if nothing needed loading
+	 * @return A future for the level data, which is null if not available
+	 */
+	virtual TFuture<TLevelDataPtr> GetLevelDataAsync(const FString& LevelName, const FString& LevelPath,
+	                                                 TFunction<void(TLevelDataPtr)> OnLoaded = nullptr);
+
 	
 	/**
 	 * @brief Create level data for a new level
@@ -872,6 +1328,13 @@ struct SPUD_API FSpudSaveData : public FSpudChunk
 	* @param LevelPath The path in which to write the level data
 	*/
 	virtual void WriteAndReleaseAllLevelData(const FString& LevelPath);
+	/**
+	 * @brief Release the memory for a level which was loaded from the level files and hasn't been changed since (e.g.
+	 * it was only loaded ahead of time in case it was needed), without writing it back. Does nothing if the level is
+	 * in any state other than loaded.
+	 * @param LevelName The name of the level
+	 */
+	virtual void ReleaseUnmodifiedLevelData(const FString& LevelName);
 	/**
 	 * @brief Delete any state associated with a given level, forgetting any saved state for it.
 	 * @param LevelName The name of the level
@@ -887,11 +1350,44 @@ struct SPUD_API FSpudSaveData : public FSpudChunk
 	/// Get the path of the file to use to store state for a specific level
 	static FString GetLevelDataPath(const FString& LevelPath, const FString& LevelName);
 
+	/// Load level data from its file if it's not in memory. Locks the level while doing so
+	static void LoadLevelDataIfNeeded(TLevelDataPtr LevelData, const FString& Filename);
+
 	/// Write Level Data to disk
 	static void WriteLevelData(FSpudLevelData& LevelData, const FString& LevelName, const FString& LevelPath);
 
+	/// Pipe a complete level data chunk from a save game archive, currently positioned at the start of it, into its own file
+	static bool PipeLevelDataToFile(FArchive& Ar, int64 TotalSize, const FString& LevelName, const FString& LevelPath);
+
 	/// Utility method to read an archive just up to the end of the FSpudSaveInfo, and output details
 	static bool ReadSaveInfoFromArchive(FSpudChunkedDataArchive& Ar, FSpudSaveInfo& OutInfo);
+
+	/**
+	 * @brief Utility method to find out whether any part of a save was written with a different user data model
+	 * version, reading as little as possible: just the version in the class metadata of the global data and each
+	 * level, skipping all the object data. Compressed levels have to be decompressed, one at a time.
+	 * @param Ar Archive positioned at the start of the save
+	 * @param bOutOutdated Whether the global data or any level is outdated
+	 * @return Whether the versions could be read. False for saves of older system versions, which have to be loaded
+	 * in full to be upgraded anyway
+	 */
+	static bool ReadIsUserDataModelOutdated(FSpudChunkedDataArchive& Ar, bool& bOutOutdated);
+
+	/**
+	 * @brief Get a copy of the list of all level data entries, in map order. The map lock is only held while
+	 * copying, so the caller can then work through the levels (locking each one as it goes) without holding up
+	 * streaming on other threads. Levels added or removed after this point won't be reflected in the snapshot.
+	 * Thread-safe.
+	 */
+	TArray<TLevelDataPtr> GetLevelDataSnapshot() const;
+
+protected:
+	/// Look up a level without loading it
+	TLevelDataPtr FindLevelData(const FString& LevelName);
+	/// Read the level data map chunk, either loading or piping each level to its own file
+	void ReadLevelDataMap(FSpudChunkedDataArchive& Ar, bool bLoadAllLevels, const FString& LevelPath);
+	/// Write & release a level we already have the entry for
+	bool WriteAndReleaseLevelData(TLevelDataPtr LevelData, const FString& LevelPath, bool bBlocking);
 };
 
 
@@ -0,0 +1,134 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "SpudPropertyUtil.h"
+
+/// The operation needed to store / restore a single entry in a property plan
+/// Most properties can be copied straight from their memory location; anything else falls back on SpudPropertyUtil
+enum class ESpudPlanOp : uint8
+{
+	Bool,
+	UInt8,
+	UInt16,
+	UInt32,
+	UInt64,
+	Int8,
+	Int16,
+	Int32,
+	Int64,
+	Float,
+	Double,
+	String,
+	Name,
+	Enum,
+	Vector,
+	Rotator,
+	Transform,
+	Guid,
+	/// Arrays, actor references, anything else; handled by the general SpudPropertyUtil functions
+	Generic
+};
+
+/// One persistent property of a class, resolved down to where it lives on an instance
+struct SPUD_API FSpudPropertyPlanEntry
+{
+	FProperty* Property = nullptr;
+	/// Byte offset from the root object to the container of this property (non-zero for members of nested structs)
+	int32 ContainerOffset = 0;
+	/// The stored data type, as SpudPropertyUtil::GetPropertyDataType
+	uint16 DataType = ESST_Unknown;
+	ESpudPlanOp Op = ESpudPlanOp::Generic;
+	/// Index into FSpudPropertyPlan::Prefixes for nested struct members, INDEX_NONE at the top level
+	int32 PrefixIndex = INDEX_NONE;
+	int32 Depth = 0;
+};
+
+/**
+ * @brief A flattened, cached list of all the persistent properties of a class, in the same order that
+ * SpudPropertyUtil::VisitPersistentProperties would visit them, including members of nested custom structs.
+ * Storing / restoring an instance with a plan is just a loop over the entries, rather than walking reflection data,
+ * evaluating property flags and casting fields for every property of every instance.
+ *
+ * Plans are built once per class and cached; the cache is invalidated on Blueprint recompile, and plans are also
+ * rebuilt if the class layout has visibly changed since (e.g. after a hot reload).
+ *
+ * Classes which have nested non-actor UObject properties can't use a plan, since what's stored depends on the
+ * instance (whether the nested object exists, and its class). For those, IsValid() is false and the visitor should
+ * be used instead.
+ */
+class SPUD_API FSpudPropertyPlan
+{
+public:
+	typedef TSharedPtr<const FSpudPropertyPlan, ESPMode::ThreadSafe> Ptr;
+
+	/// Unique (per session) identifier for this plan, so dependent caches know when they need rebuilding
+	uint32 Serial = 0;
+	TArray<FSpudPropertyPlanEntry> Entries;
+	/// Full prefix strings of nested structs, as SpudPropertyUtil::GetNestedPrefix would generate them
+	TArray<FString> Prefixes;
+
+	bool IsValid() const { return bValid; }
+
+	/// Get the plan for a class, building it if necessary. Thread safe.
+	static Ptr Get(const UClass* Class);
+	/// Throw away all cached plans, e.g. because classes have been recompiled
+	static void InvalidateAll();
+
+	/**
+	 * @brief Write the properties of an object using this plan. Produces exactly the same data as StorePropertyVisitor.
+	 * @param RootObject The object being stored, which must be of the class this plan was built for
+	 * @param ClassDef The class definition to register properties in
+	 * @param PropertyOffsets The instance offsets to update
+	 * @param Meta The metadata which owns ClassDef
+	 * @param Out The property data writer
+	 */
+	void Store(const UObject* RootObject, FSpudClassDef& ClassDef, TArray<uint32>& PropertyOffsets,
+	           FSpudClassMetadata& Meta, FMemoryWriter& Out) const;
+
+	/**
+	 * @brief Return whether data stored for this class definition can be restored with this plan, which requires the
+	 * stored properties to be exactly the same sequence as the runtime class (@see FSpudClassDef::MatchesRuntimeClass)
+	 */
+	bool CanRestore(const FSpudClassDef& ClassDef, const FSpudClassMetadata& Meta) const;
+	/**
+	 * @brief Read the properties of an object using this plan. Only valid if CanRestore() returned true.
+	 * @param RootObject The object being restored, which must be of the class this plan was built for
+	 * @param ClassDef The stored class definition
+	 * @param Meta The metadata which owns ClassDef
+	 * @param RuntimeObjects Map of runtime objects for resolving references, may be null
+	 * @param In The property data reader
+	 */
+	void Restore(UObject* RootObject, const FSpudClassDef& ClassDef, const FSpudClassMetadata& Meta,
+	             const SpudPropertyUtil::RuntimeObjectMap* RuntimeObjects, FArchive& In) const;
+	/**
+	 * @brief Read the properties of an object using this plan, when the stored class definition does NOT match the
+	 * runtime class (properties added, removed, re-ordered or changed type). Where each entry was stored is worked out
+	 * once per class definition, so this is an indexed walk much like Restore, instead of looking up every property by
+	 * name. Properties which weren't stored are left alone. Only valid if IsValid() is true.
+	 * @param RootObject The object being restored, which must be of the class this plan was built for
+	 * @param ClassDef The stored class definition
+	 * @param Meta The metadata which owns ClassDef
+	 * @param RuntimeObjects Map of runtime objects for resolving references, may be null
+	 * @param PropertyOffsets The instance's offsets of each stored property in its data
+	 * @param In The property data reader
+	 */
+	void RestoreRemapped(UObject* RootObject, const FSpudClassDef& ClassDef, const FSpudClassMetadata& Meta,
+	                     const SpudPropertyUtil::RuntimeObjectMap* RuntimeObjects,
+	                     const TArray<uint32>& PropertyOffsets, FArchive& In) const;
+
+protected:
+	bool bValid = false;
+	const FProperty* PropertyLink = nullptr;
+	int32 PropertiesSize = 0;
+
+	/// Whether this plan still describes Class
+	bool IsUpToDate(const UClass* Class) const;
+	/// Make sure ClassDef has a property index for each of our entries
+	void ResolveClassDef(FSpudClassDef& ClassDef, FSpudClassMetadata& Meta) const;
+	/// Work out which stored property each of our entries corresponds to in a class def which doesn't match
+	void ResolveRemap(const FSpudClassDef& ClassDef, const FSpudClassMetadata& Meta) const;
+
+	static Ptr Build(const UClass* Class);
+	static ESpudPlanOp GetOp(const FProperty* Prop);
+
+	class BuildPlanVisitor;
+};
@@ -167,6 +167,9 @@ public:
 	static bool IsNonActorObjectProperty(const FProperty* Property);
 
 	static uint16 GetPropertyDataType(const FProperty* Prop);
+	/// Whether elements of an array with this inner property can be stored & restored as one block of memory,
+	/// because their serialised form is identical to their in-memory form
+	static bool CanBlockCopyArrayElements(const FProperty* Inner);
 
 	class StoredMatchesRuntimePropertyVisitor : public SpudPropertyUtil::PropertyVisitor
 	{
@@ -192,10 +195,11 @@ public:
 	static FString GetNestedPrefix(uint32 PrefixIDSoFar, FProperty* Prop, const FSpudClassMetadata& Meta);
 	static uint32 GetNestedPrefixID(uint32 PrefixIDSoFar, FProperty* Prop, const FSpudClassMetadata& Meta);
 	static uint32 FindOrAddNestedPrefixID(uint32 PrefixIDSoFar, FProperty* Prop, FSpudClassMetadata& Meta);
-	static void RegisterProperty(uint32 PropNameID, uint32 PrefixID, uint16 DataType, FSpudClassDef& ClassDef, TArray<uint32>& PropertyOffsets, FArchive& Out);
-	static void RegisterProperty(const FString& Name, uint32 PrefixID, uint16 DataType, FSpudClassDef&
+	/// Register a property in a class def & record its offset for this instance. Returns the property index
+	static int RegisterProperty(uint32 PropNameID, uint32 PrefixID, uint16 DataType, FSpudClassDef& ClassDef, TArray<uint32>& PropertyOffsets, FArchive& Out);
+	static int RegisterProperty(const FString& Name, uint32 PrefixID, uint16 DataType, FSpudClassDef&
                           ClassDef, TArray<uint32>& PropertyOffsets, FSpudClassMetadata& Meta, FArchive& Out);
-	static void RegisterProperty(FProperty* Prop, uint32 PrefixID, FSpudClassDef& ClassDef, TArray<uint32>& PropertyOffsets, FSpudClassMetadata
+	static int RegisterProperty(FProperty* Prop, uint32 PrefixID, FSpudClassDef& ClassDef, TArray<uint32>& PropertyOffsets, FSpudClassMetadata
                           & Meta, FArchive& Out);
 
 	/// Visit all properties of a UObject
@@ -208,26 +212,51 @@ public:
                              FSpudClassDef& ClassDef, TArray<uint32>& PropertyOffsets, FSpudClassMetadata& Meta, FMemoryWriter& Out);
 	static void StoreArrayProperty(FArrayProperty* AProp, const UObject* RootObject, uint32 PrefixID,
                                  const void* ContainerPtr, int Depth, FSpudClassDef& ClassDef,
-                                 TArray<uint32>& PropertyOffsets, FSpudClassMetadata& Meta, FMemoryWriter& Out);
+                                 TArray<uint32>& PropertyOffsets, FSpudClassMetadata& Meta, FMemoryWriter& Out,
+                                 int RegisteredIndex = INDEX_NONE);
+	/// If bIsArrayElement is true (or the caller has otherwise registered the property already), RegisteredIndex must
+	/// be the property's index in ClassDef, since that decides how some types are encoded
 	static void StoreContainerProperty(FProperty* Property, const UObject* RootObject,
 	                                   uint32 PrefixID, const void* ContainerPtr, bool bIsArrayElement, int Depth,
-	                                   FSpudClassDef& ClassDef, TArray<uint32>& PropertyOffsets, FSpudClassMetadata& Meta, FMemoryWriter& Out);
+	                                   FSpudClassDef& ClassDef, TArray<uint32>& PropertyOffsets, FSpudClassMetadata& Meta, FMemoryWriter& Out,
+	                                   int RegisteredIndex = INDEX_NONE);
 
 
-	typedef TMap<FGuid, UObject*> RuntimeObjectMap;
+	/// Objects which references being restored can be resolved to
+	struct RuntimeObjectMap
+	{
+		/// Runtime (spawned) objects by their SpudGuid
+		TMap<FGuid, UObject*> ByGuid;
+		/// Actors in the level being restored by name, if built, to avoid finding level actors one at a time.
+		/// Anything not in here is still looked for in the level.
+		TMap<FName, AActor*> LevelActorsByName;
+		/// The level actor for each entry in ActorNameMeta's ActorNameIndex, if resolved (null if not found), so
+		/// packed references to level actors are just an array lookup
+		TArray<AActor*> ActorsByNameIndex;
+		const FSpudClassMetadata* ActorNameMeta = nullptr;
+
+		/// Fill LevelActorsByName with all the actors in a level
+		void AddLevelActors(const ULevel* Level);
+		/// Look up the actors for all the names in Meta's ActorNameIndex, once per restore. Call after AddLevelActors
+		void ResolveActorNames(const FSpudClassMetadata& Meta, ULevel* Level);
+		/// Find a level actor by name, from LevelActorsByName or otherwise in the level
+		static AActor* FindLevelActor(const RuntimeObjectMap* Map, ULevel* Level, const FString& Name);
+		/// Find a level actor by its index in Meta's ActorNameIndex, from ActorsByNameIndex or otherwise by name
+		static AActor* FindLevelActor(const RuntimeObjectMap* Map, ULevel* Level, const FSpudClassMetadata& Meta, uint32 NameIndex);
+	};
 	
 	static void RestoreProperty(UObject* RootObject, FProperty* Property, void* ContainerPtr,
 	                            const FSpudPropertyDef& StoredProperty,
 	                            const RuntimeObjectMap* RuntimeObjects,
-	                            const FSpudClassMetadata& Meta, FMemoryReader& DataIn);
+	                            const FSpudClassMetadata& Meta, FArchive& DataIn);
 	static void RestoreArrayProperty(UObject* RootObject, FArrayProperty* const AProp, void* ContainerPtr,
 	                                 const FSpudPropertyDef& StoredProperty,
 	                                 const RuntimeObjectMap* RuntimeObjects,
-	                                 const FSpudClassMetadata& Meta, FMemoryReader& DataIn);
+	                                 const FSpudClassMetadata& Meta, FArchive& DataIn);
 	static void RestoreContainerProperty(UObject* RootObject, FProperty* const Property,
 	                                     void* ContainerPtr, const FSpudPropertyDef& StoredProperty,
 	                                     const RuntimeObjectMap* RuntimeObjects,
-	                                     const FSpudClassMetadata& Meta, FMemoryReader& DataIn);
+	                                     const FSpudClassMetadata& Meta, FArchive& DataIn);
 
 
 	/// Utility function for checking whether iterating through the properties on a UObject results in the same
@@ -292,15 +321,16 @@ protected:
 	                                     int Depth, FSpudClassDef& ClassDef, TArray<uint32>& PropertyOffsets,
 	                                     FSpudClassMetadata& Meta,
 	                                     FArchive& Out);
-	static FString WriteActorRefPropertyData(FObjectProperty* OProp, AActor* Actor, FPlatformTypes::uint32 PrefixID, const void* Data,
-	                                         bool bIsArrayElement, FSpudClassDef& ClassDef,
-	                                         TArray<uint32>& PropertyOffsets, FSpudClassMetadata& Meta, FArchive& Out);
+	static void WriteActorRefPropertyData(FObjectProperty* OProp, AActor* Actor, FPlatformTypes::uint32 PrefixID, const void* Data,
+	                                      bool bIsArrayElement, FSpudClassDef& ClassDef,
+	                                      TArray<uint32>& PropertyOffsets, FSpudClassMetadata& Meta, FArchive& Out,
+	                                      int RegisteredIndex = INDEX_NONE);
 	static FString WriteNestedUObjectPropertyData(FObjectProperty* OProp, UObject* UObj, FPlatformTypes::uint32 PrefixID, const void* Data,
 											bool bIsArrayElement, FSpudClassDef& ClassDef,
 											TArray<uint32>& PropertyOffsets, FSpudClassMetadata& Meta, FArchive& Out);
 	static bool TryWriteUObjectPropertyData(FProperty* Property, uint32 PrefixID, const void* Data, bool bIsArrayElement,
 	                                       int Depth, FSpudClassDef& ClassDef, TArray<uint32>& PropertyOffsets, FSpudClassMetadata& Meta,
-	                                       FArchive& Out);
+	                                       FArchive& Out, int RegisteredIndex = INDEX_NONE);
 
 	
 	template<typename ValueType>
@@ -380,7 +410,13 @@ protected:
 	static uint16 ReadEnumPropertyData(FEnumProperty* EProp, void* Data, FArchive& In);
 	static bool TryReadEnumPropertyData(FProperty* Prop, void* Data, const FSpudPropertyDef& StoredProperty,
 	                                    FArchive& In);
-	static FString ReadActorRefPropertyData(::FObjectProperty* OProp, void* Data, const RuntimeObjectMap* RuntimeObjects, ULevel* Level, FArchive& In);
+	/// Read an actor reference in whichever encoding StoredProperty says; returns what it was set to, if anything
+	static UObject* ReadActorRefPropertyData(::FObjectProperty* OProp, void* Data, const FSpudPropertyDef& StoredProperty,
+	                                         const RuntimeObjectMap* RuntimeObjects, ULevel* Level,
+	                                         const FSpudClassMetadata& Meta, FArchive& In);
+	/// Read an actor reference written as a string (older data)
+	static UObject* ReadActorRefStringPropertyData(::FObjectProperty* OProp, void* Data, const RuntimeObjectMap* RuntimeObjects,
+	                                               ULevel* Level, FArchive& In);
 	static FString ReadNestedUObjectPropertyData(::FObjectProperty* OProp, void* Data, const RuntimeObjectMap* RuntimeObjects,
 		ULevel* Level, const FSpudClassMetadata& Meta, FArchive& In);
 	static bool TryReadUObjectPropertyData(::FProperty* Prop, void* Data, const ::FSpudPropertyDef& StoredProperty,
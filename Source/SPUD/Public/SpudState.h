@@ -4,6 +4,7 @@
 
 #include "SpudCustomSaveInfo.h"
 #include "SpudData.h"
+#include "SpudPropertyPlan.h"
 #include "SpudPropertyUtil.h"
 
 #include "SpudState.generated.h"
@@ -11,6 +12,10 @@
 
 DECLARE_LOG_CATEGORY_EXTERN(LogSpudState, Verbose, Verbose);
 
+struct FStreamableHandle;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FSpudSaveThumbnailLoaded, class USpudSaveGameInfo*, SaveInfo);
+
 /// Description of a save game for display in load game lists, finding latest
 /// All properties are read-only because they can only be populated via calls to save game
 UCLASS(BlueprintType)
@@ -29,13 +34,35 @@ class SPUD_API USpudSaveGameInfo : public UObject
 	/// The name of the save game slot this refers to
 	UPROPERTY(BlueprintReadOnly)
 	FString SlotName;
-	/// Thumbnail screenshot (may be blank if one wasn't included in the save game)
+	/// Thumbnail screenshot (may be blank if one wasn't included in the save game). Infos from
+	/// USpudSubsystem::GetSaveGameList don't have this until you call LoadThumbnailAsync.
 	UPROPERTY(BlueprintReadOnly)
 	UTexture2D* Thumbnail;
+	/// Whether this save has a thumbnail screenshot, whether or not it's been loaded yet
+	UPROPERTY(BlueprintReadOnly)
+	bool bHasThumbnail;
 	/// Custom fields that you chose to store with the save header information specifically for your game
 	UPROPERTY(BlueprintReadOnly)
 	USpudCustomSaveInfo* CustomInfo;
 
+	/// Event fired when a thumbnail requested with LoadThumbnailAsync is available (Thumbnail may still be null if
+	/// there wasn't one, or it couldn't be read)
+	UPROPERTY(BlueprintAssignable)
+	FSpudSaveThumbnailLoaded OnThumbnailLoaded;
+
+	/// The save file this describes
+	FString Filename;
+
+	/// Read & decode the thumbnail for this save in the background, if it isn't loaded already. Intended for
+	/// save lists, so you only pay for the thumbnails of rows which are actually shown. OnThumbnailLoaded is
+	/// fired when it's done (immediately if it was already loaded).
+	UFUNCTION(BlueprintCallable)
+	void LoadThumbnailAsync();
+
+protected:
+	bool bThumbnailLoadPending = false;
+	
+	static UTexture2D* CreateThumbnailTexture(int32 Width, int32 Height, const TArray<uint8>& BGRAData);
 };
 
 /// Holds the persistent state of a game.
@@ -72,10 +99,58 @@ public:
 	/// Direct access to save data - not recommended but if you really need it...
 	FSpudSaveData SaveData;
 
+	/// Whether StoreLevel keeps existing actor data and skips dirty-tracked actors which haven't changed
+	/// (@see ISpudObject::IsSpudDirtyTracked). Set from USpudSubsystem::bIncrementalLevelStore
+	bool bIncrementalStore = false;
+
+	/// Whether the transforms of actors with non-movable roots are stored, even though they're never restored.
+	/// Set from USpudSubsystem::bStoreNonMovableTransforms
+	bool bStoreNonMovableTransforms = true;
+
+	/// The folder this state pages level data out to while it's in use. If empty, the shared SpudCache folder for
+	/// the active game is used; set this before loading anything into a state which isn't the active game, so that
+	/// they don't trample on each other's level files
+	FString LevelCacheFolder;
+
 protected:
 
 	FString Source;
 
+	/// Dirty-tracked actors which have changed since they were last stored or restored
+	TSet<TWeakObjectPtr<const AActor>> DirtyActors;
+
+	/// The objects passed to ISpudObjectCallback custom data calls, rather than creating one each time. One per level
+	/// of nesting, since a callback can store / restore other objects (@see FCustomDataScope)
+	UPROPERTY(Transient)
+	TArray<USpudStateCustomData*> CustomDataWrappers;
+	/// How many custom data callbacks are in progress
+	int32 CustomDataDepth = 0;
+
+	/// Points a custom data wrapper at an archive for the duration of a custom data callback, and releases it when
+	/// it goes out of scope, without affecting any callback it's nested in. Game thread only
+	struct FCustomDataScope
+	{
+		USpudState& State;
+		USpudStateCustomData* Wrapper;
+
+		FCustomDataScope(USpudState& InState, FArchive* Ar);
+		~FCustomDataScope();
+	};
+
+	/// An actor whose entry & core data have been stored, but whose property data is to be encoded later, off the
+	/// game thread (@see StoreLevels)
+	struct FDeferredPropertyStore
+	{
+		const AActor* Actor;
+		FSpudPropertyPlan::Ptr Plan;
+		FString ClassName;
+		/// Key in LevelActors (level actors)
+		FName Name;
+		/// Key in SpawnedActors (runtime spawned actors)
+		FGuid Guid;
+		bool bRespawn;
+	};
+
 	void WriteCoreActorData(AActor* Actor, FArchive& Out) const;
 
 	class StorePropertyVisitor : public SpudPropertyUtil::PropertyVisitor
@@ -100,6 +175,10 @@ protected:
 			UObject* NestedObject) override;
 	};
 
+	/// Write the SaveGame properties of an object, using a property plan where possible, StorePropertyVisitor otherwise
+	void StoreObjectProperties(UObject* Obj, FSpudClassDef& ClassDef, TArray<uint32>& PropertyOffsets,
+	                           FSpudClassMetadata& Meta, FMemoryWriter& Out);
+
 	FSpudSaveData::TLevelDataPtr GetLevelData(const FString& LevelName, bool AutoCreate);
 	FSpudNamedObjectData* GetLevelActorData(const AActor* Actor, FSpudSaveData::TLevelDataPtr LevelData, bool AutoCreate);
 	FSpudSpawnedActorData* GetSpawnedActorData(AActor* Actor, FSpudSaveData::TLevelDataPtr LevelData, bool AutoCreate);
@@ -107,10 +186,110 @@ protected:
 	FSpudNamedObjectData* GetGlobalObjectData(const FString& ID, bool AutoCreate);
 
 	bool ShouldActorBeRespawnedOnRestore(AActor* Actor) const;
-	void StoreActor(AActor* Actor, FSpudSaveData::TLevelDataPtr LevelData);
+	/// Store all the actors in a level (LevelData must be locked). If Deferred is non-null, property data for actors
+	/// which can be encoded without calling into them is added there instead of being stored immediately
+	void StoreLevelActors(ULevel* Level, FSpudSaveData::TLevelDataPtr LevelData, TArray<FDeferredPropertyStore>* Deferred);
+
+	/// A level store in progress, which can be advanced a bit at a time (@see StoreLevelTimeSliced)
+	struct FLevelStoreJob
+	{
+		TWeakObjectPtr<ULevel> Level;
+		FString LevelName;
+		/// Keep existing data for unchanged, dirty-tracked actors (@see bIncrementalStore)
+		bool bIncremental = false;
+		/// Whether this is spread over several frames, so actors can come & go before it's finished
+		bool bTimeSliced = false;
+		bool bReleaseAfter = false;
+		/// Persistent actors in the level when the store started
+		TArray<TWeakObjectPtr<AActor>> Actors;
+		int32 NextIndex = 0;
+		int32 NumSkipped = 0;
+		TFunction<void(bool)> OnComplete;
+	};
+
+	/// Time sliced stores which haven't finished yet, in the order they were requested
+	TArray<TSharedPtr<FLevelStoreJob>> PendingStoreJobs;
+
+	/// Prepare level data for a store & take the list of actors to store. LevelData must be locked.
+	void BeginLevelStore(FLevelStoreJob& Job, ULevel* Level, FSpudSaveData::TLevelDataPtr LevelData);
+	/// Store actors until they're all done or FPlatformTime::Seconds() passes Deadline; returns whether they're all done.
+	/// LevelData must be locked.
+	bool StepLevelStore(FLevelStoreJob& Job, FSpudSaveData::TLevelDataPtr LevelData, double Deadline, TArray<FDeferredPropertyStore>* Deferred);
+	/// Tidy up once all actors are stored: store any new actors and remove data for actors which no longer exist,
+	/// as necessary. LevelData must be locked.
+	void FinishLevelStore(FLevelStoreJob& Job, ULevel* Level, FSpudSaveData::TLevelDataPtr LevelData, TArray<FDeferredPropertyStore>* Deferred);
+	/// Store a single actor as part of a level store
+	void StoreLevelStoreActor(FLevelStoreJob& Job, AActor* Actor, FSpudSaveData::TLevelDataPtr LevelData, TArray<FDeferredPropertyStore>* Deferred);
+	/// Advance a pending time sliced store; returns whether it is finished (successfully or not)
+	bool StepPendingStore(FLevelStoreJob& Job, double Deadline, bool& bOutSuccess);
+	/// Called once a time sliced store is finished and no longer in PendingStoreJobs
+	void FinishPendingStore(FLevelStoreJob& Job, bool bSuccess);
+	/// Whether an actor is dirty tracked, unchanged since it was stored, and has data in the level already
+	bool CanSkipIncrementalStore(AActor* Actor, bool bRespawn, FSpudSaveData::TLevelDataPtr LevelData) const;
+	void StoreActor(AActor* Actor, FSpudSaveData::TLevelDataPtr LevelData, TArray<FDeferredPropertyStore>* Deferred = nullptr);
+	/// Encode deferred property data; safe to call on any thread provided the game thread isn't changing the actor
+	static void StoreDeferredProperties(const FDeferredPropertyStore& Deferred, FSpudSaveData::TLevelDataPtr LevelData);
 	void StoreLevelActorDestroyed(AActor* Actor, FSpudSaveData::TLevelDataPtr LevelData);
 	void StoreGlobalObject(UObject* Obj, FSpudNamedObjectData* Data);
 
+	/// A level restore in progress, which can be advanced a bit at a time (@see RestoreLevelTimeSliced)
+	struct FLevelRestoreJob
+	{
+		enum class EPhase : uint8
+		{
+			/// Respawning runtime actors; always completes before any actor is restored so cross-references work 
+			Respawn,
+			/// Restoring the state of persistent actors in the level, including those respawned
+			RestoreActors,
+			/// Destroying level actors which were destroyed when the level was stored
+			DestroyActors,
+			Done
+		};
+
+		TWeakObjectPtr<ULevel> Level;
+		FString LevelName;
+		EPhase Phase = EPhase::Respawn;
+		/// Position in the current phase
+		int32 NextIndex = 0;
+		/// Keys of SpawnedActors at the start, so we can carry on iterating across frames
+		TArray<FGuid> SpawnedActorGuids;
+		/// Level->Actors at the end of the respawn phase
+		TArray<TWeakObjectPtr<AActor>> Actors;
+		/// Respawned actors, and level actors by name, resolved once for the whole level.
+		/// Referenced in AddReferencedObjects while the job is pending
+		SpudPropertyUtil::RuntimeObjectMap RuntimeObjects;
+		TFunction<void(bool)> OnComplete;
+	};
+
+	/// Time sliced restores which haven't finished yet, in the order they were requested
+	TArray<TSharedPtr<FLevelRestoreJob>> PendingRestoreJobs;
+
+	/**
+	 * @brief Advance a level restore until it's done or the time is up. LevelData must be locked.
+	 * @param Job The restore to advance
+	 * @param LevelData Data for the level being restored
+	 * @param Deadline Value of FPlatformTime::Seconds() after which to stop. Always makes some progress, however small.
+	 * @return Whether the restore is done
+	 */
+	bool StepLevelRestore(FLevelRestoreJob& Job, FSpudSaveData::TLevelDataPtr LevelData, double Deadline);
+	/// Advance a pending time sliced restore; returns whether it is finished (successfully or not)
+	bool StepPendingRestore(FLevelRestoreJob& Job, double Deadline, bool& bOutSuccess);
+	/// Called once a time sliced restore is finished and no longer in PendingRestoreJobs
+	void FinishPendingRestore(FLevelRestoreJob& Job, bool bSuccess);
+
+	/// Classes being loaded in the background ahead of restoring a level (@see PreloadSpawnedActorClassesAsync)
+	struct FClassPreload
+	{
+		/// Keeps the classes loaded until the level has been restored
+		TSharedPtr<FStreamableHandle> Handle;
+		/// Callbacks waiting for the classes to load
+		TArray<TFunction<void()>> OnLoaded;
+	};
+	/// Class preloads by level name
+	TMap<FString, TSharedPtr<FClassPreload>> ClassPreloads;
+	/// Stop keeping preloaded classes for a level in memory, once they're no longer needed
+	void ReleaseClassPreload(const FString& LevelName);
+
 	// Actually restores the world, on the assumption that it's already loaded into the correct map
 	void RestoreLoadedWorld(UWorld* World, bool bSingleLevel, const FString& OnlyLevelName = "");
 	// Returns whether this is an actor which is not technically in a level, but is auto-created so doesn't need to be
@@ -118,19 +297,19 @@ protected:
 	bool ShouldRespawnRuntimeActor(const AActor* Actor) const;
 	void PreRestoreObject(UObject* Obj, uint32 StoredUserVersion);
 	void PostRestoreObject(UObject* Obj, const FSpudCustomData& FromCustomData, uint32 StoredUserVersion);
-	void RestoreActor(AActor* Actor, FSpudSaveData::TLevelDataPtr LevelData, const TMap<FGuid, UObject*>* RuntimeObjects);
+	void RestoreActor(AActor* Actor, FSpudSaveData::TLevelDataPtr LevelData, const SpudPropertyUtil::RuntimeObjectMap* RuntimeObjects);
 	void RestoreGlobalObject(UObject* Obj, const FSpudNamedObjectData* Data);
 	AActor* RespawnActor(const FSpudSpawnedActorData& SpawnedActor, const FSpudClassMetadata& Meta, ULevel* Level);
-	void DestroyActor(const FSpudDestroyedLevelActor& DestroyedActor, ULevel* Level);
+	void DestroyActor(const FSpudDestroyedLevelActor& DestroyedActor, ULevel* Level, const SpudPropertyUtil::RuntimeObjectMap* RuntimeObjects = nullptr);
 	void RestoreCoreActorData(AActor* Actor, const FSpudCoreActorData& FromData);
 	void RestoreObjectProperties(UObject* Obj, const FSpudPropertyData& FromData, const FSpudClassMetadata& Meta,
-	                             const TMap<FGuid, UObject*>* RuntimeObjects);
+	                             const SpudPropertyUtil::RuntimeObjectMap* RuntimeObjects);
 	void RestoreObjectPropertiesFast(UObject* Obj, const FSpudPropertyData& FromData,
 	                                 const FSpudClassMetadata& Meta, const FSpudClassDef*
-	                                 ClassDef, const TMap<FGuid, UObject*>* RuntimeObjects);
+	                                 ClassDef, const SpudPropertyUtil::RuntimeObjectMap* RuntimeObjects);
 	void RestoreObjectPropertiesSlow(UObject* Obj, const FSpudPropertyData& FromData,
 	                                 const FSpudClassMetadata& Meta,
-	                                 const FSpudClassDef* ClassDef, const TMap<FGuid, UObject*>* RuntimeObjects);
+	                                 const FSpudClassDef* ClassDef, const SpudPropertyUtil::RuntimeObjectMap* RuntimeObjects);
 
 	class RestorePropertyVisitor : public SpudPropertyUtil::PropertyVisitor
 	{
@@ -138,10 +317,10 @@ protected:
 		USpudState* ParentState; // weak but ok since used in scope
 		const FSpudClassDef& ClassDef;
 		const FSpudClassMetadata& Meta;
-		const TMap<FGuid, UObject*>* RuntimeObjects;
-		FMemoryReader& DataIn;
+		const SpudPropertyUtil::RuntimeObjectMap* RuntimeObjects;
+		FArchive& DataIn;
 	public:
-		RestorePropertyVisitor(USpudState* Parent, FMemoryReader& InDataIn, const FSpudClassDef& InClassDef, const FSpudClassMetadata& InMeta, const TMap<FGuid, UObject*>* InRuntimeObjects):
+		RestorePropertyVisitor(USpudState* Parent, FArchive& InDataIn, const FSpudClassDef& InClassDef, const FSpudClassMetadata& InMeta, const SpudPropertyUtil::RuntimeObjectMap* InRuntimeObjects):
 			ParentState(Parent), ClassDef(InClassDef), Meta(InMeta), RuntimeObjects(InRuntimeObjects), DataIn(InDataIn) {}
 
 		virtual uint32 GetNestedPrefix(FProperty* Prop, uint32 CurrentPrefixID) override;
@@ -159,8 +338,8 @@ protected:
 		TArray<FSpudPropertyDef>::TConstIterator StoredPropertyIterator;
 	public:
 		RestoreFastPropertyVisitor(USpudState* Parent, const TArray<FSpudPropertyDef>::TConstIterator& InStoredPropertyIterator,
-		                           FMemoryReader& InDataIn, const FSpudClassDef& InClassDef,
-		                           const FSpudClassMetadata& InMeta, const TMap<FGuid, UObject*>* InRuntimeObjects)
+		                           FArchive& InDataIn, const FSpudClassDef& InClassDef,
+		                           const FSpudClassMetadata& InMeta, const SpudPropertyUtil::RuntimeObjectMap* InRuntimeObjects)
 			: RestorePropertyVisitor(Parent, InDataIn, InClassDef, InMeta, InRuntimeObjects),
 			  StoredPropertyIterator(InStoredPropertyIterator)
 		{
@@ -170,12 +349,15 @@ protected:
 		                           void* ContainerPtr, int Depth) override;
 	};
 	
-	// Slow path restoration when runtime class is the same as stored class
+	// Slow path restoration when runtime class is different to the stored class, and it can't use a property plan
 	class RestoreSlowPropertyVisitor : public RestorePropertyVisitor
 	{
+	protected:
+		/// Where each stored property is in DataIn, since they're not in runtime order
+		const TArray<uint32>& PropertyOffsets;
 	public:
-		RestoreSlowPropertyVisitor(USpudState* Parent, FMemoryReader& InDataIn, const FSpudClassDef& InClassDef, const FSpudClassMetadata& InMeta, const TMap<FGuid, UObject*>* InRuntimeObjects)
-			: RestorePropertyVisitor(Parent, InDataIn, InClassDef, InMeta, InRuntimeObjects) {}
+		RestoreSlowPropertyVisitor(USpudState* Parent, FArchive& InDataIn, const FSpudClassDef& InClassDef, const FSpudClassMetadata& InMeta, const SpudPropertyUtil::RuntimeObjectMap* InRuntimeObjects, const TArray<uint32>& InPropertyOffsets)
+			: RestorePropertyVisitor(Parent, InDataIn, InClassDef, InMeta, InRuntimeObjects), PropertyOffsets(InPropertyOffsets) {}
 
 		virtual bool VisitProperty(UObject* RootObject, FProperty* Property, uint32 CurrentPrefixID,
 		                           void* ContainerPtr, int Depth) override;
@@ -189,6 +371,11 @@ protected:
 	/// Purge the active game's level data on disk, ready for a new game or loaded game.	
 	void RemoveAllActiveGameLevelFiles();
 
+	/// Change the class metadata of a level, loading it just for the duration if it isn't already loaded (in which
+	/// case it's written back out straight away if changed). That way changes to all levels, e.g. when upgrading a
+	/// save, only ever need one level in memory at a time. Returns whether anything changed.
+	bool ModifyLevelMetadata(FSpudSaveData::TLevelDataPtr LevelData, TFunctionRef<bool(FSpudClassMetadata&)> Modifier);
+
 public:
 
 	static FString GetLevelName(const ULevel* Level);
@@ -196,6 +383,8 @@ public:
 
 	USpudState();
 
+	static void AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector);
+
 	/// Clears all state
 	void ResetState();
 
@@ -211,6 +400,51 @@ public:
 	 */
 	void StoreLevel(ULevel* Level, bool bReleaseAfter, bool bBlocking);
 
+	/**
+	 * @brief Store the state of several levels at once. The same as calling StoreLevel for each, except that once
+	 * everything which needs the game thread has been gathered, the property data for the levels is encoded in
+	 * parallel on worker threads.
+	 * @param Levels The levels to store
+	 * @param bReleaseAfter If true, after storing the level data, it is removed from memory and stored on disk
+	 * @param bBlocking If true, do not perform the write in a background thread and write before returning
+	 */
+	void StoreLevels(const TArray<ULevel*>& Levels, bool bReleaseAfter, bool bBlocking);
+
+	/**
+	 * @brief The same as StoreLevel, except that actors are stored a few at a time, so that storing a level with a lot
+	 * of actors doesn't cause a hitch. Nothing happens until you call TickTimeSlicedStores. Actors which appear or
+	 * disappear while the store is in progress are accounted for when it finishes, but actors can change in between
+	 * being stored, so this is intended for levels which are about to be unloaded.
+	 * Storing the level any other way (e.g. saving the game) cancels this.
+	 * @param Level The level to store
+	 * @param bReleaseAfter If true, once the store is finished, the level data is written in the background and
+	 * removed from memory
+	 * @param OnComplete Called on the game thread once the store is finished, with whether it completed (it won't if
+	 * it was cancelled, or the level went away)
+	 */
+	void StoreLevelTimeSliced(ULevel* Level, bool bReleaseAfter, TFunction<void(bool)> OnComplete = nullptr);
+
+	/// Advance time sliced stores queued by StoreLevelTimeSliced, oldest first, until they're all done or
+	/// TimeBudgetSeconds have passed. Call once a frame.
+	void TickTimeSlicedStores(double TimeBudgetSeconds);
+
+	/// Whether there are any time sliced stores which are still in progress
+	bool HasPendingStores() const { return PendingStoreJobs.Num() > 0; }
+
+	/// Abandon any time sliced store in progress for a level; its completion callback is called with false.
+	/// Actors stored so far have their new data and the rest keep what they had before the store started; data for
+	/// actors which have gone since isn't removed until the level is next stored.
+	void CancelPendingStore(const FString& LevelName);
+
+	/// Abandon all time sliced stores in progress; their completion callbacks are called with false
+	void CancelAllPendingStores();
+
+	/// Mark an actor as having changed since it was last stored. Only relevant for actors which are dirty tracked
+	/// (@see ISpudObject::IsSpudDirtyTracked) when bIncrementalStore is enabled
+	void MarkActorDirty(const AActor* Actor);
+	/// Return whether an actor has been marked dirty since it was last stored or restored
+	bool IsActorDirty(const AActor* Actor) const;
+
 	/// Store the state of an actor. Does not require the object to implement ISpudObject
 	/// This object will be associated with its level, and so will only be restored when its level is loaded.
 	/// Will page in the level data concerned from disk if necessary and will retain it in memory
@@ -249,6 +483,61 @@ public:
 	/// Useful for pre-caching before RestoreLevel
 	bool PreLoadLevelData(const FString& LevelName);
 
+	/// Request that data for a level is loaded in a background thread. OnLoaded is called on the game thread once it's
+	/// in memory (or there turns out to be none), so a RestoreLevel from there won't have to wait for the disk.
+	/// If the data is already loaded, OnLoaded is called immediately.
+	void PreLoadLevelDataAsync(const FString& LevelName, TFunction<void()> OnLoaded);
+
+	/**
+	 * @brief Load the classes of all the runtime spawned actors in a level's data in the background, so that respawning
+	 * them doesn't have to load classes synchronously in the middle of a restore. The level data must already be
+	 * loaded (e.g. by PreLoadLevelDataAsync), otherwise there's nothing to do. Preloaded classes are kept in memory
+	 * until the level has been restored. Game thread only.
+	 * @param LevelName The level whose classes should be loaded
+	 * @param OnLoaded Called on the game thread when the classes are loaded (immediately if they already were)
+	 */
+	void PreloadSpawnedActorClassesAsync(const FString& LevelName, TFunction<void()> OnLoaded = nullptr);
+
+	/// The same as RestoreLevel(ULevel*), except that the level data is loaded in the background first, and the
+	/// restore happens later on the game thread. OnComplete is called after that with whether the restore happened
+	/// (it won't if the level has gone away in the meantime).
+	void RestoreLevelAsync(ULevel* Level, TFunction<void(bool)> OnComplete = nullptr);
+
+	/**
+	 * @brief The same as RestoreLevel(ULevel*), except that the work is spread across frames so that restoring a
+	 * level with a lot of actors doesn't cause a hitch. Nothing happens until you call TickTimeSlicedRestores.
+	 * Runtime actors are all respawned before any actor is restored, and destroyed actors are removed last, the same
+	 * as RestoreLevel. The level must not be stored until this is complete; StoreLevel will finish it first if so.
+	 * @param Level The level to restore
+	 * @param OnComplete Called (on the game thread) once the restore is finished, with whether it happened (it won't
+	 * if the level or its data has gone away in the meantime).
+	 */
+	void RestoreLevelTimeSliced(ULevel* Level, TFunction<void(bool)> OnComplete = nullptr);
+
+	/// Advance time sliced restores queued by RestoreLevelTimeSliced, oldest first, until they're all done or
+	/// TimeBudgetSeconds have passed. Call once a frame.
+	void TickTimeSlicedRestores(double TimeBudgetSeconds);
+
+	/// Whether there are any time sliced restores which are still in progress
+	bool HasPendingRestores() const { return PendingRestoreJobs.Num() > 0; }
+
+	/// Finish any time sliced restore in progress for a level right now
+	void CompletePendingRestore(const FString& LevelName);
+
+	/// Finish all time sliced restores in progress right now
+	void CompleteAllPendingRestores();
+
+	/// Abandon all time sliced restores in progress; their completion callbacks are called with false
+	void CancelAllPendingRestores();
+
+	/// If there is data for a level which isn't loaded, return the size of it in the level cache, otherwise 0.
+	/// Doesn't block; a level which is busy (e.g. still being extracted from a save game) also returns 0
+	int64 GetUnloadedLevelDataSize(const FString& LevelName);
+
+	/// Release the memory for a level's data which has been loaded (e.g. by PreLoadLevelData) but not changed since,
+	/// without the cost of writing it back to the level cache
+	void ReleaseUnmodifiedLevelData(const FString& LevelName);
+
 	// Restores the world and all levels currently in it, on the assumption that it's already loaded into the correct map
 	void RestoreLoadedWorld(UWorld* World);
 
@@ -282,8 +571,48 @@ public:
 	 * @param Ar The save file archive
 	 * @param bFullyLoadAllLevelData If true, load all data into memory including all data for all levels. If false,
 	 * only load global data and enumerate levels, piping level data to separate disk files instead for loading individually later
+	 * @param SourceFilename If Ar is reading a file, that file. Saves with a level index then don't need to have
+	 * any level data copied at load time, it's read from this file when needed; call ExtractPendingLevelData
+	 * (e.g. in the background) to finish copying it before the file can be changed.
+	 */
+	virtual void LoadFromArchive(FArchive& Ar, bool bFullyLoadAllLevelData, const FString& SourceFilename = FString());
+
+	/**
+	 * @brief Load from an archive in stages, piping level data to separate disk files like LoadFromArchive does when
+	 * not fully loading. Designed to be called from a background thread.
+	 * @param Ar The save file archive
+	 * @param OnInitialDataReady Called on the calling thread as soon as the global data and the data for the
+	 * persistent level of the save are available. Other levels continue to be extracted after this; requesting one
+	 * of those before it's ready will block until it is.
+	 * @param SourceFilename If Ar is reading a file, that file. For saves with a level index, this means
+	 * OnInitialDataReady is called straight after the global data is read, and no level ever has to wait for extraction.
+	 * @return Whether the load succeeded. If false, OnInitialDataReady will not have been called.
+	 */
+	virtual bool LoadFromArchiveStaged(FArchive& Ar, TFunctionRef<void()> OnInitialDataReady, const FString& SourceFilename = FString());
+
+	/// Copy any level data which is still only in the save file it was loaded from into the level cache.
+	/// Blocking, but can be called from a background thread.
+	void ExtractPendingLevelData();
+
+	/**
+	 * @brief Capture this state into an in-memory snapshot, which has everything a save game written now would.
+	 * Like SaveToArchive, this doesn't store the world first (USpudSubsystem::CaptureSnapshot does).
+	 * @param Name The name of the snapshot
+	 * @param Previous An earlier snapshot of this state, which paged out levels that haven't changed since can share
+	 * data with rather than reading it again. May be null
+	 */
+	FSpudStateSnapshot::Ptr CaptureSnapshot(const FString& Name, const FSpudStateSnapshot* Previous = nullptr);
+	/// Replace this state with a snapshot, without reading any files. Like LoadFromArchive, you then need to restore
+	/// the world from it
+	void RestoreSnapshot(const FSpudStateSnapshot& Snapshot);
+	/**
+	 * @brief Write a snapshot as a save game, exactly as SaveToArchive would have when it was captured. Doesn't
+	 * involve any state, so it can be called from any thread
+	 * @param Snapshot The snapshot to write
+	 * @param Ar The save file archive
+	 * @param Title If not empty, the title to give the save instead of the one the state had
 	 */
-	virtual void LoadFromArchive(FArchive& Ar, bool bFullyLoadAllLevelData);
+	static void WriteSnapshotToArchive(const FSpudStateSnapshot& Snapshot, FArchive& Ar, const FText& Title = FText());
 
 	/// Get the name of the persistent level which the player is on in this state
 	FString GetPersistentLevel() const { return SaveData.GlobalData.CurrentLevel; }
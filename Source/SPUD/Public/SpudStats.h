@@ -0,0 +1,194 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+
+#include "SpudStats.generated.h"
+
+// Instrumentation for SPUD. Timings show up in "stat SPUD", Unreal Insights (CPU channel) and CSV profiles
+// (category "Spud"), and the counters are also available per operation as FSpudOperationMetrics, via
+// USpudSubsystem::GetLastOperationMetrics / PostOperationMetrics
+
+DECLARE_STATS_GROUP(TEXT("SPUD"), STATGROUP_Spud, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Store Level"), STAT_SpudStoreLevel, STATGROUP_Spud, SPUD_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Store Actor"), STAT_SpudStoreActor, STATGROUP_Spud, SPUD_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Store Deferred Properties"), STAT_SpudStoreDeferredProperties, STATGROUP_Spud, SPUD_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Restore Level"), STAT_SpudRestoreLevel, STATGROUP_Spud, SPUD_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Respawn Actor"), STAT_SpudRespawnActor, STATGROUP_Spud, SPUD_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Restore Actor"), STAT_SpudRestoreActor, STATGROUP_Spud, SPUD_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Restore Properties Fast Path"), STAT_SpudRestoreFastPath, STATGROUP_Spud, SPUD_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Restore Properties Slow Path"), STAT_SpudRestoreSlowPath, STATGROUP_Spud, SPUD_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Write Save Game"), STAT_SpudWriteSaveGame, STATGROUP_Spud, SPUD_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Read Save Game"), STAT_SpudReadSaveGame, STATGROUP_Spud, SPUD_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Load Level Data"), STAT_SpudLoadLevelData, STATGROUP_Spud, SPUD_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Write Level Data"), STAT_SpudWriteLevelData, STATGROUP_Spud, SPUD_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Pipe Level Data"), STAT_SpudPipeLevelData, STATGROUP_Spud, SPUD_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Parse Level Data"), STAT_SpudParseLevelData, STATGROUP_Spud, SPUD_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Capture Snapshot"), STAT_SpudCaptureSnapshot, STATGROUP_Spud, SPUD_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Encode Screenshot"), STAT_SpudEncodeScreenshot, STATGROUP_Spud, SPUD_API);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Actors Stored"), STAT_SpudActorsStored, STATGROUP_Spud, SPUD_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Actors Restored"), STAT_SpudActorsRestored, STATGROUP_Spud, SPUD_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Fast Path Restores"), STAT_SpudFastPathRestores, STATGROUP_Spud, SPUD_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Slow Path Restores"), STAT_SpudSlowPathRestores, STATGROUP_Spud, SPUD_API);
+DECLARE_QWORD_COUNTER_STAT_EXTERN(TEXT("Bytes Read"), STAT_SpudBytesRead, STATGROUP_Spud, SPUD_API);
+DECLARE_QWORD_COUNTER_STAT_EXTERN(TEXT("Bytes Written"), STAT_SpudBytesWritten, STATGROUP_Spud, SPUD_API);
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Lock Wait (ms)"), STAT_SpudLockWaitMs, STATGROUP_Spud, SPUD_API);
+
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(SPUD_API, Spud);
+
+/// Time a scope in stats, Insights & CSV profiles, e.g. SPUD_SCOPED_STAT(StoreLevel) for STAT_SpudStoreLevel
+#define SPUD_SCOPED_STAT(Name) \
+	SCOPE_CYCLE_COUNTER(STAT_Spud##Name); \
+	TRACE_CPUPROFILER_EVENT_SCOPE(Spud_##Name); \
+	CSV_SCOPED_TIMING_STAT(Spud, Name)
+
+/// Add to a counter, e.g. SPUD_COUNT(ActorsStored, 1) for STAT_SpudActorsStored & ESpudCounter::ActorsStored
+#define SPUD_COUNT(Name, Amount) \
+	do { \
+		const int64 SpudCountAmount = (Amount); \
+		INC_DWORD_STAT_BY(STAT_Spud##Name, SpudCountAmount); \
+		CSV_CUSTOM_STAT(Spud, Name, static_cast<int32>(SpudCountAmount), ECsvCustomStatOp::Accumulate); \
+		FSpudMetrics::Add(ESpudCounter::Name, SpudCountAmount); \
+	} while (0)
+
+/// Add a number of bytes to BytesRead / BytesWritten. Those are 64-bit stats; CSV stats are only 32-bit, so those
+/// are clamped
+#define SPUD_COUNT_BYTES(Name, Amount) \
+	do { \
+		const int64 SpudCountAmount = (Amount); \
+		INC_QWORD_STAT_BY(STAT_Spud##Name, SpudCountAmount); \
+		CSV_CUSTOM_STAT(Spud, Name, static_cast<int32>(FMath::Min<int64>(SpudCountAmount, MAX_int32)), ECsvCustomStatOp::Accumulate); \
+		FSpudMetrics::Add(ESpudCounter::Name, SpudCountAmount); \
+	} while (0)
+
+/// Running totals kept by FSpudMetrics
+enum class ESpudCounter : uint8
+{
+	ActorsStored,
+	ActorsRestored,
+	FastPathRestores,
+	SlowPathRestores,
+	BytesRead,
+	BytesWritten,
+	LockWaitCycles,
+	Num
+};
+
+/// Process-wide running totals of the SPUD counters, so we can tell how much work an operation did by comparing
+/// them before and after. Thread safe.
+class SPUD_API FSpudMetrics
+{
+public:
+	struct FSnapshot
+	{
+		int64 Values[static_cast<int32>(ESpudCounter::Num)];
+		uint64 Cycles;
+
+		int64 Get(ESpudCounter Counter) const { return Values[static_cast<int32>(Counter)]; }
+	};
+
+	static void Add(ESpudCounter Counter, int64 Amount)
+	{
+		Counters[static_cast<int32>(Counter)] += Amount;
+	}
+
+	static FSnapshot Snapshot();
+
+protected:
+	static TAtomic<int64> Counters[static_cast<int32>(ESpudCounter::Num)];
+};
+
+/// The same as FScopeLock, except that time spent waiting for the lock is recorded (STAT_SpudLockWaitMs)
+class SPUD_API FSpudScopeLock
+{
+public:
+	explicit FSpudScopeLock(FCriticalSection* InSection)
+		: Section(InSection)
+	{
+		// Uncontended locks are the norm, so only time them if we have to wait
+		if (!Section->TryLock())
+		{
+			const uint64 Start = FPlatformTime::Cycles64();
+			Section->Lock();
+			const uint64 Waited = FPlatformTime::Cycles64() - Start;
+			INC_FLOAT_STAT_BY(STAT_SpudLockWaitMs, FPlatformTime::ToMilliseconds64(Waited));
+			FSpudMetrics::Add(ESpudCounter::LockWaitCycles, Waited);
+		}
+	}
+
+	~FSpudScopeLock()
+	{
+		Section->Unlock();
+	}
+
+private:
+	FCriticalSection* Section;
+
+	FSpudScopeLock(const FSpudScopeLock&) = delete;
+	FSpudScopeLock& operator=(const FSpudScopeLock&) = delete;
+};
+
+UENUM(BlueprintType)
+enum class ESpudOperation : uint8
+{
+	SaveGame,
+	LoadGame,
+	/// Storing a level, e.g. on unload, or all levels when saving
+	StoreLevel,
+	/// Restoring a streaming level
+	RestoreLevel
+};
+
+/// What happened during a single SPUD operation, for diagnostics or telemetry.
+/// The counters are process wide, so they include anything else SPUD was doing at the same time, e.g. background
+/// writes of level data after a streaming level unloads.
+USTRUCT(BlueprintType)
+struct SPUD_API FSpudOperationMetrics
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	ESpudOperation Operation = ESpudOperation::SaveGame;
+	/// The slot or level name the operation was for
+	UPROPERTY(BlueprintReadOnly)
+	FString Target;
+	UPROPERTY(BlueprintReadOnly)
+	bool bSuccess = false;
+	/// Time from start to finish, including any frames in between for background or time sliced operations
+	UPROPERTY(BlueprintReadOnly)
+	float DurationMs = 0;
+	UPROPERTY(BlueprintReadOnly)
+	int32 ActorsStored = 0;
+	UPROPERTY(BlueprintReadOnly)
+	int32 ActorsRestored = 0;
+	/// Objects whose properties were restored with the stored class layout matching the runtime class
+	UPROPERTY(BlueprintReadOnly)
+	int32 FastPathRestores = 0;
+	/// Objects whose properties had to be matched up by name because the class has changed since it was stored
+	UPROPERTY(BlueprintReadOnly)
+	int32 SlowPathRestores = 0;
+	UPROPERTY(BlueprintReadOnly)
+	int64 BytesRead = 0;
+	UPROPERTY(BlueprintReadOnly)
+	int64 BytesWritten = 0;
+	/// Total time threads spent waiting for level data locks
+	UPROPERTY(BlueprintReadOnly)
+	float LockWaitMs = 0;
+};
+
+/// Measures an operation in progress
+struct SPUD_API FSpudOperationTracker
+{
+	ESpudOperation Operation = ESpudOperation::SaveGame;
+	FString Target;
+	FSpudMetrics::FSnapshot Start;
+	bool bActive = false;
+
+	void Begin(ESpudOperation InOperation, const FString& InTarget);
+	/// Finish measuring and return the results
+	FSpudOperationMetrics Finish(bool bSuccess);
+};
@@ -17,6 +17,22 @@ protected:
 	UPROPERTY(Category=LevelStreamingVolume, EditAnywhere, BlueprintReadOnly, meta=(DisplayName = "Streaming Levels", AllowedClasses="World"))
 	TArray<FSoftObjectPath> StreamingLevels;
 
+	/// If > 0, when a player's pawn or camera comes within this distance of the volume, the saved state for the
+	/// streaming levels is loaded in the background, so that it's ready by the time the levels themselves load
+	UPROPERTY(Category=LevelStreamingVolume, EditAnywhere, BlueprintReadOnly, meta=(ClampMin=0))
+	float PrefetchMargin = 0;
+
+	/// How often (in seconds) to check whether anyone is within PrefetchMargin
+	UPROPERTY(Category=LevelStreamingVolume, EditAnywhere, BlueprintReadOnly, meta=(ClampMin=0))
+	float PrefetchCheckInterval = 0.25f;
+
+	/// Priority of the load requests this volume makes, when more streaming levels are wanted than can load at once
+	/// (@see USpudSubsystem::MaxConcurrentStreamingLoads). Higher loads first.
+	UPROPERTY(Category=LevelStreamingVolume, EditAnywhere, BlueprintReadOnly)
+	float StreamingPriority = 0;
+
+	bool bPrefetchRequested = false;
+
 	UPROPERTY()
 	TArray<AActor*> RelevantActorsInVolume;
 
@@ -30,12 +46,15 @@ protected:
 	bool IsRelevantActor(AActor* Actor) const;
 	void AddRelevantActor(AActor* Actor);
 	void RemoveRelevantActor(AActor* Actor);
+	bool IsAnyPlayerWithinPrefetchMargin() const;
+	void SetPrefetchRequested(bool bRequest);
 
 	UFUNCTION()
 	void OnPawnControllerChanged(APawn* Pawn, AController* NewCtrl);
 
 public:
 
+	virtual void Tick(float DeltaSeconds) override;
 	virtual void NotifyActorBeginOverlap(AActor* OtherActor) override;
 	virtual void NotifyActorEndOverlap(AActor* OtherActor) override;
 };
@@ -2,8 +2,10 @@
 
 #include "CoreMinimal.h"
 
+#include "Async/Future.h"
 #include "SpudCustomSaveInfo.h"
 #include "SpudState.h"
+#include "SpudStats.h"
 #include "Subsystems/GameInstanceSubsystem.h"
 
 #include "SpudSubsystem.generated.h"
@@ -28,6 +30,9 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FSpudPostLoadStreamingLevel, const F
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FSpudPreUnloadStreamingLevel, const FName&, LevelName);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FSpudPostUnloadStreamingLevel, const FName&, LevelName);
 
+/// Delegate for diagnostics / telemetry
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FSpudOperationMetricsRecorded, const FSpudOperationMetrics&, Metrics);
+
 // Callbacks passed to functions
 DECLARE_DYNAMIC_DELEGATE_RetVal_OneParam(bool, FSpudUpgradeSaveDelegate, class USpudState*, SaveState);
 
@@ -98,7 +103,8 @@ public:
 	/// Event fired just before this subsystem loads a streaming level
 	UPROPERTY(BlueprintAssignable)
 	FSpudPreLoadStreamingLevel PreLoadStreamingLevel;
-	/// Event fired just after a streaming level has loaded, but BEFORE any state has been restored
+	/// Event fired just after a streaming level has loaded, but BEFORE any state has been restored (unless
+	/// LevelRestoreTimeBudgetMs is set, in which case it's fired once the restore has finished)
 	UPROPERTY(BlueprintAssignable)
 	FSpudPostLoadStreamingLevel PostLoadStreamingLevel;
 	/// Event fired just before this subsystem unloads a streaming level, BEFORE any state has been stored if needed
@@ -109,11 +115,50 @@ public:
 	UPROPERTY(BlueprintAssignable)
 	FSpudPostUnloadStreamingLevel PostUnloadStreamingLevel;
 
+	/// Event fired whenever a save, load, level store or level restore finishes, with metrics about what it did.
+	/// Useful to send to telemetry; @see GetLastOperationMetrics
+	UPROPERTY(BlueprintAssignable)
+	FSpudOperationMetricsRecorded PostOperationMetrics;
+
 	/// The time delay after the last request for a streaming level is withdrawn, that the level will be unloaded
 	/// This is used to reduce load/unload thrashing at boundaries
 	UPROPERTY(BlueprintReadWrite, Config)
 	float StreamLevelUnloadDelay = 3;
 
+	/// The maximum number of streaming levels loading at once, counting until their state has been restored. Any
+	/// more requests wait in a queue, and are started as others finish: highest priority first (@see
+	/// AddRequestForStreamingLevel), then closest to a player, then oldest. Blocking loads are never queued.
+	/// 0 means no limit.
+	UPROPERTY(BlueprintReadWrite, Config)
+	int32 MaxConcurrentStreamingLoads = 0;
+
+	/// The maximum number of streaming levels which can start unloading in the same frame, once their
+	/// StreamLevelUnloadDelay has passed. The rest wait for the following frames, soonest due first. 0 means no limit.
+	UPROPERTY(BlueprintReadWrite, Config)
+	int32 MaxStreamingUnloadsPerFrame = 0;
+
+	/// The maximum total size (in KB, as stored in the level cache) of level data which can be prefetched ahead of
+	/// streaming levels loading (@see AddPrefetchRequestForStreamingLevel). 0 means no limit.
+	UPROPERTY(BlueprintReadWrite, Config)
+	int32 PrefetchMemoryBudgetKB = 65536;
+
+	/// The time after the last prefetch request for a level is withdrawn, that its prefetched data is released
+	/// if the level didn't get loaded in the meantime
+	UPROPERTY(BlueprintReadWrite, Config)
+	float PrefetchExpiryDelay = 30;
+
+	/// If > 0, streaming levels are restored a few actors at a time, spending no more than this many milliseconds per
+	/// frame, rather than all at once in the frame they finish loading. PostLevelRestore and PostLoadStreamingLevel
+	/// aren't fired until the restore is complete. 0 means restore all at once.
+	UPROPERTY(BlueprintReadWrite, Config)
+	float LevelRestoreTimeBudgetMs = 0;
+
+	/// If > 0, once a streaming level is due to be unloaded its state is stored a few actors at a time, spending no more
+	/// than this many milliseconds per frame, then written in the background before the level is actually unloaded.
+	/// If the level is requested again in the meantime, it just stays loaded. 0 means store all at once on unload.
+	UPROPERTY(BlueprintReadWrite, Config)
+	float LevelStoreTimeBudgetMs = 0;
+
 	/// The desired width of screenshots taken for save games
 	UPROPERTY(BlueprintReadWrite, Config)
 	int32 ScreenshotWidth = 240;
@@ -122,6 +167,69 @@ public:
 	int32 ScreenshotHeight = 135;
 	FDelegateHandle OnScreenshotHandle;
 
+	/// If true, saving a game only captures the state of the world on the game thread. Writing the save file,
+	/// including piping the data for levels which aren't loaded out of the level cache, happens on a background
+	/// thread. IsSavingGame() stays true, and PostSaveGame isn't fired, until the file has been completely written.
+	/// Travelling to another map waits for the write to finish, so the maps either side are stored & restored as usual.
+	UPROPERTY(BlueprintReadWrite, Config)
+	bool bSaveGameAsync = false;
+
+	/// If true, reading a save game and splitting its level data out into the level cache happens on a background
+	/// thread. The map travel starts as soon as the global data and the data for the saved map are ready, while the
+	/// remaining level data continues to be extracted.
+	UPROPERTY(BlueprintReadWrite, Config)
+	bool bLoadGameAsync = false;
+
+	/// If true, storing a level (on save, autosave, or streaming unload) keeps the existing data for actors which
+	/// are dirty tracked (@see ISpudObject::IsSpudDirtyTracked) and haven't been marked dirty with MarkActorDirty
+	/// since they were last stored or restored, rather than storing every actor from scratch.
+	UPROPERTY(BlueprintReadWrite, Config)
+	bool bIncrementalLevelStore = false;
+
+	/// If false, the transforms of actors whose root component isn't movable aren't stored. They're never restored
+	/// anyway (static & stationary actors stay where the level put them), so this only matters if you change an
+	/// actor's mobility at runtime, or read the data yourself.
+	UPROPERTY(BlueprintReadWrite, Config)
+	bool bStoreNonMovableTransforms = true;
+
+	/// If true, when all loaded levels are stored at once (saving, or travelling to another map), the property data
+	/// of each level is encoded in parallel on worker threads, once everything which needs the game thread (callbacks,
+	/// transforms) has been gathered. Actors implementing ISpudObjectCallback are always stored on the game thread.
+	UPROPERTY(BlueprintReadWrite, Config)
+	bool bParallelStoreWorld = false;
+
+	/// If true, level data is compressed when written, both in save games and the level cache (SpudCache).
+	/// Compressed and uncompressed level data can be mixed freely, so changing this never stops older saves loading.
+	/// Read at startup; call SetCompressLevelData to change it at runtime.
+	UPROPERTY(BlueprintReadOnly, Config)
+	bool bCompressLevelData = false;
+
+	/// The FCompression format to use when bCompressLevelData is enabled, e.g. Zlib, Gzip, LZ4 or Oodle where available
+	UPROPERTY(BlueprintReadOnly, Config)
+	FName LevelDataCompressionFormat = NAME_Zlib;
+
+	/// If true, level files in the cache (SpudCache) are memory mapped when a level's data is loaded, and actor data
+	/// is read straight from the mapping instead of being copied into memory first. It's only copied out when the
+	/// level is next stored. Has no effect on compressed level data, or platforms which can't map files.
+	/// Read at startup.
+	UPROPERTY(BlueprintReadOnly, Config)
+	bool bMapLevelFiles = false;
+
+	/// If true, level data refers to class definitions in a table shared by the whole save, rather than every level
+	/// carrying its own copy of the same class & property names. Either form can be read regardless of this setting,
+	/// so it can be changed at any time; levels are just written in the chosen form from then on.
+	/// Read at startup.
+	UPROPERTY(BlueprintReadOnly, Config)
+	bool bShareClassDefinitions = true;
+
+	/// The maximum number of save games UpgradeAllSaveGames works on at once. The upgrade callback itself is still
+	/// only called for one save at a time.
+	UPROPERTY(BlueprintReadWrite, Config)
+	int32 MaxConcurrentSaveUpgrades = 4;
+
+	/// The maximum number of in-memory snapshots kept (@see CaptureSnapshot); capturing another drops the oldest
+	UPROPERTY(BlueprintReadWrite, Config)
+	int32 MaxSnapshots = 10;
 
 protected:
 	FDelegateHandle OnPreLoadMapHandle;
@@ -133,12 +241,31 @@ protected:
 	TMap<int32, FName> LevelsPendingUnload;
 	FCriticalSection LevelsPendingLoadMutex;
 	FCriticalSection LevelsPendingUnloadMutex;
-	FTimerHandle StreamLevelUnloadTimerHandle;
 	float ScreenshotTimeout = 0;	
 	FString SlotNameInProgress;
 	FText TitleInProgress;
 	UPROPERTY()
 	const USpudCustomSaveInfo* ExtraInfoInProgress;
+	/// Background write of a save game file, if one is in progress; the result is whether it succeeded
+	TFuture<bool> PendingSaveTask;
+	/// The slot PendingSaveTask is writing
+	FString PendingSaveSlotName;
+	/// Identifies the latest background save, so a completion for one that's already been waited for is ignored
+	uint32 PendingSaveSerial = 0;
+	/// Background read of a save game file, if one is in progress (may continue after the load has completed)
+	TFuture<void> PendingLoadTask;
+	/// Background write of a snapshot to a save game file, if one is in progress
+	TFuture<void> PendingSnapshotSaveTask;
+	/// In-memory snapshots of the game, oldest first
+	TArray<FSpudStateSnapshot::Ptr> Snapshots;
+
+	/// Metrics for operations in progress
+	FSpudOperationTracker SaveGameTracker;
+	FSpudOperationTracker LoadGameTracker;
+	TMap<FName, FSpudOperationTracker> LevelStoreTrackers;
+	TMap<FName, FSpudOperationTracker> LevelRestoreTrackers;
+	/// Metrics for the last completed operation of each type
+	TMap<ESpudOperation, FSpudOperationMetrics> LastOperationMetrics;
 
 	UPROPERTY()
 	TArray<TWeakObjectPtr<UObject>> GlobalObjects;
@@ -157,6 +284,8 @@ protected:
 		if (!IsValid(ActiveState))
 			ActiveState = NewObject<USpudState>();
 
+		ActiveState->bIncrementalStore = bIncrementalLevelStore;
+		ActiveState->bStoreNonMovableTransforms = bStoreNonMovableTransforms;
 		return ActiveState;
 	}
 
@@ -164,9 +293,11 @@ protected:
 	{
 		TArray<TWeakObjectPtr<>> Requesters;
 		bool bPendingUnload;
+		/// Being stored a bit at a time, ready to unload (@see LevelStoreTimeBudgetMs)
+		bool bPendingStore;
 		float LastRequestExpiredTime;
 
-		FStreamLevelRequests(): bPendingUnload(false), LastRequestExpiredTime(0)
+		FStreamLevelRequests(): bPendingUnload(false), bPendingStore(false), LastRequestExpiredTime(0)
 		{
 		}
 	};
@@ -174,6 +305,53 @@ protected:
 	// Map of streaming level names to the requests to load them 
 	TMap<FName, FStreamLevelRequests> LevelRequests;
 
+	/// A streaming level load waiting for a free slot (@see MaxConcurrentStreamingLoads)
+	struct FQueuedStreamLoad
+	{
+		FName LevelName;
+		/// Highest requested priority, higher loads first
+		float Priority;
+		/// Platform time it was queued, for ordering otherwise equal requests
+		double QueuedTime;
+	};
+	/// Streaming level loads not started yet, unordered (they're ordered when picking the next one)
+	TArray<FQueuedStreamLoad> QueuedStreamLoads;
+	/// Streaming levels which have started loading but haven't finished restoring yet
+	TSet<FName> StreamLevelsLoading;
+
+	/// A streaming level due to be unloaded once StreamLevelUnloadDelay has passed
+	struct FStreamUnloadExpiry
+	{
+		FName LevelName;
+		/// Game time the unload is due
+		float UnloadTime;
+		/// The request's LastRequestExpiredTime when this was queued; if that's changed, this entry is stale
+		float RequestExpiredTime;
+
+		bool operator<(const FStreamUnloadExpiry& Other) const { return UnloadTime < Other.UnloadTime; }
+	};
+	/// Heap of pending unloads, soonest first. Entries aren't removed when a level is requested again, they're
+	/// just ignored when they come up, since the request no longer matches
+	TArray<FStreamUnloadExpiry> StreamUnloadQueue;
+
+	struct FLevelPrefetch
+	{
+		TArray<TWeakObjectPtr<>> Requesters;
+		/// The background load of the level data, if one was started
+		TFuture<void> Task;
+		/// Size of the level data in the level cache, which is what we count against the budget
+		int64 Size = 0;
+		/// Platform time at which the last requester withdrew, 0 while still requested
+		double LastRequestExpiredTime = 0;
+	};
+
+	/// Map of streaming level names to prefetches of their level data
+	TMap<FName, FLevelPrefetch> LevelPrefetches;
+
+	/// Cached descriptions of save games, so listing them doesn't have to open every save (loaded on first use)
+	FSpudSaveSlotIndex SaveSlotIndex;
+	bool bSaveSlotIndexLoaded = false;
+
 	bool ServerCheck(bool LogWarning) const;
 
 	UFUNCTION()
@@ -198,6 +376,8 @@ protected:
     void PostLoadStreamLevelGameThread(FName LevelName);
 	UFUNCTION(BlueprintCallable)
     void PostUnloadStreamLevelGameThread(FName LevelName);
+	/// Called once a streaming level has been restored, whether immediately or time sliced
+	void PostRestoreStreamLevel(FName LevelName, bool bSuccess, bool bTimeSliced);
 
 	void StoreWorld(UWorld* World, bool bReleaseLevels, bool bBlocking);
 	void StoreLevel(ULevel* Level, bool bRelease, bool bBlocking);
@@ -207,15 +387,64 @@ protected:
 	UFUNCTION()
     void OnScreenshotCaptured(int32 Width, int32 Height, const TArray<FColor>& Colours);
 
-	void FinishSaveGame(const FString& SlotName, const FText& Title, const USpudCustomSaveInfo* ExtraInfo, TArray<uint8>* ScreenshotData);
+	/// Store global objects and all loaded levels into the active state, ready to be saved
+	void StoreGlobalsAndWorld();
+	/// Store the world & write the save. ScreenshotTask is the PNG encode of the screenshot if there is one, which
+	/// is only waited for when the file is about to be written
+	void FinishSaveGame(const FString& SlotName, const FText& Title, const USpudCustomSaveInfo* ExtraInfo, TFuture<TArray<uint8>> ScreenshotTask);
+	static bool WriteSaveGameFile(USpudState* State, const FString& SlotName);
+	void TravelToLoadedGame(const FString& SlotName);
 	void LoadComplete(const FString& SlotName, bool bSuccess);
 	void SaveComplete(const FString& SlotName, bool bSuccess);
+	void AsyncSaveComplete(const FString& SlotName, bool bSuccess, uint32 Serial);
+	void SnapshotSaveComplete(const FString& SlotName, bool bSuccess, FSpudOperationTracker Tracker);
+	FSpudStateSnapshot::Ptr FindSnapshot(const FString& Name) const;
+	/// Block until any background save game write (including snapshots) has finished. A background save game write
+	/// is completed there & then, so we're no longer saving afterwards
+	void WaitForPendingSave();
+	/// Block until any background write of a snapshot to a save game has finished
+	void WaitForPendingSnapshotSave();
+	/// Block until any background save game read has finished
+	void WaitForPendingLoad();
 
 	void LoadStreamLevel(FName LevelName, bool Blocking);
-	void StartUnloadTimer();
-	void StopUnloadTimer();
-	void CheckStreamUnload();
-	void UnloadStreamLevel(FName LevelName);
+	/// Try to make room in the prefetch budget for Size more bytes by releasing unrequested prefetches
+	bool MakeRoomForPrefetch(int64 Size);
+	/// Release prefetched data which has been unrequested for longer than PrefetchExpiryDelay
+	void CheckPrefetchExpiry();
+	/// Release a prefetch's level data, unless the level has been loaded since
+	void ReleasePrefetch(FName LevelName, FLevelPrefetch& Prefetch);
+	/// Release all prefetched level data
+	void ReleaseAllPrefetches();
+	/// Block until any prefetches in progress have finished, and forget them (for when the state is being reset)
+	void CancelAllPrefetches();
+	/// Read the save slot index from disk if we haven't already
+	void LoadSaveSlotIndexIfNeeded();
+	/// Write the save slot index to disk
+	void WriteSaveSlotIndex();
+	/// Update the save slot index entry for a slot from a file we've just checked. Returns false if it's not a valid save
+	bool UpdateSaveSlotIndex(const FString& SlotName, int64 FileSize, const FDateTime& FileTimestamp);
+	/// Update the save slot index for a save we've just written, and write the index
+	void UpdateSaveSlotIndexFromFile(const FString& SlotName);
+	/// Create a save game info from a save slot index entry
+	USpudSaveGameInfo* CreateSaveGameInfo(const FSpudSaveSlotInfo& SlotInfo);
+	/// Start as many queued streaming loads as MaxConcurrentStreamingLoads allows, best first
+	void DispatchQueuedStreamLoads();
+	/// A streaming level has finished loading (or given up), freeing its slot for a queued one
+	void FinishStreamLevelLoading(FName LevelName);
+	/// Schedule a streaming level to be unloaded at UnloadTime, if it's still unrequested by then
+	void QueueStreamLevelUnload(FName LevelName, float UnloadTime);
+	/// Start unloading streaming levels whose unload delay has passed, up to MaxStreamingUnloadsPerFrame
+	void ProcessStreamUnloadQueue();
+	/// Forget all queued streaming loads & unloads, e.g. because the map is changing
+	void ResetStreamingQueues();
+	/// Unload a streaming level, storing its state first unless bStore is false (because it's been stored already)
+	void UnloadStreamLevel(FName LevelName, bool bStore = true);
+	/// Start storing a streaming level a bit at a time, ready to unload it
+	void StartTimeSlicedUnload(FName LevelName);
+	void PostTimeSlicedStore(FName LevelName, bool bSuccess);
+	/// Finish measuring an operation, keep the results & fire PostOperationMetrics
+	void RecordOperationMetrics(FSpudOperationTracker& Tracker, bool bSuccess);
 
 public:
 
@@ -231,6 +460,11 @@ public:
 	UFUNCTION(BlueprintPure)
     bool IsIdle() const { return CurrentState == ESpudSystemState::RunningIdle; }
 
+	/// Get the metrics for the last completed operation of a given type (all zeros if there hasn't been one yet).
+	/// Detailed timings are also available in "stat SPUD", Unreal Insights and CSV profiles.
+	UFUNCTION(BlueprintPure)
+	FSpudOperationMetrics GetLastOperationMetrics(ESpudOperation Operation) const;
+
 	/// Start a new game with a blank persistent state
 	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly)
     void NewGame(bool CheckServerOnly = true);
@@ -288,6 +522,45 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly)
     bool DeleteSave(const FString& SlotName);
 
+	/**
+	 * Capture the state of the game into an in-memory snapshot, which can be restored without going anywhere near
+	 * the disk (@see RestoreSnapshot). Only the last MaxSnapshots are kept; capturing one with the same name as an
+	 * existing snapshot replaces it. Levels which are paged out and haven't changed since the last snapshot share its
+	 * data, so capturing regularly only really costs the levels which are loaded.
+	 * @param Name The name of the snapshot
+	 * @return Whether the snapshot was captured
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly)
+	bool CaptureSnapshot(const FString& Name);
+	/// Restore the game from a snapshot. This is just like LoadGame (including the map being reloaded), except no
+	/// files are read. Asynchronous, PostLoadGame is fired with the snapshot name once complete.
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly)
+	bool RestoreSnapshot(const FString& Name);
+	/// Restore the most recent snapshot and discard it, so that calling this again goes back another step
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly)
+	bool RewindSnapshot();
+	UFUNCTION(BlueprintPure)
+	bool HasSnapshot(const FString& Name) const;
+	/// Get the names of all snapshots, oldest first
+	UFUNCTION(BlueprintPure)
+	TArray<FString> GetSnapshotNames() const;
+	UFUNCTION(BlueprintCallable)
+	void DeleteSnapshot(const FString& Name);
+	UFUNCTION(BlueprintCallable)
+	void DeleteAllSnapshots();
+	/**
+	 * Write a snapshot to a save game slot on a background thread, giving exactly the save you'd have got by saving
+	 * the game when the snapshot was captured. PreSaveGame is fired straight away and PostSaveGame once it's written.
+	 * The file is written alongside the slot and only replaces it when complete; loading, deleting or saving to any
+	 * slot waits for the write to finish.
+	 * @param Name The name of the snapshot
+	 * @param SlotName The name of the slot to save to
+	 * @param Title A descriptive title for the save, if empty the title of the game when the snapshot was captured
+	 * @return Whether the write was started
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly)
+	bool SaveSnapshotToSlot(const FString& Name, const FString& SlotName, const FText& Title = FText());
+
 	/**
 	* Add a global object to the list of objects which will have their state saved / loaded
 	* Level actors which implement ISpudObject will automatically be saved/loaded but global objects like GameInstance
@@ -338,14 +611,27 @@ public:
 
 	/// Make a request that a streaming level is loaded. Won't load if already loaded, but will
 	/// record the request count so that unloading is done when all requests are withdrawn.
+	/// If MaxConcurrentStreamingLoads are already in progress, non-blocking loads are queued; those with a higher
+	/// Priority are started first, and among equal priorities, those whose requesters are closest to a player.
 	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly)
-	void AddRequestForStreamingLevel(UObject* Requester, FName LevelName, bool BlockingLoad);
+	void AddRequestForStreamingLevel(UObject* Requester, FName LevelName, bool BlockingLoad, float Priority = 0);
 	/// Withdraw a request for a streaming level. Once all requesters have rescinded their requests, the
 	/// streaming level will be considered ready to be unloaded.
 	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly)
 	void WithdrawRequestForStreamingLevel(UObject* Requester, FName LevelName);
 
-	/// Get the list of the save games with metadata
+	/// Make a request that the saved data for a streaming level is loaded in the background, in anticipation of the
+	/// level itself being requested soon (e.g. the player is getting close to it). Nothing happens if there's no saved
+	/// data for the level, it's already loaded, or it won't fit in PrefetchMemoryBudgetKB.
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly)
+	void AddPrefetchRequestForStreamingLevel(UObject* Requester, FName LevelName);
+	/// Withdraw a prefetch request for a streaming level. Once all requesters have rescinded their requests, the
+	/// prefetched data is released after PrefetchExpiryDelay, unless the level has been loaded in the meantime.
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly)
+	void WithdrawPrefetchRequestForStreamingLevel(UObject* Requester, FName LevelName);
+
+	/// Get the list of the save games with metadata. This comes from a cached index of the save files, so is cheap
+	/// even with a lot of saves. Thumbnails are not loaded, call LoadThumbnailAsync on the entries you display.
 	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly)
 	TArray<USpudSaveGameInfo*> GetSaveGameList(bool bIncludeQuickSave = true, bool bIncludeAutoSave = true, ESpudSaveSorting Sorting = ESpudSaveSorting::None);
 
@@ -400,13 +686,25 @@ public:
 	UFUNCTION(BlueprintCallable)
     int32 GetUserDataModelVersion() const;
 
+	/// Tell SPUD that the persistent state of a dirty tracked actor has changed, so it must be stored again
+	/// next time its level is stored (@see bIncrementalLevelStore, ISpudObject::IsSpudDirtyTracked)
+	UFUNCTION(BlueprintCallable)
+	void MarkActorDirty(AActor* Actor);
+
+	/// Enable / disable compression of level data written from now on, using LevelDataCompressionFormat
+	/// (@see bCompressLevelData)
+	UFUNCTION(BlueprintCallable)
+	void SetCompressLevelData(bool bCompress);
+
 	/**
 	 * Triggers the upgrade process for all save games (asynchronously)
 	 * 
-	 * Each save game present will be fully loaded, and for each where the user data model version of any part differs from latest,
-     * the SaveNeedsUpgrading callback will be triggered (in a background thread). That callback should perform any
-     * changes it needs to the USpudState. When the callback completes the save will be written back to
-     * disk if the callback returned true.
+	 * Each save game present is checked, reading only the version information where possible, and for each where the
+	 * user data model version of any part differs from latest, the SaveNeedsUpgrading callback will be triggered (in a
+	 * background thread). Several saves are processed in parallel (@see MaxConcurrentSaveUpgrades), but the callback
+	 * is only called for one at a time. That callback should perform any changes it needs to the USpudState. Level
+	 * data isn't loaded up-front; USpudState's upgrade functions like RenameClass load each level in turn as they
+	 * change it. When the callback completes the save will be written back to disk if the callback returned true.
      * Note that at no point will any actors or levels be loaded. All changes made to the save are done manually so
      * that next time they need to be applied to real game objects, the state is as you need it to be.
      * If for some reason you need to have the actors loaded to perform the upgrade, then you should instead
@@ -435,6 +733,7 @@ public:
 
 	static FString GetSaveGameDirectory();
 	static FString GetSaveGameFilePath(const FString& SlotName);
+	static FString GetSaveSlotIndexFilePath();
 	// Lists saves: note that this is only the filenames, not the directory
 	static void ListSaveGameFiles(TArray<FString>& OutSaveFileList);
 	static FString GetActiveGameFolder();
@@ -31,6 +31,7 @@ public class SPUD : ModuleRules
 		PrivateDependencyModuleNames.AddRange(
 			new string[]
 			{
+				"ImageWrapper"
 			}
 			);
 		
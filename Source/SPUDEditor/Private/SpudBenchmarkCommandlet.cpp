@@ -0,0 +1,337 @@
+#include "SpudBenchmarkCommandlet.h"
+
+#include "SpudBenchmarkTypes.h"
+#include "SpudEditorModule.h"
+#include "SpudState.h"
+#include "Dom/JsonObject.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+USpudBenchmarkCommandlet::USpudBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+void USpudBenchmarkCommandlet::FPhaseResult::Add(const FSpudOperationMetrics& Metrics, int64 InActors, int64 InBytes)
+{
+	DurationsMs.Add(Metrics.DurationMs);
+	Actors += InActors;
+	Bytes += InBytes;
+	FastPathRestores += Metrics.FastPathRestores;
+	SlowPathRestores += Metrics.SlowPathRestores;
+	LockWaitMs += Metrics.LockWaitMs;
+}
+
+int32 USpudBenchmarkCommandlet::Main(const FString& Params)
+{
+	if (!ParseSettings(Params))
+		return 1;
+
+	UE_LOG(LogSpudEditor, Display, TEXT("SPUD benchmark: %d actors (%d level, %d spawned), %.0f%% of level actors destroyed, mix %s, %d iterations"),
+		Settings.NumActors, NumLevelActors(), NumSpawnedActors(), Settings.DestroyedFraction * 100,
+		*FString::Join(Settings.Mix, TEXT(",")), Settings.Iterations);
+
+	const uint64 BaselineUsedPhysical = FPlatformMemory::GetStats().UsedPhysical;
+
+	// Level name comes from the package, so give it a recognisable one
+	UPackage* Package = CreatePackage(
+#if ENGINE_MINOR_VERSION < 26
+		nullptr,
+#endif
+		TEXT("/Temp/SpudBenchmark"));
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("SpudBenchmark"), Package);
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+	ULevel* Level = World->PersistentLevel;
+
+	USpudState* State = NewObject<USpudState>();
+	State->AddToRoot();
+	// Resetting & loading clear out the level cache, so keep well away from the project's real one
+	State->LevelCacheFolder = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("SpudBenchmark/"));
+	FRandomStream Rand(Settings.Seed);
+
+	for (int32 Iteration = 0; Iteration < Settings.Iterations; ++Iteration)
+	{
+		UE_LOG(LogSpudEditor, Display, TEXT("SPUD benchmark: iteration %d of %d"), Iteration + 1, Settings.Iterations);
+		FSpudOperationTracker Tracker;
+
+		// Store level from scratch
+		State->ResetState();
+		PopulateLevel(Level, Rand, true);
+		Tracker.Begin(ESpudOperation::StoreLevel, TEXT("Store"));
+		State->StoreLevel(Level, false, true);
+		auto Metrics = Tracker.Finish(true);
+		GetPhase(TEXT("StoreLevel")).Add(Metrics, Metrics.ActorsStored, 0);
+		DestroySomeLevelActors(State, Level, Rand);
+
+		// Restore the stored data into a freshly loaded level; respawns runtime actors and destroys destroyed ones
+		ClearLevel(Level);
+		PopulateLevel(Level, Rand, false);
+		Tracker.Begin(ESpudOperation::RestoreLevel, TEXT("Restore"));
+		State->RestoreLevel(Level);
+		Metrics = Tracker.Finish(true);
+		GetPhase(TEXT("RestoreLevel")).Add(Metrics, Metrics.ActorsRestored, 0);
+
+		// Save & load in memory, so that it's SPUD being measured rather than the disk
+		TArray<uint8> SaveBuffer;
+		{
+			FMemoryWriter Writer(SaveBuffer);
+			Tracker.Begin(ESpudOperation::SaveGame, TEXT("Save"));
+			State->SaveToArchive(Writer);
+			Metrics = Tracker.Finish(true);
+			GetPhase(TEXT("SaveToArchive")).Add(Metrics, 0, SaveBuffer.Num());
+		}
+		{
+			FMemoryReader Reader(SaveBuffer);
+			Tracker.Begin(ESpudOperation::LoadGame, TEXT("Load"));
+			State->LoadFromArchive(Reader, true);
+			Metrics = Tracker.Finish(true);
+			GetPhase(TEXT("LoadFromArchive")).Add(Metrics, 0, SaveBuffer.Num());
+		}
+
+		// Restore from loaded data, class layouts all match so this is the fast path
+		ClearLevel(Level);
+		PopulateLevel(Level, Rand, false);
+		Tracker.Begin(ESpudOperation::RestoreLevel, TEXT("RestoreFast"));
+		State->RestoreLevel(Level);
+		Metrics = Tracker.Finish(true);
+		GetPhase(TEXT("RestoreLevelFastPath")).Add(Metrics, Metrics.ActorsRestored, 0);
+
+		// And again as if all the classes had changed since saving
+		ClearLevel(Level);
+		PopulateLevel(Level, Rand, false);
+		ForceSlowPath(State);
+		Tracker.Begin(ESpudOperation::RestoreLevel, TEXT("RestoreSlow"));
+		State->RestoreLevel(Level);
+		Metrics = Tracker.Finish(true);
+		GetPhase(TEXT("RestoreLevelSlowPath")).Add(Metrics, Metrics.ActorsRestored, 0);
+
+		ClearLevel(Level);
+	}
+
+	const auto MemStats = FPlatformMemory::GetStats();
+	ReportResults();
+
+	State->ResetState();
+	FSpudSaveData::DeleteAllLevelDataFiles(State->LevelCacheFolder);
+	IFileManager::Get().DeleteDirectory(*State->LevelCacheFolder, false, true);
+	State->RemoveFromRoot();
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+
+	// Write machine readable results
+	const TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+	const TSharedRef<FJsonObject> SettingsJson = MakeShared<FJsonObject>();
+	SettingsJson->SetNumberField(TEXT("Actors"), Settings.NumActors);
+	SettingsJson->SetNumberField(TEXT("LevelActors"), NumLevelActors());
+	SettingsJson->SetNumberField(TEXT("SpawnedActors"), NumSpawnedActors());
+	SettingsJson->SetNumberField(TEXT("DestroyedFraction"), Settings.DestroyedFraction);
+	SettingsJson->SetStringField(TEXT("Mix"), FString::Join(Settings.Mix, TEXT(",")));
+	SettingsJson->SetNumberField(TEXT("Iterations"), Settings.Iterations);
+	SettingsJson->SetNumberField(TEXT("Seed"), Settings.Seed);
+	Root->SetObjectField(TEXT("Settings"), SettingsJson);
+
+	TArray<TSharedPtr<FJsonValue>> PhasesJson;
+	for (const auto& Phase : Results)
+	{
+		const TSharedRef<FJsonObject> PhaseJson = MakeShared<FJsonObject>();
+		float Total = 0;
+		for (const float Ms : Phase.DurationsMs)
+		{
+			Total += Ms;
+		}
+		const double TotalSecs = Total / 1000.0;
+		PhaseJson->SetStringField(TEXT("Name"), Phase.Name);
+		PhaseJson->SetNumberField(TEXT("MinMs"), FMath::Min(Phase.DurationsMs));
+		PhaseJson->SetNumberField(TEXT("MeanMs"), Total / Phase.DurationsMs.Num());
+		PhaseJson->SetNumberField(TEXT("MaxMs"), FMath::Max(Phase.DurationsMs));
+		PhaseJson->SetNumberField(TEXT("ActorsPerSec"), TotalSecs > 0 ? Phase.Actors / TotalSecs : 0);
+		PhaseJson->SetNumberField(TEXT("MBPerSec"), TotalSecs > 0 ? Phase.Bytes / TotalSecs / (1024.0 * 1024.0) : 0);
+		PhaseJson->SetNumberField(TEXT("Bytes"), Phase.Bytes / Phase.DurationsMs.Num());
+		PhaseJson->SetNumberField(TEXT("FastPathRestores"), Phase.FastPathRestores / Phase.DurationsMs.Num());
+		PhaseJson->SetNumberField(TEXT("SlowPathRestores"), Phase.SlowPathRestores / Phase.DurationsMs.Num());
+		PhaseJson->SetNumberField(TEXT("LockWaitMs"), Phase.LockWaitMs);
+		PhasesJson.Add(MakeShared<FJsonValueObject>(PhaseJson));
+	}
+	Root->SetArrayField(TEXT("Phases"), PhasesJson);
+
+	const TSharedRef<FJsonObject> MemoryJson = MakeShared<FJsonObject>();
+	MemoryJson->SetNumberField(TEXT("BaselineUsedPhysicalMB"), BaselineUsedPhysical / (1024.0 * 1024.0));
+	MemoryJson->SetNumberField(TEXT("UsedPhysicalMB"), MemStats.UsedPhysical / (1024.0 * 1024.0));
+	MemoryJson->SetNumberField(TEXT("PeakUsedPhysicalMB"), MemStats.PeakUsedPhysical / (1024.0 * 1024.0));
+	Root->SetObjectField(TEXT("Memory"), MemoryJson);
+
+	FString Json;
+	const auto Writer = TJsonWriterFactory<>::Create(&Json);
+	FJsonSerializer::Serialize(Root, Writer);
+	if (!FFileHelper::SaveStringToFile(Json, *Settings.OutputPath))
+	{
+		UE_LOG(LogSpudEditor, Error, TEXT("SPUD benchmark: unable to write results to %s"), *Settings.OutputPath);
+		return 1;
+	}
+	UE_LOG(LogSpudEditor, Display, TEXT("SPUD benchmark: results written to %s"), *Settings.OutputPath);
+
+	return 0;
+}
+
+bool USpudBenchmarkCommandlet::ParseSettings(const FString& Params)
+{
+	FParse::Value(*Params, TEXT("Actors="), Settings.NumActors);
+	FParse::Value(*Params, TEXT("Spawned="), Settings.SpawnedFraction);
+	FParse::Value(*Params, TEXT("Destroyed="), Settings.DestroyedFraction);
+	FParse::Value(*Params, TEXT("Iterations="), Settings.Iterations);
+	FParse::Value(*Params, TEXT("Seed="), Settings.Seed);
+	if (!FParse::Value(*Params, TEXT("Output="), Settings.OutputPath))
+		Settings.OutputPath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("SpudBenchmark.json"));
+
+	FString MixStr = TEXT("pod,strings,arrays,structs,refs");
+	FParse::Value(*Params, TEXT("Mix="), MixStr, false);
+	MixStr.ParseIntoArray(Settings.Mix, TEXT(","));
+
+	if (Settings.NumActors <= 0 || Settings.Iterations <= 0)
+	{
+		UE_LOG(LogSpudEditor, Error, TEXT("SPUD benchmark: Actors and Iterations must be > 0"));
+		return false;
+	}
+	Settings.SpawnedFraction = FMath::Clamp(Settings.SpawnedFraction, 0.f, 1.f);
+	Settings.DestroyedFraction = FMath::Clamp(Settings.DestroyedFraction, 0.f, 1.f);
+
+	for (const auto& Name : Settings.Mix)
+	{
+		if (Name.Equals(TEXT("pod"), ESearchCase::IgnoreCase))
+			ActorClasses.Add(ASpudBenchmarkActor::StaticClass());
+		else if (Name.Equals(TEXT("strings"), ESearchCase::IgnoreCase))
+			ActorClasses.Add(ASpudBenchmarkStringActor::StaticClass());
+		else if (Name.Equals(TEXT("arrays"), ESearchCase::IgnoreCase))
+			ActorClasses.Add(ASpudBenchmarkArrayActor::StaticClass());
+		else if (Name.Equals(TEXT("structs"), ESearchCase::IgnoreCase))
+			ActorClasses.Add(ASpudBenchmarkStructActor::StaticClass());
+		else if (Name.Equals(TEXT("refs"), ESearchCase::IgnoreCase))
+			ActorClasses.Add(ASpudBenchmarkRefActor::StaticClass());
+		else
+		{
+			UE_LOG(LogSpudEditor, Error, TEXT("SPUD benchmark: unknown property mix '%s'"), *Name);
+			return false;
+		}
+	}
+	if (ActorClasses.Num() == 0)
+	{
+		UE_LOG(LogSpudEditor, Error, TEXT("SPUD benchmark: no property mixes specified"));
+		return false;
+	}
+
+	return true;
+}
+
+USpudBenchmarkCommandlet::FPhaseResult& USpudBenchmarkCommandlet::GetPhase(const FString& Name)
+{
+	for (auto& Phase : Results)
+	{
+		if (Phase.Name == Name)
+			return Phase;
+	}
+	auto& Phase = Results.AddDefaulted_GetRef();
+	Phase.Name = Name;
+	return Phase;
+}
+
+int32 USpudBenchmarkCommandlet::NumLevelActors() const
+{
+	return Settings.NumActors - FMath::RoundToInt(Settings.NumActors * Settings.SpawnedFraction);
+}
+
+void USpudBenchmarkCommandlet::PopulateLevel(ULevel* Level, FRandomStream& Rand, bool bIncludeSpawned)
+{
+	UWorld* World = Level->GetWorld();
+	TArray<AActor*> Actors;
+	const int32 NumToSpawn = bIncludeSpawned ? Settings.NumActors : NumLevelActors();
+	Actors.Reserve(NumToSpawn);
+	for (int32 i = 0; i < NumToSpawn; ++i)
+	{
+		const bool bLevelActor = i < NumLevelActors();
+		FActorSpawnParameters Params;
+		Params.OverrideLevel = Level;
+		Params.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		// Level actors are identified by name, so they need to be the same every time
+		if (bLevelActor)
+			Params.Name = FName(*FString::Printf(TEXT("SpudBenchmarkActor_%d"), i));
+		auto Actor = World->SpawnActor<ASpudBenchmarkActor>(ActorClasses[i % ActorClasses.Num()], Params);
+		if (!Actor)
+			continue;
+
+		// This is what makes SPUD treat it as an actor which was part of the level, rather than spawned at runtime
+		if (bLevelActor)
+			Actor->SetFlags(RF_WasLoaded);
+		Actors.Add(Actor);
+	}
+
+	for (auto Actor : Actors)
+	{
+		Cast<ASpudBenchmarkActor>(Actor)->Randomise(Rand, Actors);
+	}
+}
+
+void USpudBenchmarkCommandlet::ClearLevel(ULevel* Level)
+{
+	UWorld* World = Level->GetWorld();
+	// Copy, destroying actors changes the level's list
+	TArray<AActor*> Actors = Level->Actors;
+	for (auto Actor : Actors)
+	{
+		if (IsValid(Actor) && Actor->IsA<ASpudBenchmarkActor>())
+			World->DestroyActor(Actor);
+	}
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+}
+
+void USpudBenchmarkCommandlet::DestroySomeLevelActors(USpudState* State, ULevel* Level, FRandomStream& Rand)
+{
+	UWorld* World = Level->GetWorld();
+	TArray<AActor*> Actors = Level->Actors;
+	for (auto Actor : Actors)
+	{
+		if (IsValid(Actor) && Actor->IsA<ASpudBenchmarkActor>() && Actor->HasAnyFlags(RF_WasLoaded) &&
+			Rand.FRand() < Settings.DestroyedFraction)
+		{
+			State->StoreLevelActorDestroyed(Actor);
+			World->DestroyActor(Actor);
+		}
+	}
+}
+
+void USpudBenchmarkCommandlet::ForceSlowPath(USpudState* State)
+{
+	for (const auto& LevelData : State->SaveData.GetLevelDataSnapshot())
+	{
+		FSpudScopeLock LevelLock(&LevelData->Mutex);
+		for (auto& ClassDef : LevelData->Metadata.ClassDefinitions.Values)
+		{
+			ClassDef.RuntimeMatchState = FSpudClassDef::Different;
+		}
+	}
+}
+
+void USpudBenchmarkCommandlet::ReportResults() const
+{
+	UE_LOG(LogSpudEditor, Display, TEXT("SPUD benchmark results (mean of %d iterations):"), Settings.Iterations);
+	for (const auto& Phase : Results)
+	{
+		float Total = 0;
+		for (const float Ms : Phase.DurationsMs)
+		{
+			Total += Ms;
+		}
+		const double TotalSecs = Total / 1000.0;
+		UE_LOG(LogSpudEditor, Display, TEXT("  %-22s %10.2fms %12.0f actors/s %10.2f MB/s"),
+			*Phase.Name, Total / Phase.DurationsMs.Num(),
+			TotalSecs > 0 ? Phase.Actors / TotalSecs : 0,
+			TotalSecs > 0 ? Phase.Bytes / TotalSecs / (1024.0 * 1024.0) : 0);
+	}
+}
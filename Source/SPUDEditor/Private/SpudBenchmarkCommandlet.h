@@ -0,0 +1,81 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "SpudStats.h"
+
+#include "SpudBenchmarkCommandlet.generated.h"
+
+class USpudState;
+class ASpudBenchmarkActor;
+
+/**
+ * Generates a synthetic level full of persistent actors and times storing, restoring, saving and loading it, so that
+ * changes to SPUD (or your settings) can be compared. Results are logged and written as JSON.
+ *
+ * Usage: UE4Editor-Cmd <Project> -run=SpudBenchmark [options]
+ *   -Actors=N          Number of persistent actors (default 5000)
+ *   -Spawned=F         Fraction of them which are runtime spawned rather than level actors (default 0.25)
+ *   -Destroyed=F       Fraction of level actors destroyed after storing (default 0.1)
+ *   -Mix=a,b,..        Which property mixes to use, from pod,strings,arrays,structs,refs (default all of them)
+ *   -Iterations=N      How many times to run each phase (default 5)
+ *   -Seed=N            Random seed (default 0)
+ *   -Output=Path       Where to write the JSON results (default Saved/SpudBenchmark.json)
+ */
+UCLASS()
+class USpudBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	USpudBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+protected:
+	struct FSettings
+	{
+		int32 NumActors = 5000;
+		float SpawnedFraction = 0.25f;
+		float DestroyedFraction = 0.1f;
+		int32 Iterations = 5;
+		int32 Seed = 0;
+		TArray<FString> Mix;
+		FString OutputPath;
+	};
+
+	struct FPhaseResult
+	{
+		FString Name;
+		TArray<float> DurationsMs;
+		/// Totals across all iterations
+		int64 Actors = 0;
+		int64 Bytes = 0;
+		int64 FastPathRestores = 0;
+		int64 SlowPathRestores = 0;
+		float LockWaitMs = 0;
+
+		void Add(const FSpudOperationMetrics& Metrics, int64 InActors, int64 InBytes);
+	};
+
+	FSettings Settings;
+	TArray<UClass*> ActorClasses;
+	TArray<FPhaseResult> Results;
+
+	bool ParseSettings(const FString& Params);
+	FPhaseResult& GetPhase(const FString& Name);
+
+	/// Spawn all the level actors, and optionally the runtime spawned ones, then randomise their properties
+	void PopulateLevel(ULevel* Level, FRandomStream& Rand, bool bIncludeSpawned);
+	/// Destroy every benchmark actor in the level & collect garbage so that names can be reused
+	void ClearLevel(ULevel* Level);
+	/// Record some level actors as destroyed and destroy them
+	void DestroySomeLevelActors(USpudState* State, ULevel* Level, FRandomStream& Rand);
+	/// Make all restores use the slow path, as if every class had changed since it was saved
+	void ForceSlowPath(USpudState* State);
+
+	int32 NumLevelActors() const;
+	int32 NumSpawnedActors() const { return Settings.NumActors - NumLevelActors(); }
+
+	void ReportResults() const;
+};
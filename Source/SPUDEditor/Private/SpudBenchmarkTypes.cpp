@@ -0,0 +1,76 @@
+#include "SpudBenchmarkTypes.h"
+
+ASpudBenchmarkActor::ASpudBenchmarkActor()
+{
+	// So that there's a transform to store, like most real actors
+	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
+}
+
+void ASpudBenchmarkActor::Randomise(FRandomStream& Rand, const TArray<AActor*>& Others)
+{
+	IntValue = Rand.RandRange(0, 100000);
+	Int64Value = static_cast<int64>(Rand.RandRange(0, MAX_int32)) << 16;
+	FloatValue = Rand.FRandRange(-1000, 1000);
+	bFlag = Rand.RandRange(0, 1) == 1;
+	ByteValue = static_cast<uint8>(Rand.RandRange(0, 255));
+	VectorValue = Rand.VRand() * 1000;
+	RotatorValue = FRotator(Rand.FRandRange(-90, 90), Rand.FRandRange(-180, 180), 0);
+	SetActorLocationAndRotation(Rand.VRand() * 10000, FRotator(0, Rand.FRandRange(-180, 180), 0));
+}
+
+void ASpudBenchmarkStringActor::Randomise(FRandomStream& Rand, const TArray<AActor*>& Others)
+{
+	Super::Randomise(Rand, Others);
+	StringValue = FString::Printf(TEXT("Benchmark string value %d"), Rand.RandRange(0, 100000));
+	// Limited set of names, like real data
+	NameValue = FName(*FString::Printf(TEXT("Tag%d"), Rand.RandRange(0, 31)));
+}
+
+void ASpudBenchmarkArrayActor::Randomise(FRandomStream& Rand, const TArray<AActor*>& Others)
+{
+	Super::Randomise(Rand, Others);
+	Ints.SetNum(Rand.RandRange(4, 32));
+	for (auto& Val : Ints)
+	{
+		Val = Rand.RandRange(0, 100000);
+	}
+	Vectors.SetNum(Rand.RandRange(2, 16));
+	for (auto& Val : Vectors)
+	{
+		Val = Rand.VRand() * 1000;
+	}
+	Strings.SetNum(Rand.RandRange(1, 8));
+	for (auto& Val : Strings)
+	{
+		Val = FString::Printf(TEXT("Item %d"), Rand.RandRange(0, 100000));
+	}
+}
+
+void ASpudBenchmarkStructActor::Randomise(FRandomStream& Rand, const TArray<AActor*>& Others)
+{
+	Super::Randomise(Rand, Others);
+	StructValue.FloatValue = Rand.FRandRange(-1000, 1000);
+	StructValue.Ints.SetNum(Rand.RandRange(1, 8));
+	for (auto& Val : StructValue.Ints)
+	{
+		Val = Rand.RandRange(0, 100000);
+	}
+	StructValue.Inner.IntValue = Rand.RandRange(0, 100000);
+	StructValue.Inner.VectorValue = Rand.VRand() * 1000;
+	StructValue.Inner.StringValue = FString::Printf(TEXT("Inner %d"), Rand.RandRange(0, 100000));
+	TransformValue = FTransform(FRotator(0, Rand.FRandRange(-180, 180), 0), Rand.VRand() * 1000);
+}
+
+void ASpudBenchmarkRefActor::Randomise(FRandomStream& Rand, const TArray<AActor*>& Others)
+{
+	Super::Randomise(Rand, Others);
+	if (Others.Num() == 0)
+		return;
+
+	Target = Others[Rand.RandRange(0, Others.Num() - 1)];
+	Targets.SetNum(Rand.RandRange(1, 4));
+	for (auto& Val : Targets)
+	{
+		Val = Others[Rand.RandRange(0, Others.Num() - 1)];
+	}
+}
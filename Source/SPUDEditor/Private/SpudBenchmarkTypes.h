@@ -0,0 +1,121 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SpudHelpers.h"
+
+#include "SpudBenchmarkTypes.generated.h"
+
+// Synthetic persistent actors used by USpudBenchmarkCommandlet. Each class adds a different kind of property on top
+// of the basic POD ones, so the benchmark can be run with whatever mix of properties you're interested in
+
+USTRUCT()
+struct FSpudBenchmarkInnerStruct
+{
+	GENERATED_BODY()
+
+	UPROPERTY(SaveGame)
+	int32 IntValue = 0;
+	UPROPERTY(SaveGame)
+	FVector VectorValue = FVector::ZeroVector;
+	UPROPERTY(SaveGame)
+	FString StringValue;
+};
+
+USTRUCT()
+struct FSpudBenchmarkStruct
+{
+	GENERATED_BODY()
+
+	UPROPERTY(SaveGame)
+	float FloatValue = 0;
+	UPROPERTY(SaveGame)
+	TArray<int32> Ints;
+	UPROPERTY(SaveGame)
+	FSpudBenchmarkInnerStruct Inner;
+};
+
+/// Plain old data properties only
+UCLASS(NotBlueprintable, Transient)
+class ASpudBenchmarkActor : public ASpudActorBase
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(SaveGame)
+	int32 IntValue = 0;
+	UPROPERTY(SaveGame)
+	int64 Int64Value = 0;
+	UPROPERTY(SaveGame)
+	float FloatValue = 0;
+	UPROPERTY(SaveGame)
+	bool bFlag = false;
+	UPROPERTY(SaveGame)
+	uint8 ByteValue = 0;
+	UPROPERTY(SaveGame)
+	FVector VectorValue = FVector::ZeroVector;
+	UPROPERTY(SaveGame)
+	FRotator RotatorValue = FRotator::ZeroRotator;
+
+	ASpudBenchmarkActor();
+
+	/// Change all the persistent properties, so that a restore has something to do
+	virtual void Randomise(FRandomStream& Rand, const TArray<AActor*>& Others);
+};
+
+UCLASS(NotBlueprintable, Transient)
+class ASpudBenchmarkStringActor : public ASpudBenchmarkActor
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(SaveGame)
+	FString StringValue;
+	UPROPERTY(SaveGame)
+	FName NameValue;
+
+	virtual void Randomise(FRandomStream& Rand, const TArray<AActor*>& Others) override;
+};
+
+UCLASS(NotBlueprintable, Transient)
+class ASpudBenchmarkArrayActor : public ASpudBenchmarkActor
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(SaveGame)
+	TArray<int32> Ints;
+	UPROPERTY(SaveGame)
+	TArray<FVector> Vectors;
+	UPROPERTY(SaveGame)
+	TArray<FString> Strings;
+
+	virtual void Randomise(FRandomStream& Rand, const TArray<AActor*>& Others) override;
+};
+
+UCLASS(NotBlueprintable, Transient)
+class ASpudBenchmarkStructActor : public ASpudBenchmarkActor
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(SaveGame)
+	FSpudBenchmarkStruct StructValue;
+	UPROPERTY(SaveGame)
+	FTransform TransformValue;
+
+	virtual void Randomise(FRandomStream& Rand, const TArray<AActor*>& Others) override;
+};
+
+UCLASS(NotBlueprintable, Transient)
+class ASpudBenchmarkRefActor : public ASpudBenchmarkActor
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(SaveGame)
+	AActor* Target = nullptr;
+	UPROPERTY(SaveGame)
+	TArray<AActor*> Targets;
+
+	virtual void Randomise(FRandomStream& Rand, const TArray<AActor*>& Others) override;
+};
@@ -3,6 +3,7 @@
 
 #include "ISettingsModule.h"
 #include "ISettingsSection.h"
+#include "SpudPropertyPlan.h"
 #include "SPUDEditor/Public/SpudPluginSettings.h"
 
 IMPLEMENT_GAME_MODULE(FSpudEditorModule, SPUDEditor);
@@ -16,6 +17,9 @@ void FSpudEditorModule::StartupModule()
     UE_LOG(LogSpudEditor, Log, TEXT("SpudEditor: StartupModule"));
     
     PrePIEHandle = FEditorDelegates::PreBeginPIE.AddStatic(&FSpudEditorModule::PreBeginPIE);
+    // Cached property plans describe class layouts, which change when Blueprints are recompiled
+    if (GEditor)
+        BlueprintCompiledHandle = GEditor->OnBlueprintCompiled().AddStatic(&FSpudEditorModule::OnBlueprintCompiled);
 
 	// register settings
 	ISettingsModule* SettingsModule = FModuleManager::GetModulePtr<ISettingsModule>("Settings");
@@ -33,6 +37,8 @@ void FSpudEditorModule::StartupModule()
 void FSpudEditorModule::ShutdownModule()
 {
     FEditorDelegates::PreBeginPIE.Remove(PrePIEHandle);
+    if (GEditor)
+        GEditor->OnBlueprintCompiled().Remove(BlueprintCompiledHandle);
     UE_LOG(LogSpudEditor, Log, TEXT("SpudEditor: ShutdownModule"));
 }
 
@@ -73,4 +79,9 @@ void FSpudEditorModule::PreBeginPIE(bool)
     
 }
 
+void FSpudEditorModule::OnBlueprintCompiled()
+{
+	FSpudPropertyPlan::InvalidateAll();
+}
+
 #undef LOCTEXT_NAMESPACE
@@ -12,8 +12,10 @@ class FSpudEditorModule : public IModuleInterface
 {
 private:
     FDelegateHandle PrePIEHandle;
+    FDelegateHandle BlueprintCompiledHandle;
 public:
     virtual void StartupModule() override;
     virtual void ShutdownModule() override;
     static void PreBeginPIE(bool);
+    static void OnBlueprintCompiled();
 };
\ No newline at end of file
@@ -14,7 +14,9 @@ public class SPUDEditor : ModuleRules
                 "Core",
                 "CoreUObject",
                 "Engine",
-                "UnrealEd"
+                "UnrealEd",
+                "Json",
+                "SPUD"
             }
         );
         